@@ -0,0 +1,137 @@
+#pragma once
+// Agregados espaciales por nodo (OLAP sobre el arbol): para K medidas
+// numericas de T (p. ej. fare_amount y tip_amount), cada subarbol resume
+// cuenta, suma, minimo y maximo. agregarEnRango(bbox) usa el resumen de un
+// nodo sin descender cuando su MBR queda entero dentro de la caja; solo las
+// hojas del borde leen la arena. Los resumenes se arman perezosamente y se
+// invalidan por version de subarbol (ver RStarTree2D::NodoVista), asi siguen
+// correctos tras insertar, split, reinsertar, eliminar o condensar. La
+// cache se purga de a ratos (ver purgar), asi no crece con los nodos que
+// el arbol libera o clona.
+#include "rstartree.hpp"
+#include <array>
+#include <unordered_map>
+
+template <typename T, int K>
+class AgregadosPorNodo {
+public:
+    using Medidas = std::array<double, K>;
+
+    struct Resumen {
+        uint64_t cuenta = 0;
+        Medidas suma{}, min, max;
+        Resumen() {
+            min.fill(std::numeric_limits<double>::infinity());
+            max.fill(-std::numeric_limits<double>::infinity());
+        }
+        void agregar(const Medidas& v) {
+            cuenta++;
+            for (int k = 0; k < K; k++) {
+                suma[k] += v[k];
+                min[k] = std::min(min[k], v[k]);
+                max[k] = std::max(max[k], v[k]);
+            }
+        }
+        void agregar(const Resumen& o) {
+            cuenta += o.cuenta;
+            for (int k = 0; k < K; k++) {
+                suma[k] += o.suma[k];
+                min[k] = std::min(min[k], o.min[k]);
+                max[k] = std::max(max[k], o.max[k]);
+            }
+        }
+        double promedio(int k) const { return cuenta == 0 ? 0.0 : suma[k] / (double)cuenta; }
+    };
+
+    AgregadosPorNodo(const RStarTree2D<T>& arbol, std::function<Medidas(const T&)> medidasDe)
+        : arbol_(arbol), medidasDe_(std::move(medidasDe)) {}
+
+    // Pasada completa opcional (p. ej. tras la carga): arma todos los resumenes
+    void construir() {
+        cache_.clear();
+        rearmadosDesdePurga_ = 0;
+        if (arbol_.raiz().valida()) resumenDe(arbol_.raiz());
+    }
+
+    Resumen agregarEnRango(const Caja& bbox) {
+        if (rearmadosDesdePurga_ >= umbralPurga_ || 2 * arbol_.tamano() < puntosEnPurga_) purgar();
+        Resumen r;
+        if (arbol_.raiz().valida()) agregarRec(arbol_.raiz(), bbox, r);
+        return r;
+    }
+
+    // Resumenes recalculados desde la construccion (para tests y estadisticas)
+    size_t nodosRecalculados() const { return recalculados_; }
+    size_t entradasEnCache() const { return cache_.size(); }
+
+private:
+    using Vista = typename RStarTree2D<T>::NodoVista;
+    struct CacheNodo {
+        uint64_t version = 0;
+        Resumen resumen;
+    };
+
+    void agregarRec(const Vista& v, const Caja& bbox, Resumen& r) {
+        if (!v.mbr().interseca(bbox)) return;
+        if (bbox.cubre(v.mbr())) { r.agregar(resumenDe(v)); return; }
+        if (v.esHoja()) {
+            const auto& c = v.entradas();
+            for (uint32_t i = 0; i < c.n; i++)
+                if (bbox.contiene(c.x[i], c.y[i])) r.agregar(medidasDe_(arbol_.dato(c.idx[i])));
+        } else {
+            for (size_t i = 0; i < v.nHijos(); i++) agregarRec(v.hijo(i), bbox, r);
+        }
+    }
+
+    // Invalidacion perezosa: si la version del subarbol cambio, se rearma
+    // desde los hijos (que a su vez reusan su cache si siguen vigentes)
+    const Resumen& resumenDe(const Vista& v) {
+        auto it = cache_.find(v.clave());
+        if (it != cache_.end() && it->second.version == v.version()) return it->second.resumen;
+        Resumen r;
+        if (v.esHoja()) {
+            const auto& c = v.entradas();
+            for (uint32_t i = 0; i < c.n; i++) r.agregar(medidasDe_(arbol_.dato(c.idx[i])));
+        } else {
+            for (size_t i = 0; i < v.nHijos(); i++) r.agregar(resumenDe(v.hijo(i)));
+        }
+        recalculados_++;
+        rearmadosDesdePurga_++;
+        CacheNodo& c = cache_[v.clave()];
+        c.version = v.version();
+        c.resumen = r;
+        return c.resumen;
+    }
+
+    // La clave es la direccion del nodo: las entradas de celdas que el pool
+    // libero, de originales que la copia-en-escritura reemplazo o de
+    // versiones viejas no se vuelven a pedir. Tras tantos rearmados como
+    // nodos tenia el arbol en la ultima purga, o si el arbol perdio la
+    // mitad de sus puntos, se recorre el arbol y quedan solo las entradas
+    // de sus nodos con la version vigente: el recorrido se amortiza entre
+    // los rearmados y la cache no pasa de ~2 entradas por nodo vivo.
+    void purgar() {
+        std::unordered_map<uintptr_t, CacheNodo> vigentes;
+        size_t nodos = 0;
+        if (arbol_.raiz().valida()) conservar(arbol_.raiz(), vigentes, nodos);
+        cache_.swap(vigentes);
+        rearmadosDesdePurga_ = 0;
+        umbralPurga_ = std::max(nodos, PURGA_MINIMA);
+        puntosEnPurga_ = arbol_.tamano();
+    }
+    void conservar(const Vista& v, std::unordered_map<uintptr_t, CacheNodo>& vigentes, size_t& nodos) {
+        nodos++;
+        auto it = cache_.find(v.clave());
+        if (it != cache_.end() && it->second.version == v.version()) vigentes.emplace(it->first, it->second);
+        if (!v.esHoja())
+            for (size_t i = 0; i < v.nHijos(); i++) conservar(v.hijo(i), vigentes, nodos);
+    }
+
+    static constexpr size_t PURGA_MINIMA = 64;
+
+    const RStarTree2D<T>& arbol_;
+    std::function<Medidas(const T&)> medidasDe_;
+    std::unordered_map<uintptr_t, CacheNodo> cache_;
+    size_t recalculados_ = 0;
+    size_t rearmadosDesdePurga_ = 0, umbralPurga_ = PURGA_MINIMA, puntosEnPurga_ = 0;
+};
@@ -0,0 +1,296 @@
+#pragma once
+// Arbol de solo lectura mapeado en memoria (mmap), sin copia. El archivo
+// guarda nodos, columnas de hojas y arena con desplazamientos en lugar de
+// Nodo*, asi que se puede mapear en cualquier direccion. Abrir valida la
+// cabecera y recorre una vez los nodos (64 B cada uno): desplazamientos,
+// hijos y niveles, para que un archivo corrupto lance runtime_error en vez
+// de leer fuera del mapeo. Las columnas y la arena no se tocan: sus
+// paginas se traen a demanda y la cache de paginas del SO las comparte
+// entre todos los procesos que mapean el mismo archivo.
+// Layout: cabecera | nodos en orden BFS (64 B cada uno, los hijos de un
+// nodo quedan consecutivos) | columnas x[], y[], idx[] de cada hoja | arena.
+// Solo T trivialmente copiable; el archivo usa el orden de bytes nativo.
+//   RStarTree2DMapeado<Viaje>::escribir(arbol, "viajes.map");   // una vez
+//   RStarTree2DMapeado<Viaje> mapa("viajes.map");               // cada proceso
+//   auto r = mapa.buscarRango(caja);
+#include "rstartree.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+template <typename T>
+class RStarTree2DMapeado {
+    static_assert(std::is_trivially_copyable_v<T>, "RStarTree2DMapeado requiere T trivialmente copiable");
+public:
+    using Arbol = RStarTree2D<T>;
+    using Resultado = typename Arbol::Resultado;
+    using Columnas = typename Arbol::Columnas;
+    using HojaVista = typename Arbol::HojaVista;
+    using BufferVecinos = typename Arbol::BufferVecinos;
+
+    // Vuelca un arbol ya construido al formato mapeable
+    static void escribir(const Arbol& arbol, const std::string& ruta) {
+        std::vector<NodoMapa> nodos;
+        std::vector<typename Arbol::NodoVista> orden;   // BFS
+        if (arbol.raiz().valida()) orden.push_back(arbol.raiz());
+        for (size_t i = 0; i < orden.size(); i++)
+            for (size_t h = 0; h < orden[i].nHijos(); h++) orden.push_back(orden[i].hijo(h));
+
+        Cabecera c{};
+        std::memcpy(c.magia, MAGIA, sizeof c.magia);
+        c.formato = FORMATO;
+        c.ordenBytes = 0x01020304;
+        c.tamT = sizeof(T);
+        c.nodos = orden.size();
+        c.puntos = arbol.tamano();
+        c.arena = arbol.tamanoArena();
+        c.offNodos = alinear(sizeof(Cabecera), 64);
+        uint64_t off = c.offNodos + c.nodos * sizeof(NodoMapa);
+        uint64_t siguiente = 1;
+        for (const auto& v : orden) {
+            NodoMapa n{};
+            n.mbr = v.mbr();
+            n.nivel = v.nivel();
+            n.cuenta = v.cuenta();
+            n.version = v.version();
+            if (v.esHoja()) {
+                n.n = (uint32_t)v.entradas().size();
+                off = alinear(off, 8);
+                n.primero = off;
+                off += n.n * (2 * sizeof(double) + sizeof(uint32_t));
+            } else {
+                n.n = (uint32_t)v.nHijos();
+                n.primero = siguiente;
+                siguiente += n.n;
+            }
+            nodos.push_back(n);
+        }
+        c.offArena = alinear(off, std::max<size_t>(64, alignof(T)));
+        c.tamArchivo = c.offArena + c.arena * sizeof(T);
+
+        std::ofstream out(ruta, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("escribir: no se pudo abrir " + ruta);
+        uint64_t pos = 0;
+        auto poner = [&](const void* p, uint64_t bytes) { out.write((const char*)p, (std::streamsize)bytes); pos += bytes; };
+        auto rellenar = [&](uint64_t hasta) { static const char ceros[64] = {}; while (pos < hasta) poner(ceros, std::min<uint64_t>(64, hasta - pos)); };
+        poner(&c, sizeof c);
+        rellenar(c.offNodos);
+        poner(nodos.data(), nodos.size() * sizeof(NodoMapa));
+        for (size_t i = 0; i < orden.size(); i++) {
+            if (!orden[i].esHoja()) continue;
+            const Columnas& e = orden[i].entradas();
+            rellenar(nodos[i].primero);
+            poner(e.x, e.n * sizeof(double));
+            poner(e.y, e.n * sizeof(double));
+            poner(e.idx, e.n * sizeof(uint32_t));
+        }
+        rellenar(c.offArena);
+        std::vector<T> bloque;
+        bloque.reserve(4096);
+        for (size_t i = 0; i < c.arena; i++) {
+            bloque.push_back(arbol.dato((uint32_t)i));
+            if (bloque.size() == 4096 || i + 1 == c.arena) { poner(bloque.data(), bloque.size() * sizeof(T)); bloque.clear(); }
+        }
+        if (!out) throw std::runtime_error("escribir: error de escritura en " + ruta);
+    }
+
+    explicit RStarTree2DMapeado(const std::string& ruta) {
+        int fd = ::open(ruta.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("RStarTree2DMapeado: no se pudo abrir " + ruta);
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Cabecera)) {
+            ::close(fd);
+            throw std::runtime_error("RStarTree2DMapeado: " + ruta + " es demasiado corto");
+        }
+        tam_ = (size_t)st.st_size;
+        void* p = ::mmap(nullptr, tam_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);   // el mapeo sigue valido sin el descriptor
+        if (p == MAP_FAILED) throw std::runtime_error("RStarTree2DMapeado: mmap fallo para " + ruta);
+        base_ = (const unsigned char*)p;
+        const Cabecera& c = cabecera();
+        if (std::memcmp(c.magia, MAGIA, sizeof c.magia) != 0 || c.formato != FORMATO ||
+            c.ordenBytes != 0x01020304 || c.tamT != sizeof(T) || c.tamArchivo != tam_) {
+            ::munmap((void*)base_, tam_);
+            throw std::runtime_error("RStarTree2DMapeado: " + ruta + " no es un arbol mapeable de este T");
+        }
+        if (const char* error = validar()) {
+            ::munmap((void*)base_, tam_);
+            throw std::runtime_error("RStarTree2DMapeado: " + ruta + " corrupto: " + error);
+        }
+    }
+    ~RStarTree2DMapeado() {
+        if (base_ != nullptr) ::munmap((void*)base_, tam_);
+    }
+    RStarTree2DMapeado(const RStarTree2DMapeado&) = delete;
+    RStarTree2DMapeado& operator=(const RStarTree2DMapeado&) = delete;
+
+    size_t tamano() const { return (size_t)cabecera().puntos; }
+    const T& dato(uint32_t idx) const { return arena_[idx]; }
+
+    std::vector<Resultado> buscarRango(const Caja& bbox) const {
+        std::vector<Resultado> res;
+        buscarRango(bbox, res);
+        return res;
+    }
+    void buscarRango(const Caja& bbox, std::vector<Resultado>& salida) const {
+        recorrerHojas(&bbox, [&](const NodoMapa& h) { Arbol::filtrarColumnas(columnas(h), h.mbr, bbox, salida); });
+    }
+    size_t contarEnRango(const Caja& bbox) const {
+        return cabecera().nodos == 0 ? 0 : contarRec(nodos_[0], bbox);
+    }
+
+    // k vecinos mas cercanos, ordenados (best-first, como RStarTree2D)
+    std::vector<Resultado> kVecinos(double x, double y, int k) const {
+        std::vector<Resultado> res;
+        if (cabecera().nodos == 0 || k <= 0) return res;
+        BufferVecinos buf;
+        res.resize(std::min((size_t)k, tamano()));
+        res.resize(kVecinos(x, y, k, buf, res.data()));
+        return res;
+    }
+    // Variante sin reservas, como RStarTree2D::kVecinos con BufferVecinos
+    size_t kVecinos(double x, double y, int k, BufferVecinos& buf, Resultado* salida) const {
+        if (cabecera().nodos == 0 || k <= 0) return 0;
+        auto cmpN = [](const std::pair<double, uint32_t>& a,
+                       const std::pair<double, uint32_t>& b) { return a.first > b.first; };
+        auto& nodos = buf.lineas;
+        nodos.clear();
+        buf.mejores.clear();
+        nodos.push_back({nodos_[0].mbr.dist2A(x, y), 0});
+        while (!nodos.empty()) {
+            std::pop_heap(nodos.begin(), nodos.end(), cmpN);
+            auto [d2, i] = nodos.back();
+            nodos.pop_back();
+            if ((int)buf.mejores.size() == k && d2 > buf.mejores.front().first) break;   // poda
+            const NodoMapa& n = nodos_[i];
+            if (n.nivel == 0) {
+                if (buf.dHoja.size() < n.n + 4) buf.dHoja.resize(n.n + 4);
+                Arbol::mejoresDeHoja(columnas(n), x, y, k, buf);
+                continue;
+            }
+            for (uint32_t h = 0; h < n.n; h++) {
+                uint32_t j = (uint32_t)(n.primero + h);
+                nodos.push_back({nodos_[j].mbr.dist2A(x, y), j});
+                std::push_heap(nodos.begin(), nodos.end(), cmpN);
+            }
+        }
+        return Arbol::volcarMejores(buf, salida);
+    }
+
+    // Misma vista que RStarTree2D::visitarHojas; la clave es el
+    // desplazamiento del nodo en el archivo, igual en todos los procesos.
+    void visitarHojas(const std::function<void(const HojaVista&)>& f) const {
+        recorrerHojas(nullptr, [&](const NodoMapa& h) { visitar(h, f); });
+    }
+    void visitarHojasEnRango(const Caja& bbox, const std::function<void(const HojaVista&)>& f) const {
+        recorrerHojas(&bbox, [&](const NodoMapa& h) { visitar(h, f); });
+    }
+
+private:
+    static constexpr char MAGIA[8] = "RSTARMP";
+    static constexpr uint32_t FORMATO = 1;
+    struct Cabecera {
+        char magia[8];
+        uint32_t formato, ordenBytes, tamT, relleno;
+        uint64_t nodos, puntos, arena;
+        uint64_t offNodos, offArena, tamArchivo;
+    };
+    struct NodoMapa {
+        Caja mbr;
+        uint64_t cuenta, version;
+        uint64_t primero;   // interno: indice del primer hijo; hoja: desplazamiento de x[]
+        uint32_t n;         // hijos o entradas
+        int32_t nivel;      // 0 = hoja
+    };
+    static_assert(sizeof(NodoMapa) == 64, "un nodo por linea de cache");
+    static constexpr int MAX_ALTURA = 64;   // como Congelado: acota la pila de recorrerHojas
+    static constexpr uint64_t alinear(uint64_t b, uint64_t a) { return (b + a - 1) / a * a; }
+
+    const Cabecera& cabecera() const { return *(const Cabecera*)base_; }
+
+    // Secciones dentro del archivo y una pasada por los nodos en orden BFS:
+    // los hijos de cada interno son los siguientes sin padre (asi cada nodo
+    // tiene un solo padre y no hay ciclos), un nivel menos que el padre, y
+    // las columnas de cada hoja caen entre los nodos y la arena. Devuelve
+    // el problema o nullptr; deja nodos_ y arena_ apuntando al mapeo.
+    const char* validar() {
+        const Cabecera& c = cabecera();
+        if (c.offNodos < sizeof(Cabecera) || c.offNodos % alignof(NodoMapa) != 0 || c.offNodos > tam_ ||
+            c.nodos > (tam_ - c.offNodos) / sizeof(NodoMapa))
+            return "nodos fuera del archivo";
+        uint64_t finNodos = c.offNodos + c.nodos * sizeof(NodoMapa);
+        if (c.offArena < finNodos || c.offArena % alignof(T) != 0 || c.offArena > tam_ ||
+            c.arena != (tam_ - c.offArena) / sizeof(T) || c.offArena + c.arena * sizeof(T) != tam_)
+            return "arena fuera del archivo";
+        nodos_ = (const NodoMapa*)(base_ + c.offNodos);
+        arena_ = (const T*)(base_ + c.offArena);
+        if (c.nodos == 0) return c.puntos == 0 ? nullptr : "puntos sin nodos";
+        if (nodos_[0].nivel < 0 || nodos_[0].nivel >= MAX_ALTURA) return "nivel de la raiz";
+        if (nodos_[0].cuenta != c.puntos) return "cuenta de la raiz";
+        uint64_t siguiente = 1;
+        for (uint64_t i = 0; i < c.nodos; i++) {
+            const NodoMapa& n = nodos_[i];
+            if (i > 0 && i >= siguiente) return "nodo sin padre";
+            if (n.nivel == 0) {
+                if (n.primero % alignof(double) != 0 || n.primero < finNodos || n.primero > c.offArena ||
+                    n.n > (c.offArena - n.primero) / (2 * sizeof(double) + sizeof(uint32_t)))
+                    return "columnas de hoja fuera de su seccion";
+                continue;
+            }
+            if (n.n == 0 || n.primero != siguiente || n.n > c.nodos - siguiente) return "hijos fuera de rango";
+            for (uint32_t h = 0; h < n.n; h++)
+                if (nodos_[siguiente + h].nivel != n.nivel - 1) return "nivel de un hijo";
+            siguiente += n.n;
+        }
+        return siguiente == c.nodos ? nullptr : "nodos sin padre";
+    }
+    // vista de columnas sobre el mapeo (solo lectura: el mapeo es PROT_READ)
+    Columnas columnas(const NodoMapa& h) const {
+        Columnas c;
+        c.x = (double*)(base_ + h.primero);
+        c.y = c.x + h.n;
+        c.idx = (uint32_t*)(c.y + h.n);
+        c.n = h.n;
+        return c;
+    }
+    void visitar(const NodoMapa& h, const std::function<void(const HojaVista&)>& f) const {
+        Columnas c = columnas(h);
+        f(HojaVista{(uintptr_t)((const unsigned char*)&h - base_), h.version, h.mbr, c});
+    }
+    // Hojas cuyo MBR interseca la caja (todas si es nullptr), en orden, con
+    // pila de (nodo, proximo hijo) por nivel: la altura esta validada
+    template <typename F>
+    void recorrerHojas(const Caja* bbox, F&& f) const {
+        if (cabecera().nodos == 0 || (bbox != nullptr && !nodos_[0].mbr.interseca(*bbox))) return;
+        const NodoMapa* nodo[MAX_ALTURA];
+        uint32_t sig[MAX_ALTURA];
+        int tope = 0;
+        nodo[0] = nodos_; sig[0] = 0;
+        while (tope >= 0) {
+            const NodoMapa& n = *nodo[tope];
+            if (n.nivel == 0) { f(n); tope--; continue; }
+            if (sig[tope] == n.n) { tope--; continue; }
+            const NodoMapa& h = nodos_[n.primero + sig[tope]++];
+            if (bbox == nullptr || h.mbr.interseca(*bbox)) {
+                tope++;
+                nodo[tope] = &h; sig[tope] = 0;
+            }
+        }
+    }
+    size_t contarRec(const NodoMapa& n, const Caja& bbox) const {
+        if (!n.mbr.interseca(bbox)) return 0;
+        if (bbox.cubre(n.mbr)) return (size_t)n.cuenta;
+        if (n.nivel != 0) {
+            size_t total = 0;
+            for (uint32_t i = 0; i < n.n; i++) total += contarRec(nodos_[n.primero + i], bbox);
+            return total;
+        }
+        return Arbol::contarColumnas(columnas(n), bbox);
+    }
+
+    const unsigned char* base_ = nullptr;
+    size_t tam_ = 0;
+    const NodoMapa* nodos_ = nullptr;
+    const T* arena_ = nullptr;
+};
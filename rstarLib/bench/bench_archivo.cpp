@@ -0,0 +1,69 @@
+// Reinicio desde archivo: tiempo de guardar y cargar un arbol de N puntos
+// (argv[1], default 5000000) frente a reconstruirlo con cargarMasivo.
+// El archivo va a argv[2] (default /tmp/rstar_bench.bin). La carga se mide
+// con el archivo en la cache de paginas del SO (reinicio en caliente).
+// Compilar y correr: make bench
+#include "../rstartree.hpp"
+#include "../arbol_mapeado.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+static double segundosDesde(Reloj::time_point t0) {
+    return chrono::duration<double>(Reloj::now() - t0).count();
+}
+
+struct Viaje { uint32_t id; float tarifa; float propina; int32_t etiqueta; };   // trivialmente copiable
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 5000000;
+    string ruta = argc > 2 ? argv[2] : "/tmp/rstar_bench.bin";
+    mt19937 gen(3);
+    uniform_real_distribution<double> dLat(40.55, 40.95), dLon(-74.10, -73.70);
+    vector<tuple<double, double, Viaje>> pts(n);
+    for (int i = 0; i < n; i++)
+        pts[i] = {dLat(gen), dLon(gen), Viaje{(uint32_t)i, 10.0f + i % 50, 1.0f, i % 10}};
+
+    RStarTree2D<Viaje> arbol;
+    auto t0 = Reloj::now();
+    arbol.cargarMasivo(pts.begin(), pts.end());
+    double segCarga = segundosDesde(t0);
+    t0 = Reloj::now();
+    arbol.guardar(ruta);
+    double segGuardar = segundosDesde(t0);
+    ifstream f(ruta, ios::binary | ios::ate);
+    double mb = (double)f.tellg() / (1 << 20);
+
+    double segCargar = 1e30;
+    size_t cuenta = 0;
+    for (int ronda = 0; ronda < 3; ronda++) {   // mejor de 3
+        RStarTree2D<Viaje> copia;
+        t0 = Reloj::now();
+        copia.cargar(ruta);
+        segCargar = min(segCargar, segundosDesde(t0));
+        cuenta = copia.contarEnRango(Caja(40.7, -74.0, 40.8, -73.9));
+    }
+    string rutaMapa = ruta + ".map";
+    RStarTree2DMapeado<Viaje>::escribir(arbol, rutaMapa);
+    double segMapear = 1e30;
+    size_t cuentaMapa = 0;
+    for (int ronda = 0; ronda < 3; ronda++) {
+        t0 = Reloj::now();
+        RStarTree2DMapeado<Viaje> mapa(rutaMapa);
+        cuentaMapa = mapa.contarEnRango(Caja(40.7, -74.0, 40.8, -73.9));
+        segMapear = min(segMapear, segundosDesde(t0));
+    }
+    printf("N = %d, archivo %.0f MB\n", n, mb);
+    printf("cargarMasivo (STR)   %6.2f s\n", segCarga);
+    printf("guardar              %6.2f s\n", segGuardar);
+    printf("cargar               %6.2f s  (%.0f MB/s, %zu en la caja de control)\n", segCargar,
+           mb / segCargar, cuenta);
+    printf("mapear + 1a consulta %6.4f s  (%zu en la caja de control)\n", segMapear, cuentaMapa);
+    remove(ruta.c_str());
+    remove(rutaMapa.c_str());
+    return 0;
+}
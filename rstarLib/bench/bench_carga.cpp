@@ -0,0 +1,85 @@
+// Benchmark de carga: insertar (orden lat/lon del pipeline) vs cargarMasivo
+// STR vs cargarMasivo Hilbert, con la calidad de la estructura resultante.
+// Compilar y correr: make bench   (N por argumento, default 200000)
+#include "../rstartree.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+static double segundosDesde(Reloj::time_point t0) {
+    return chrono::duration<double>(Reloj::now() - t0).count();
+}
+
+// puntos estilo NYC-taxi: focos gaussianos (Midtown, Downtown, aeropuertos)
+// sobre un fondo uniforme
+static vector<tuple<double, double, int>> generarTaxis(int n, unsigned semilla) {
+    mt19937 gen(semilla);
+    const double focos[][3] = {{40.758, -73.985, 0.012}, {40.712, -74.006, 0.008},
+                               {40.641, -73.778, 0.006}, {40.777, -73.872, 0.005}};
+    uniform_real_distribution<double> u(0.0, 1.0);
+    normal_distribution<double> g(0.0, 1.0);
+    vector<tuple<double, double, int>> v;
+    v.reserve(n);
+    for (int i = 0; i < n; i++) {
+        double lat, lon;
+        if (u(gen) < 0.2) { lat = 40.55 + 0.4 * u(gen); lon = -74.10 + 0.4 * u(gen); }
+        else {
+            const double* f = focos[i % 4];
+            lat = f[0] + g(gen) * f[2];
+            lon = f[1] + g(gen) * f[2];
+        }
+        v.emplace_back(lat, lon, i);
+    }
+    return v;
+}
+
+static void reportar(const char* nombre, double seg, const RStarTree2D<int>& arbol,
+                     const vector<Caja>& consultas) {
+    auto c = arbol.calidad();
+    auto t0 = Reloj::now();
+    size_t hallados = 0;
+    for (const Caja& q : consultas) hallados += arbol.buscarRango(q).size();
+    double segConsultas = segundosDesde(t0);
+    printf("%-22s %8.3f s  hojas %6zu  ocup %5.2f  overlap/area %8.4f  muerto/area %8.4f  rango %7.1f us (%zu)\n",
+           nombre, seg, c.hojas, c.ocupacion, c.overlap / c.areaRaiz, c.espacioMuerto / c.areaRaiz,
+           1e6 * segConsultas / consultas.size(), hallados);
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 200000;
+    auto puntos = generarTaxis(n, 42);
+    mt19937 gen(7);
+    uniform_real_distribution<double> cLat(40.60, 40.90), cLon(-74.05, -73.75);
+    vector<Caja> consultas;
+    for (int i = 0; i < 2000; i++) {
+        double lat = cLat(gen), lon = cLon(gen);
+        consultas.push_back(Caja(lat, lon, lat + 0.01, lon + 0.01));
+    }
+    printf("N = %d, M = 1200, m = 480\n", n);
+
+    {
+        auto ordenados = puntos;   // orden del pipeline: (lat, lon)
+        sort(ordenados.begin(), ordenados.end());
+        RStarTree2D<int> arbol;
+        auto t0 = Reloj::now();
+        for (auto& [x, y, d] : ordenados) arbol.insertar(x, y, d);
+        reportar("insertar (lat,lon)", segundosDesde(t0), arbol, consultas);
+    }
+    {
+        RStarTree2D<int> arbol;
+        auto t0 = Reloj::now();
+        arbol.cargarMasivo(puntos.begin(), puntos.end(), Empaquetado::STR);
+        reportar("cargarMasivo STR", segundosDesde(t0), arbol, consultas);
+    }
+    {
+        RStarTree2D<int> arbol;
+        auto t0 = Reloj::now();
+        arbol.cargarMasivo(puntos.begin(), puntos.end(), Empaquetado::Hilbert);
+        reportar("cargarMasivo Hilbert", segundosDesde(t0), arbol, consultas);
+    }
+    return 0;
+}
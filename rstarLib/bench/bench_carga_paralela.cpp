@@ -0,0 +1,67 @@
+// Curva de aceleracion de cargarMasivo en paralelo: segundos de la carga
+// STR y Hilbert con 1..32 hilos (o hasta argv[2]) sobre N puntos estilo
+// taxi (argv[1], default 5000000), y verificacion de que el arbol es el
+// mismo que con un hilo. Compilar y correr: make bench
+#include "../rstartree.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+static double segundosDesde(Reloj::time_point t0) {
+    return chrono::duration<double>(Reloj::now() - t0).count();
+}
+
+// huella del arbol: hojas en orden de recorrido con sus idx
+static uint64_t huella(const RStarTree2D<int>& arbol) {
+    uint64_t h = 1469598103934665603ull;
+    arbol.visitarHojas([&](const RStarTree2D<int>::HojaVista& v) {
+        for (uint32_t i = 0; i < v.entradas.n; i++) h = (h ^ v.entradas.idx[i]) * 1099511628211ull;
+        h = (h ^ 0xFFFFFFFFu) * 1099511628211ull;
+    });
+    return h;
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 5000000;
+    unsigned maxHilos = argc > 2 ? (unsigned)atoi(argv[2]) : 32;
+    mt19937 gen(7);
+    uniform_real_distribution<double> u(0.0, 1.0);
+    normal_distribution<double> g(0.0, 1.0);
+    const double focos[][3] = {{40.758, -73.985, 0.012}, {40.712, -74.006, 0.008},
+                               {40.641, -73.778, 0.006}, {40.777, -73.872, 0.005}};
+    vector<tuple<double, double, int>> pts(n);
+    for (int i = 0; i < n; i++) {
+        const double* f = focos[i % 4];
+        pts[i] = u(gen) < 0.2 ? make_tuple(40.55 + 0.4 * u(gen), -74.10 + 0.4 * u(gen), i)
+                              : make_tuple(f[0] + g(gen) * f[2], f[1] + g(gen) * f[2], i);
+    }
+    printf("N = %d, nucleos de la maquina: %u\n", n, thread::hardware_concurrency());
+    printf("%6s %10s %9s %10s %9s %s\n", "hilos", "STR s", "speedup", "Hilbert s", "speedup", "mismo arbol");
+
+    double base[2] = {0, 0};
+    uint64_t huellaBase[2] = {0, 0};
+    for (unsigned h = 1; h <= maxHilos; h *= 2) {
+        PoolHilos pool(h);
+        double seg[2];
+        bool mismo = true;
+        int k = 0;
+        for (Empaquetado modo : {Empaquetado::STR, Empaquetado::Hilbert}) {
+            auto* arbol = new RStarTree2D<int>();
+            auto t0 = Reloj::now();
+            arbol->cargarMasivo(pts.begin(), pts.end(), modo, pool);
+            seg[k] = segundosDesde(t0);
+            uint64_t hu = huella(*arbol);
+            if (h == 1) { base[k] = seg[k]; huellaBase[k] = hu; }
+            else if (hu != huellaBase[k]) mismo = false;
+            delete arbol;
+            k++;
+        }
+        printf("%6u %10.2f %8.2fx %10.2f %8.2fx %s\n", h, seg[0], base[0] / seg[0],
+               seg[1], base[1] / seg[1], mismo ? "si" : "NO");
+    }
+    return 0;
+}
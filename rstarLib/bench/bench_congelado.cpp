@@ -0,0 +1,77 @@
+// Arbol de punteros vs congelar(): latencia por consulta (media y p99, en
+// microsegundos) de rango chico (~1 acierto), rango de ~100 aciertos y
+// kNN k=10, sobre N puntos (argv[1], default 5000000) cargados con STR,
+// con M = 1200 (default del arbol) y M = 32. Compilar y correr: make bench
+#include "../rstartree.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+
+struct Latencia { double media, p99; };
+template <typename F>
+static Latencia medir(int consultas, F&& consulta) {
+    vector<double> us(consultas);
+    for (int i = 0; i < consultas; i++) {
+        auto t0 = Reloj::now();
+        consulta(i);
+        us[i] = chrono::duration<double, micro>(Reloj::now() - t0).count();
+    }
+    double suma = 0;
+    for (double u : us) suma += u;
+    nth_element(us.begin(), us.begin() + consultas * 99 / 100, us.end());
+    return {suma / consultas, us[consultas * 99 / 100]};
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 5000000;
+    const int CONSULTAS = 50000;
+    mt19937 gen(11);
+    uniform_real_distribution<double> dLat(40.55, 40.95), dLon(-74.10, -73.70);
+    vector<tuple<double, double, int>> pts(n);
+    for (int i = 0; i < n; i++) pts[i] = {dLat(gen), dLon(gen), i};
+    vector<Caja> chicas, medianas;
+    vector<pair<double, double>> centros;
+    double ladoChico = 0.4 * sqrt(1.0 / n), ladoMediano = 0.4 * sqrt(100.0 / n);
+    for (int i = 0; i < CONSULTAS; i++) {
+        double lat = dLat(gen), lon = dLon(gen);
+        chicas.push_back(Caja(lat, lon, lat + ladoChico, lon + ladoChico));
+        medianas.push_back(Caja(lat, lon, lat + ladoMediano, lon + ladoMediano));
+        centros.push_back({lat, lon});
+    }
+
+    for (int M : {1200, 32}) {
+        RStarTree2D<int> arbol(M, M * 2 / 5);
+        arbol.cargarMasivo(pts.begin(), pts.end());
+        auto bfs = arbol.congelar(Disposicion::BFS);
+        auto veb = arbol.congelar(Disposicion::vEB);
+        printf("\nN = %d, M = %d, altura %d, bloque congelado %.0f MB\n", n, M, arbol.calidad().altura,
+               (double)bfs.bytes() / (1 << 20));
+        printf("%-10s %21s %21s %21s\n", "", "rango ~1 (us)", "rango ~100 (us)", "knn10 (us)");
+        printf("%-10s %10s %10s %10s %10s %10s %10s\n", "", "media", "p99", "media", "p99", "media", "p99");
+
+        vector<RStarTree2D<int>::Resultado> salida;
+        RStarTree2D<int>::BufferVecinos buf;
+        RStarTree2D<int>::Resultado vecinos[10];
+        size_t control = 0;   // los tres deben dar lo mismo
+        auto fila = [&](const char* nombre, auto& a) {
+            size_t aciertos = 0;
+            Latencia l[3];
+            l[0] = medir(CONSULTAS, [&](int i) { salida.clear(); a.buscarRango(chicas[i], salida); aciertos += salida.size(); });
+            l[1] = medir(CONSULTAS, [&](int i) { salida.clear(); a.buscarRango(medianas[i], salida); aciertos += salida.size(); });
+            l[2] = medir(CONSULTAS, [&](int i) { aciertos += vecinos[a.kVecinos(centros[i].first, centros[i].second, 10, buf, vecinos) - 1].idx; });
+            printf("%-10s %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f%s\n", nombre, l[0].media, l[0].p99,
+                   l[1].media, l[1].p99, l[2].media, l[2].p99,
+                   control != 0 && control != aciertos ? "  (RESULTADOS DISTINTOS)" : "");
+            control = aciertos;
+        };
+        fila("punteros", arbol);
+        fila("BFS", bfs);
+        fila("vEB", veb);
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// DBSCAN geografico: N pickups estilo taxi (argv[1], default 500000)
+// cargados con STR, eps (argv[2] en grados, default 0.0003, ~30 m) y
+// minPts (argv[3], default 20). DBSCAN clasico con una buscarRango por
+// punto (como hace sklearn con su consulta de radio por punto) contra
+// Dbscan sobre el auto-join del arbol, en un hilo y en un PoolHilos con
+// todos los nucleos, con M = 1200 (default del arbol) y M = 32.
+// Compilar y correr: make bench
+#include "../dbscan.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+struct Viaje { int id; int32_t cluster; };
+static double segundosDesde(Reloj::time_point t0) {
+    return chrono::duration<double>(Reloj::now() - t0).count();
+}
+
+// DBSCAN de Ester et al. con consultas de rango: expande cada cluster
+// desde un nucleo con una buscarRango por punto alcanzado
+static uint32_t dbscanPorRangos(RStarTree2D<Viaje>& arbol, size_t n, double eps, int minPts) {
+    vector<int32_t> etiqueta(n, -2);   // -2 sin visitar, -1 ruido
+    vector<RStarTree2D<Viaje>::Resultado> buf, vec;
+    // coordenadas por idx, para las consultas
+    vector<pair<double, double>> pos(n);
+    arbol.recorrer([&](const RStarTree2D<Viaje>::Resultado& r) { pos[r.idx] = {r.x, r.y}; });
+    auto region = [&](uint32_t i, vector<RStarTree2D<Viaje>::Resultado>& salida) {
+        auto [x, y] = pos[i];
+        salida.clear();
+        arbol.buscarRango(Caja(x - eps, y - eps, x + eps, y + eps), salida);
+        size_t k = 0;
+        for (const auto& r : salida)
+            if ((r.x - x) * (r.x - x) + (r.y - y) * (r.y - y) <= eps * eps) salida[k++] = r;
+        salida.resize(k);
+    };
+    uint32_t clusters = 0;
+    vector<uint32_t> cola;
+    for (uint32_t i = 0; i < n; i++) {
+        if (etiqueta[i] != -2) continue;
+        region(i, buf);
+        if ((int)buf.size() < minPts) { etiqueta[i] = -1; continue; }
+        int32_t c = (int32_t)clusters++;
+        etiqueta[i] = c;
+        cola.clear();
+        for (const auto& r : buf) cola.push_back(r.idx);
+        while (!cola.empty()) {
+            uint32_t q = cola.back();
+            cola.pop_back();
+            if (etiqueta[q] == -1) etiqueta[q] = c;   // ruido que resulta borde
+            if (etiqueta[q] != -2) continue;
+            etiqueta[q] = c;
+            region(q, vec);
+            if ((int)vec.size() >= minPts)
+                for (const auto& r : vec) cola.push_back(r.idx);
+        }
+    }
+    for (uint32_t i = 0; i < n; i++) arbol.dato(i).cluster = etiqueta[i];
+    return clusters;
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 500000;
+    double eps = argc > 2 ? atof(argv[2]) : 0.0003;
+    int minPts = argc > 3 ? atoi(argv[3]) : 20;
+    mt19937 gen(25);
+    uniform_real_distribution<double> u(0.0, 1.0);
+    normal_distribution<double> g(0.0, 1.0);
+    const double focos[][3] = {{40.758, -73.985, 0.012}, {40.712, -74.006, 0.008},
+                               {40.641, -73.778, 0.006}, {40.777, -73.872, 0.005}};
+    vector<tuple<double, double, Viaje>> pts(n);
+    for (int i = 0; i < n; i++) {
+        const double* f = focos[i % 4];
+        pts[i] = u(gen) < 0.2 ? make_tuple(40.55 + 0.4 * u(gen), -74.10 + 0.4 * u(gen), Viaje{i, -1})
+                              : make_tuple(f[0] + g(gen) * f[2], f[1] + g(gen) * f[2], Viaje{i, -1});
+    }
+    PoolHilos pool;
+
+    printf("N = %d, eps = %g, minPts = %d, %u hilos\n", n, eps, minPts, pool.hilos());
+    printf("%-8s %-20s %10s %10s %10s\n", "", "", "clusters", "ruido", "ms");
+    for (int M : {1200, 32}) {
+        RStarTree2D<Viaje> arbol(M, M * 2 / 5);
+        arbol.cargarMasivo(pts.begin(), pts.end());
+        auto fila = [&](const char* nombre, uint32_t clusters, double seg) {
+            size_t ruido = 0;
+            for (int i = 0; i < n; i++) ruido += arbol.dato(i).cluster < 0;
+            printf("M=%-6d %-20s %10u %10zu %10.1f\n", M, nombre, clusters, ruido, seg * 1e3);
+        };
+        auto t0 = Reloj::now();
+        uint32_t c = dbscanPorRangos(arbol, n, eps, minPts);
+        fila("buscarRango x punto", c, segundosDesde(t0));
+
+        Dbscan<Viaje> dbscan(arbol);
+        auto poner = [](Viaje& v, int32_t e) { v.cluster = e; };
+        t0 = Reloj::now();
+        c = dbscan.etiquetar(eps, minPts, poner);
+        fila("Dbscan", c, segundosDesde(t0));
+        t0 = Reloj::now();
+        c = dbscan.etiquetar(eps, minPts, pool, poner);
+        fila("Dbscan paralelo", c, segundosDesde(t0));
+    }
+    return 0;
+}
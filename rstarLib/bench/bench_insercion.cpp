@@ -0,0 +1,66 @@
+// Insercion una a una: inserciones por segundo al insertar N puntos estilo
+// taxi (argv[1], default 200000) en un arbol vacio, con M = 1200 (default
+// del arbol), M = 32 y RStarTree2DFijo<int, 32>, y reservas del heap por
+// insercion en la segunda mitad (regimen). Compilar y correr: make bench
+#include "../rstartree.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <tuple>
+using namespace std;
+
+static atomic<size_t> reservas{0};
+void* operator new(size_t n) {
+    reservas.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(n == 0 ? 1 : n)) return p;
+    throw bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+using Reloj = chrono::steady_clock;
+
+template <typename Arbol>
+static void medir(const char* nombre, Arbol& arbol, const vector<tuple<double, double, int>>& pts) {
+    size_t n = pts.size(), mitad = n / 2, r0 = 0;
+    auto t0 = Reloj::now();
+    for (size_t i = 0; i < n; i++) {
+        if (i == mitad) r0 = reservas.load();
+        arbol.insertar(get<0>(pts[i]), get<1>(pts[i]), get<2>(pts[i]));
+    }
+    double seg = chrono::duration<double>(Reloj::now() - t0).count();
+    printf("%-16s %12.0f %10.2f %14.3f\n", nombre, n / seg, seg * 1e6 / n,
+           (double)(reservas.load() - r0) / (n - mitad));
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 200000;
+    mt19937 gen(5);
+    uniform_real_distribution<double> u(0.0, 1.0);
+    normal_distribution<double> g(0.0, 1.0);
+    const double focos[][3] = {{40.758, -73.985, 0.012}, {40.712, -74.006, 0.008},
+                               {40.641, -73.778, 0.006}, {40.777, -73.872, 0.005}};
+    vector<tuple<double, double, int>> pts(n);
+    for (int i = 0; i < n; i++) {
+        const double* f = focos[i % 4];
+        pts[i] = u(gen) < 0.2 ? make_tuple(40.55 + 0.4 * u(gen), -74.10 + 0.4 * u(gen), i)
+                              : make_tuple(f[0] + g(gen) * f[2], f[1] + g(gen) * f[2], i);
+    }
+    printf("N = %d\n%-16s %12s %10s %14s\n", n, "", "ins/s", "us/ins", "reservas/ins");
+    {
+        RStarTree2D<int> arbol;
+        medir("M=1200", arbol, pts);
+    }
+    {
+        RStarTree2D<int> arbol(32, 12);
+        medir("M=32", arbol, pts);
+    }
+    {
+        RStarTree2DFijo<int, 32> arbol;
+        medir("Fijo<32>", arbol, pts);
+    }
+    return 0;
+}
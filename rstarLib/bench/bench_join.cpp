@@ -0,0 +1,78 @@
+// Join espacial: N pickups y N dropoffs estilo taxi (argv[1], default
+// 500000), cada conjunto cargado con STR en su arbol; todos los pares
+// pickup-dropoff a distancia <= d (argv[2] en grados, default 0.0002,
+// ~20 m). Una buscarRango por pickup con filtro de distancia, contra
+// JoinEspacial (recorrido sincronizado) en un hilo y en un PoolHilos con
+// todos los nucleos, con M = 1200 (default del arbol) y M = 32.
+// Compilar y correr: make bench
+#include "../join_espacial.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+using Viajes = vector<tuple<double, double, int>>;
+static double segundosDesde(Reloj::time_point t0) {
+    return chrono::duration<double>(Reloj::now() - t0).count();
+}
+
+static Viajes generar(int n, mt19937& gen) {
+    uniform_real_distribution<double> u(0.0, 1.0);
+    normal_distribution<double> g(0.0, 1.0);
+    const double focos[][3] = {{40.758, -73.985, 0.012}, {40.712, -74.006, 0.008},
+                               {40.641, -73.778, 0.006}, {40.777, -73.872, 0.005}};
+    Viajes v(n);
+    for (int i = 0; i < n; i++) {
+        const double* f = focos[i % 4];
+        v[i] = u(gen) < 0.2 ? make_tuple(40.55 + 0.4 * u(gen), -74.10 + 0.4 * u(gen), i)
+                            : make_tuple(f[0] + g(gen) * f[2], f[1] + g(gen) * f[2], i);
+    }
+    return v;
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 500000;
+    double d = argc > 2 ? atof(argv[2]) : 0.0002;
+    mt19937 gen(24);
+    Viajes pickups = generar(n, gen), dropoffs = generar(n, gen);
+    PoolHilos pool;
+
+    printf("N = %d pickups x %d dropoffs, d = %g, %u hilos\n", n, n, d, pool.hilos());
+    printf("%-8s %-20s %12s %10s\n", "", "", "pares", "ms");
+    for (int M : {1200, 32}) {
+        RStarTree2D<int> a(M, M * 2 / 5), b(M, M * 2 / 5);
+        a.cargarMasivo(pickups.begin(), pickups.end());
+        b.cargarMasivo(dropoffs.begin(), dropoffs.end());
+        auto fila = [&](const char* nombre, size_t pares, double seg) {
+            printf("M=%-6d %-20s %12zu %10.1f\n", M, nombre, pares, seg * 1e3);
+        };
+
+        auto t0 = Reloj::now();
+        size_t pares = 0;
+        vector<RStarTree2D<int>::Resultado> buf;
+        for (const auto& [x, y, i] : pickups) {
+            buf.clear();
+            b.buscarRango(Caja(x - d, y - d, x + d, y + d), buf);
+            for (const auto& r : buf) pares += (r.x - x) * (r.x - x) + (r.y - y) * (r.y - y) <= d * d;
+        }
+        fila("buscarRango x punto", pares, segundosDesde(t0));
+
+        JoinEspacial<int, int> join(a, b);
+        t0 = Reloj::now();
+        pares = 0;
+        join.unir(d, [&](uint32_t, uint32_t) { pares++; });
+        fila("join", pares, segundosDesde(t0));
+
+        vector<size_t> porHilo(pool.hilos() * 8);   // contadores separados por linea de cache
+        t0 = Reloj::now();
+        join.unir(d, pool, [&](uint32_t, uint32_t, unsigned h) { porHilo[h * 8]++; });
+        double seg = segundosDesde(t0);
+        pares = 0;
+        for (size_t c : porHilo) pares += c;
+        fila("join paralelo", pares, seg);
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+// Escalado de ConsultasLote: consultas/segundo de consultarLote y
+// kVecinosLote con 1..N hilos sobre los sinteticos de 100k y 5M puntos.
+// N = argv[1] (por defecto los nucleos de la maquina). Compilar y correr:
+// make bench
+#include "../consultas_lote.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+static double segundosDesde(Reloj::time_point t0) {
+    return chrono::duration<double>(Reloj::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    unsigned maxHilos = argc > 1 ? (unsigned)atoi(argv[1]) : thread::hardware_concurrency();
+    if (maxHilos == 0) maxHilos = 1;
+    vector<unsigned> hilos;
+    for (unsigned h = 1; h < maxHilos; h *= 2) hilos.push_back(h);
+    hilos.push_back(maxHilos);
+    printf("nucleos de la maquina: %u\n", thread::hardware_concurrency());
+
+    mt19937 gen(42);
+    uniform_real_distribution<double> dLat(40.55, 40.95), dLon(-74.10, -73.70);
+    const int CONSULTAS = 20000;
+
+    for (int n : {100000, 5000000}) {
+        vector<tuple<double, double, int>> pts(n);
+        for (int i = 0; i < n; i++) pts[i] = {dLat(gen), dLon(gen), i};
+        RStarTree2D<int> arbol;
+        arbol.cargarMasivo(pts.begin(), pts.end());
+        vector<Caja> cajas;
+        vector<ConsultasLote<int>::Punto> puntos;
+        // ~100 aciertos por caja en ambos tamanos: lado proporcional a 1/sqrt(n)
+        double lado = 0.4 * sqrt(100.0 / n);
+        for (int i = 0; i < CONSULTAS; i++) {
+            double lat = dLat(gen), lon = dLon(gen);
+            cajas.push_back(Caja(lat, lon, lat + lado, lon + lado));
+            puntos.push_back({lat, lon});
+        }
+
+        printf("\nN = %d, %d consultas por lote\n", n, CONSULTAS);
+        printf("%6s %14s %9s %14s %9s\n", "hilos", "rango cons/s", "speedup", "knn10 cons/s", "speedup");
+        double base[2] = {0, 0};
+        for (unsigned h : hilos) {
+            ConsultasLote<int> motor(arbol, h);
+            double seg[2] = {1e30, 1e30};
+            size_t aciertos = 0;
+            for (int ronda = 0; ronda < 3; ronda++) {   // mejor de 3 rondas
+                auto t0 = Reloj::now();
+                auto r = motor.consultarLote(cajas);
+                seg[0] = min(seg[0], segundosDesde(t0));
+                aciertos = 0;
+                for (const auto& tramo : r) aciertos += tramo.size();
+                t0 = Reloj::now();
+                motor.kVecinosLote(puntos, 10);
+                seg[1] = min(seg[1], segundosDesde(t0));
+            }
+            double qps[2] = {CONSULTAS / seg[0], CONSULTAS / seg[1]};
+            if (h == 1) { base[0] = qps[0]; base[1] = qps[1]; }
+            printf("%6u %14.0f %8.2fx %14.0f %8.2fx   (%zu aciertos)\n", h, qps[0], qps[0] / base[0],
+                   qps[1], qps[1] / base[1], aciertos);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Objetos en movimiento: V vehiculos (argv[1], default 20000) sobre un
+// fondo de 1M viajes estilo taxi cargados con STR reportan posicion en
+// rondas (argv[2], default 10); cada reporte mueve el vehiculo ~50 m.
+// Actualizaciones por segundo con eliminar + insertar (la API de antes, el
+// idx cambia) y con mover, con M = 1200 (default del arbol) y M = 32.
+// Compilar y correr: make bench
+#include "../rstartree.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    int v = argc > 1 ? atoi(argv[1]) : 20000;
+    int rondas = argc > 2 ? atoi(argv[2]) : 10;
+    const int FONDO = 1000000;
+    mt19937 gen(22);
+    uniform_real_distribution<double> u(0.0, 1.0);
+    normal_distribution<double> g(0.0, 1.0);
+    const double focos[][3] = {{40.758, -73.985, 0.012}, {40.712, -74.006, 0.008},
+                               {40.641, -73.778, 0.006}, {40.777, -73.872, 0.005}};
+    auto punto = [&](int i) {
+        const double* f = focos[i % 4];
+        return u(gen) < 0.2 ? make_pair(40.55 + 0.4 * u(gen), -74.10 + 0.4 * u(gen))
+                            : make_pair(f[0] + g(gen) * f[2], f[1] + g(gen) * f[2]);
+    };
+    vector<tuple<double, double, int>> fondo(FONDO);
+    for (int i = 0; i < FONDO; i++) {
+        auto [x, y] = punto(i);
+        fondo[i] = {x, y, -1};
+    }
+    vector<pair<double, double>> inicio(v);
+    for (int i = 0; i < v; i++) inicio[i] = punto(i);
+    // trayectorias: el mismo recorrido para las dos variantes
+    vector<vector<pair<double, double>>> recorrido(rondas, vector<pair<double, double>>(v));
+    vector<pair<double, double>> pos = inicio;
+    for (int r = 0; r < rondas; r++)
+        for (int i = 0; i < v; i++) {
+            pos[i].first += g(gen) * 0.00035;
+            pos[i].second += g(gen) * 0.00035;
+            recorrido[r][i] = pos[i];
+        }
+
+    printf("%d vehiculos, %d rondas, fondo de %d viajes\n", v, rondas, FONDO);
+    printf("%-8s %-18s %12s %14s\n", "", "", "act/s", "overlap/raiz");
+    for (int M : {1200, 32}) {
+        for (bool conMover : {false, true}) {
+            RStarTree2D<int> arbol(M, M * 2 / 5);
+            arbol.cargarMasivo(fondo.begin(), fondo.end());
+            vector<uint32_t> idx(v);
+            for (int i = 0; i < v; i++) idx[i] = arbol.insertar(inicio[i].first, inicio[i].second, i);
+            if (conMover) arbol.activarUbicaciones();
+            vector<pair<double, double>> actual = inicio;
+            auto t0 = Reloj::now();
+            for (int r = 0; r < rondas; r++) {
+                for (int i = 0; i < v; i++) {
+                    auto [nx, ny] = recorrido[r][i];
+                    if (conMover) {
+                        arbol.mover(idx[i], nx, ny);
+                    } else {
+                        arbol.eliminar(actual[i].first, actual[i].second, [&](const int& d) { return d == i; });
+                        idx[i] = arbol.insertar(nx, ny, i);
+                    }
+                    actual[i] = {nx, ny};
+                }
+            }
+            double seg = chrono::duration<double>(Reloj::now() - t0).count();
+            auto c = arbol.calidad();
+            printf("M=%-6d %-18s %12.0f %14.4f\n", M, conMover ? "mover" : "eliminar+insertar",
+                   (double)v * rondas / seg, c.overlap / c.areaRaiz);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+// Caja + ventana de tiempo: RStarTree2D (caja espacial y filtro de tiempo
+// sobre el dato) contra RStarTree<T, 3> con el tiempo como tercer eje.
+// N viajes (argv[1], default 2000000) repartidos en 30 dias; consultas de
+// una caja de ~1% del area y ventanas de 1 hora y de 1 dia. Ambos arboles
+// con cargarMasivo (STR) y M = 64. Compilar y correr: make bench
+#include "../rstartree_nd.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+static double segundosDesde(Reloj::time_point t0) {
+    return chrono::duration<double>(Reloj::now() - t0).count();
+}
+
+struct Viaje { double hora; uint32_t id; };
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 2000000;
+    const int CONSULTAS = 20000, M = 64, m = 25;
+    mt19937 gen(5);
+    uniform_real_distribution<double> dLat(40.55, 40.95), dLon(-74.10, -73.70), dHora(0.0, 720.0);
+    vector<tuple<double, double, Viaje>> planos(n);
+    vector<pair<RStarTree<Viaje, 3>::Punto, Viaje>> conTiempo(n);
+    for (int i = 0; i < n; i++) {
+        Viaje v{dHora(gen), (uint32_t)i};
+        double lat = dLat(gen), lon = dLon(gen);
+        planos[i] = {lat, lon, v};
+        conTiempo[i] = {{lat, lon, v.hora}, v};
+    }
+    RStarTree2D<Viaje> arbol2(M, m);
+    RStarTree<Viaje, 3> arbol3(M, m);
+    auto t0 = Reloj::now();
+    arbol2.cargarMasivo(planos.begin(), planos.end());
+    double carga2 = segundosDesde(t0);
+    t0 = Reloj::now();
+    arbol3.cargarMasivo(conTiempo.begin(), conTiempo.end());
+    double carga3 = segundosDesde(t0);
+    printf("N = %d, M = %d; cargarMasivo 2D %.2f s, 3D %.2f s\n", n, M, carga2, carga3);
+    printf("%-12s %14s %14s %12s\n", "ventana", "2D + filtro us", "3D us", "aciertos");
+
+    for (double ventana : {1.0, 24.0}) {
+        vector<pair<Caja, double>> consultas;
+        for (int i = 0; i < CONSULTAS; i++) {
+            double lat = dLat(gen), lon = dLon(gen);
+            consultas.push_back({Caja(lat, lon, lat + 0.04, lon + 0.04), dHora(gen)});
+        }
+        vector<RStarTree2D<Viaje>::Resultado> r2;
+        vector<RStarTree<Viaje, 3>::Resultado> r3;
+        size_t aciertos2 = 0, aciertos3 = 0;
+        t0 = Reloj::now();
+        for (auto& [c, h] : consultas) {
+            r2.clear();
+            arbol2.buscarRango(c, r2);
+            for (auto& e : r2) {
+                double hora = arbol2.dato(e.idx).hora;
+                aciertos2 += hora >= h && hora <= h + ventana;
+            }
+        }
+        double us2 = segundosDesde(t0) * 1e6 / CONSULTAS;
+        t0 = Reloj::now();
+        for (auto& [c, h] : consultas) {
+            r3.clear();
+            arbol3.buscarRango(CajaN<3>({c.lo[0], c.lo[1], h}, {c.hi[0], c.hi[1], h + ventana}), r3);
+            aciertos3 += r3.size();
+        }
+        double us3 = segundosDesde(t0) * 1e6 / CONSULTAS;
+        printf("%9.0f h %14.2f %14.2f %12zu%s\n", ventana, us2, us3, aciertos3,
+               aciertos2 == aciertos3 ? "" : "  (RESULTADOS DISTINTOS)");
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+// Benchmark del layout de nodos: throughput de insertar, latencia de
+// buscarRango (con fallos de cache si el kernel expone perf_event) y tiempo
+// de destruccion del arbol. Compilar y correr: make bench
+#include "../rstartree.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <sys/ioctl.h>
+#endif
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+static double segundosDesde(Reloj::time_point t0) {
+    return chrono::duration<double>(Reloj::now() - t0).count();
+}
+
+// Contador de fallos de cache del proceso; -1 si el kernel no lo permite
+struct ContadorFallos {
+    int fd = -1;
+    ContadorFallos() {
+#ifdef __linux__
+        perf_event_attr a;
+        memset(&a, 0, sizeof a);
+        a.type = PERF_TYPE_HARDWARE;
+        a.size = sizeof a;
+        a.config = PERF_COUNT_HW_CACHE_MISSES;
+        a.disabled = 1;
+        a.exclude_kernel = 1;
+        fd = (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+#endif
+    }
+    ~ContadorFallos() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+    void iniciar() {
+#ifdef __linux__
+        if (fd >= 0) { ioctl(fd, PERF_EVENT_IOC_RESET, 0); ioctl(fd, PERF_EVENT_IOC_ENABLE, 0); }
+#endif
+    }
+    long long leer() {
+        long long v = -1;
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &v, sizeof v) != sizeof v) v = -1;
+        }
+#endif
+        return v;
+    }
+};
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 300000;
+    mt19937 gen(42);
+    uniform_real_distribution<double> dLat(40.55, 40.95), dLon(-74.10, -73.70);
+    vector<pair<double, double>> pts(n);
+    for (auto& p : pts) p = {dLat(gen), dLon(gen)};
+    vector<Caja> consultas;
+    for (int i = 0; i < 5000; i++) {
+        double lat = dLat(gen), lon = dLon(gen);
+        consultas.push_back(Caja(lat, lon, lat + 0.02, lon + 0.02));
+    }
+    printf("N = %d, m = 40%% de M\n", n);
+
+    for (int M : {1200, 64}) {
+        auto* arbol = new RStarTree2D<int>(M, M * 2 / 5);
+        auto t0 = Reloj::now();
+        for (int i = 0; i < n; i++) arbol->insertar(pts[i].first, pts[i].second, i);
+        double segIns = segundosDesde(t0);
+
+        // mejor de 3 rondas: la maquina compartida mete ruido
+        ContadorFallos fallos;
+        size_t hallados = 0;
+        double segRango = 1e30;
+        long long f = -1;
+        for (int ronda = 0; ronda < 3; ronda++) {
+            hallados = 0;
+            fallos.iniciar();
+            t0 = Reloj::now();
+            for (const Caja& q : consultas) hallados += arbol->buscarRango(q).size();
+            double seg = segundosDesde(t0);
+            long long fr = fallos.leer();
+            if (seg < segRango) { segRango = seg; f = fr; }
+        }
+
+        double segContar = 1e30;
+        size_t contados = 0;
+        for (int ronda = 0; ronda < 3; ronda++) {
+            contados = 0;
+            t0 = Reloj::now();
+            for (const Caja& q : consultas) contados += arbol->contarEnRango(q);
+            segContar = min(segContar, segundosDesde(t0));
+        }
+
+        double segKnn = 1e30;
+        volatile size_t vecinos = 0;   // que el optimizador no descarte las consultas
+        for (int ronda = 0; ronda < 3; ronda++) {
+            t0 = Reloj::now();
+            for (const Caja& q : consultas) vecinos += arbol->kVecinos(q.lo[0], q.lo[1], 10).size();
+            segKnn = min(segKnn, segundosDesde(t0));
+        }
+
+        t0 = Reloj::now();
+        delete arbol;
+        double segDel = segundosDesde(t0);
+
+        printf("M=%-5d insertar %9.0f pts/s   rango %7.1f us/consulta (%zu)   contar %5.1f us (%zu)   knn10 %6.1f us/consulta   "
+               "fallos cache/rango %s   destruir %.2f ms\n",
+               M, n / segIns, 1e6 * segRango / consultas.size(), hallados,
+               1e6 * segContar / consultas.size(), contados, 1e6 * segKnn / consultas.size(),
+               f < 0 ? "n/d" : to_string(f / (long long)consultas.size()).c_str(), 1e3 * segDel);
+    }
+    return 0;
+}
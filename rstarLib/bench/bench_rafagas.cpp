@@ -0,0 +1,59 @@
+// Rafagas del feed en vivo: sobre N puntos cargados con STR (argv[1],
+// default 1000000), 5 rafagas de B viajes estilo taxi (argv[2], default
+// 20000) insertadas con un ciclo de insertar o con insertarLote, con
+// M = 1200 (default del arbol) y M = 32. Reporta inserciones por segundo y
+// la calidad del arbol resultante (ocupacion, overlap relativo a la raiz).
+// Compilar y correr: make bench
+#include "../rstartree.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+using Viajes = vector<tuple<double, double, int>>;
+
+static Viajes generar(int n, int base, mt19937& gen) {
+    uniform_real_distribution<double> u(0.0, 1.0);
+    normal_distribution<double> g(0.0, 1.0);
+    const double focos[][3] = {{40.758, -73.985, 0.012}, {40.712, -74.006, 0.008},
+                               {40.641, -73.778, 0.006}, {40.777, -73.872, 0.005}};
+    Viajes v(n);
+    for (int i = 0; i < n; i++) {
+        const double* f = focos[i % 4];
+        v[i] = u(gen) < 0.2 ? make_tuple(40.55 + 0.4 * u(gen), -74.10 + 0.4 * u(gen), base + i)
+                            : make_tuple(f[0] + g(gen) * f[2], f[1] + g(gen) * f[2], base + i);
+    }
+    return v;
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 1000000;
+    int b = argc > 2 ? atoi(argv[2]) : 20000;
+    const int RAFAGAS = 5;
+    mt19937 gen(19);
+    Viajes base = generar(n, 0, gen);
+    vector<Viajes> rafagas;
+    for (int r = 0; r < RAFAGAS; r++) rafagas.push_back(generar(b, n + r * b, gen));
+
+    printf("N = %d, %d rafagas de %d\n", n, RAFAGAS, b);
+    printf("%-8s %-12s %12s %10s %12s\n", "", "", "ins/s", "ocupacion", "overlap/raiz");
+    for (int M : {1200, 32}) {
+        for (bool porLote : {false, true}) {
+            RStarTree2D<int> arbol(M, M * 2 / 5);
+            arbol.cargarMasivo(base.begin(), base.end());
+            auto t0 = Reloj::now();
+            for (const Viajes& r : rafagas) {
+                if (porLote) arbol.insertarLote(r.begin(), r.end());
+                else for (const auto& [x, y, d] : r) arbol.insertar(x, y, d);
+            }
+            double seg = chrono::duration<double>(Reloj::now() - t0).count();
+            auto c = arbol.calidad();
+            printf("M=%-6d %-12s %12.0f %10.3f %12.4f\n", M, porLote ? "insertarLote" : "insertar",
+                   (double)RAFAGAS * b / seg, c.ocupacion, c.overlap / c.areaRaiz);
+        }
+    }
+    return 0;
+}
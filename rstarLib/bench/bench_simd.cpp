@@ -0,0 +1,64 @@
+// Microbenchmark de los nucleos de filtrado de hojas: entradas/segundo por
+// nucleo (escalar, SSE2, AVX2) con los tamanos de hoja del arbol.
+// Compilar y correr: make bench
+#include "../filtro_hojas.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+
+struct Nucleo {
+    const char* nombre;
+    NucleoSimd tipo;
+    uint32_t (*filtrar)(const double*, const double*, uint32_t, double, double, double, double, uint32_t*);
+    void (*distancias)(const double*, const double*, uint32_t, double, double, double*);
+};
+
+int main() {
+    vector<Nucleo> nucleos = {{"escalar", NucleoSimd::Escalar, filtrarCajaEscalar, distancias2Escalar}};
+#ifdef RSTAR_SIMD_X86
+    nucleos.push_back({"sse2", NucleoSimd::SSE2, filtrarCajaSSE2, distancias2SSE2});
+    nucleos.push_back({"avx2", NucleoSimd::AVX2, filtrarCajaAVX2, distancias2AVX2});
+#endif
+    mt19937 gen(1);
+    uniform_real_distribution<double> u(0.0, 1.0);
+    const uint64_t ENTRADAS = 200000000;   // por medicion
+
+    printf("%-8s %6s %12s %14s\n", "nucleo", "hoja", "selectividad", "Mentradas/s");
+    for (uint32_t tam : {64u, 480u, 1200u}) {
+        vector<double> xs(tam), ys(tam), d2(tam + 4);
+        vector<uint32_t> salida(tam + 4);
+        for (uint32_t i = 0; i < tam; i++) { xs[i] = u(gen); ys[i] = u(gen); }
+        for (const Nucleo& nuc : nucleos) {
+            if (!simdSoporta(nuc.tipo)) continue;
+            // lado de la caja = sqrt(selectividad): 1%, 25%, 100% de la hoja
+            for (double lado : {0.1, 0.5, 1.0}) {
+                uint64_t vueltas = ENTRADAS / tam, total = 0;
+                auto t0 = Reloj::now();
+                for (uint64_t v = 0; v < vueltas; v++) {
+                    double x0 = (1.0 - lado) * (double)(v % 7) / 7.0;
+                    total += nuc.filtrar(xs.data(), ys.data(), tam, x0, x0, x0 + lado, x0 + lado, salida.data());
+                }
+                double seg = chrono::duration<double>(Reloj::now() - t0).count();
+                printf("%-8s %6u %11.0f%% %14.0f   (rango, %llu aciertos)\n", nuc.nombre, tam,
+                       100.0 * lado * lado, vueltas * tam / seg / 1e6, (unsigned long long)total);
+            }
+            uint64_t vueltas = ENTRADAS / tam;
+            double suma = 0;
+            auto t0 = Reloj::now();
+            for (uint64_t v = 0; v < vueltas; v++) {
+                nuc.distancias(xs.data(), ys.data(), tam, 0.001 * (v % 100), 0.5, d2.data());
+                suma += d2[v % tam];
+            }
+            double seg = chrono::duration<double>(Reloj::now() - t0).count();
+            printf("%-8s %6u %12s %14.0f   (distancias2, %.0f)\n", nuc.nombre, tam, "-",
+                   vueltas * tam / seg / 1e6, suma);
+        }
+    }
+    printf("nucleo activo: %s\n", nucleoSimdActivo() == NucleoSimd::AVX2 ? "avx2"
+                                : nucleoSimdActivo() == NucleoSimd::SSE2 ? "sse2" : "escalar");
+    return 0;
+}
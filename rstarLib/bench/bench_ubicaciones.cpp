@@ -0,0 +1,67 @@
+// eliminar(x, y, pred) contra eliminarPorIdx con el mapa idx -> hoja: N
+// viajes estilo taxi (argv[1], default 1000000) cargados con STR, la mitad
+// con coordenadas repetidas de 500 paradas (como los pickups de aeropuertos
+// y estaciones), y 20000 eliminaciones de idx al azar, con M = 1200
+// (default del arbol) y M = 32. Compilar y correr: make bench
+#include "../rstartree.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+static double segundosDesde(Reloj::time_point t0) {
+    return chrono::duration<double>(Reloj::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 1000000;
+    const int QUITAR = 20000, PARADAS = 500;
+    mt19937 gen(21);
+    uniform_real_distribution<double> u(0.0, 1.0);
+    normal_distribution<double> g(0.0, 1.0);
+    const double focos[][3] = {{40.758, -73.985, 0.012}, {40.712, -74.006, 0.008},
+                               {40.641, -73.778, 0.006}, {40.777, -73.872, 0.005}};
+    auto punto = [&](int i) {
+        const double* f = focos[i % 4];
+        return u(gen) < 0.2 ? make_pair(40.55 + 0.4 * u(gen), -74.10 + 0.4 * u(gen))
+                            : make_pair(f[0] + g(gen) * f[2], f[1] + g(gen) * f[2]);
+    };
+    vector<pair<double, double>> paradas(PARADAS);
+    for (int i = 0; i < PARADAS; i++) paradas[i] = punto(i);
+    vector<tuple<double, double, int>> pts(n);
+    for (int i = 0; i < n; i++) {
+        auto [x, y] = u(gen) < 0.5 ? paradas[gen() % PARADAS] : punto(i);
+        pts[i] = {x, y, i};
+    }
+    vector<uint32_t> quitar(n);
+    for (int i = 0; i < n; i++) quitar[i] = i;
+    shuffle(quitar.begin(), quitar.end(), gen);
+    quitar.resize(QUITAR);
+
+    printf("N = %d, %d eliminaciones\n%-8s %-16s %12s %12s\n", n, QUITAR, "", "", "us/elim", "activar ms");
+    for (int M : {1200, 32}) {
+        {
+            RStarTree2D<int> arbol(M, M * 2 / 5);
+            arbol.cargarMasivo(pts.begin(), pts.end());
+            auto t0 = Reloj::now();
+            for (uint32_t i : quitar)
+                arbol.eliminar(get<0>(pts[i]), get<1>(pts[i]), [&](const int& d) { return d == (int)i; });
+            printf("M=%-6d %-16s %12.2f %12s\n", M, "eliminar", segundosDesde(t0) * 1e6 / QUITAR, "-");
+        }
+        {
+            RStarTree2D<int> arbol(M, M * 2 / 5);
+            arbol.cargarMasivo(pts.begin(), pts.end());
+            auto t0 = Reloj::now();
+            arbol.activarUbicaciones();
+            double activar = segundosDesde(t0);
+            t0 = Reloj::now();
+            for (uint32_t i : quitar) arbol.eliminarPorIdx(i);
+            printf("M=%-6d %-16s %12.2f %12.1f\n", M, "eliminarPorIdx", segundosDesde(t0) * 1e6 / QUITAR,
+                   activar * 1e3);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+// Vencimiento de viajes: N viajes estilo taxi (argv[1], default 500000)
+// repartidos en 10 dias, cargados con STR. Se vencen los V dias mas viejos
+// (argv[2], default 1; por idx) y una franja de longitud con la misma
+// fraccion de los puntos, con un ciclo de eliminar(x, y, pred) o con
+// eliminarLote / eliminarEnRango, con M = 1200 (default del arbol) y M = 32.
+// Compilar y correr: make bench
+#include "../rstartree.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+static double segundosDesde(Reloj::time_point t0) {
+    return chrono::duration<double>(Reloj::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 500000;
+    int vencidos = argc > 2 ? atoi(argv[2]) : 1;
+    const int DIAS = 10;
+    mt19937 gen(20);
+    uniform_real_distribution<double> u(0.0, 1.0);
+    normal_distribution<double> g(0.0, 1.0);
+    const double focos[][3] = {{40.758, -73.985, 0.012}, {40.712, -74.006, 0.008},
+                               {40.641, -73.778, 0.006}, {40.777, -73.872, 0.005}};
+    vector<tuple<double, double, int>> pts(n);   // dato = dia
+    for (int i = 0; i < n; i++) {
+        const double* f = focos[i % 4];
+        int dia = i * DIAS / n;
+        pts[i] = u(gen) < 0.2 ? make_tuple(40.55 + 0.4 * u(gen), -74.10 + 0.4 * u(gen), dia)
+                              : make_tuple(f[0] + g(gen) * f[2], f[1] + g(gen) * f[2], dia);
+    }
+    // franja de longitud con la misma fraccion de los puntos
+    size_t corte = (size_t)n * vencidos / DIAS;
+    vector<double> lons(n);
+    for (int i = 0; i < n; i++) lons[i] = get<1>(pts[i]);
+    nth_element(lons.begin(), lons.begin() + corte, lons.end());
+    Caja franja(-90, -180, 90, lons[corte]);
+
+    printf("N = %d, %d de %d dias vencidos\n", n, vencidos, DIAS);
+    printf("%-8s %-22s %10s %10s %12s\n", "", "", "quitados", "ms", "quitados/s");
+    for (int M : {1200, 32}) {
+        auto fila = [&](const char* nombre, auto&& vencer) {
+            RStarTree2D<int> arbol(M, M * 2 / 5);
+            arbol.cargarMasivo(pts.begin(), pts.end());
+            auto t0 = Reloj::now();
+            size_t q = vencer(arbol);
+            double seg = segundosDesde(t0);
+            printf("M=%-6d %-22s %10zu %10.2f %12.0f\n", M, nombre, q, seg * 1e3, q / seg);
+        };
+        // los dias vencidos son los idx [0, corte)
+        fila("dias: eliminar x1", [&](RStarTree2D<int>& a) {
+            size_t q = 0;
+            for (size_t i = 0; i < corte; i++)
+                q += a.eliminar(get<0>(pts[i]), get<1>(pts[i]), [&](const int& d) { return d < vencidos; });
+            return q;
+        });
+        fila("dias: eliminarLote", [&](RStarTree2D<int>& a) {
+            vector<uint32_t> idxs;
+            for (size_t i = 0; i < corte; i++) idxs.push_back((uint32_t)i);
+            return a.eliminarLote(idxs);
+        });
+        fila("franja: eliminar x1", [&](RStarTree2D<int>& a) {
+            size_t q = 0;
+            for (int i = 0; i < n; i++)
+                if (franja.contiene(get<0>(pts[i]), get<1>(pts[i])))
+                    q += a.eliminar(get<0>(pts[i]), get<1>(pts[i]), [](const int&) { return true; });
+            return q;
+        });
+        fila("franja: eliminarEnRango", [&](RStarTree2D<int>& a) { return a.eliminarEnRango(franja); });
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+// Ventana deslizante: N viajes estilo taxi (argv[1], default 500000)
+// cargados con STR; en cada una de R rondas (argv[2], default 20) entra una
+// rafaga de N/10 viajes con insertarLote y vence la rafaga mas vieja con
+// eliminarLote, asi el indice se mantiene en N puntos. Sin reuso la arena
+// crece con cada rafaga; con activarReuso queda en el pico de la ventana.
+// Al final compactar() deja la arena en el orden de las hojas: tiempo de
+// compactar y de una pasada de rango que lee cada dato (64 bytes, como un
+// viaje con sus campos), antes y despues.
+// Con M = 1200 (default del arbol) y M = 32. Compilar y correr: make bench
+#include "../rstartree.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+using namespace std;
+
+using Reloj = chrono::steady_clock;
+struct Viaje { int id; float campos[15]; };
+using Viajes = vector<tuple<double, double, Viaje>>;
+static double segundosDesde(Reloj::time_point t0) {
+    return chrono::duration<double>(Reloj::now() - t0).count();
+}
+
+static Viajes generar(int n, int base, mt19937& gen) {
+    uniform_real_distribution<double> u(0.0, 1.0);
+    normal_distribution<double> g(0.0, 1.0);
+    const double focos[][3] = {{40.758, -73.985, 0.012}, {40.712, -74.006, 0.008},
+                               {40.641, -73.778, 0.006}, {40.777, -73.872, 0.005}};
+    Viajes v(n);
+    for (int i = 0; i < n; i++) {
+        const double* f = focos[i % 4];
+        Viaje d{base + i, {}};
+        v[i] = u(gen) < 0.2 ? make_tuple(40.55 + 0.4 * u(gen), -74.10 + 0.4 * u(gen), d)
+                            : make_tuple(f[0] + g(gen) * f[2], f[1] + g(gen) * f[2], d);
+    }
+    return v;
+}
+
+// Suma un campo de cada dato en 2000 cajas de ~1 km: mide la localidad de
+// la arena (los idx de una hoja caen en la misma zona de memoria o no)
+static double pasadaRango(const RStarTree2D<Viaje>& arbol, mt19937& gen, long& suma) {
+    uniform_real_distribution<double> u(0.0, 1.0);
+    vector<RStarTree2D<Viaje>::Resultado> buf;
+    auto t0 = Reloj::now();
+    for (int q = 0; q < 2000; q++) {
+        double x = 40.70 + 0.08 * u(gen), y = -74.02 + 0.06 * u(gen);
+        buf.clear();
+        arbol.buscarRango(Caja(x, y, x + 0.01, y + 0.01), buf);
+        for (const auto& r : buf) suma += arbol.dato(r.idx).id;
+    }
+    return segundosDesde(t0);
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 500000;
+    int rondas = argc > 2 ? atoi(argv[2]) : 20;
+    int b = n / 10;
+    mt19937 gen(23);
+    Viajes base = generar(n, 0, gen);
+    vector<Viajes> rafagas;
+    for (int r = 0; r < rondas; r++) rafagas.push_back(generar(b, n + r * b, gen));
+
+    printf("N = %d, %d rondas de %d\n", n, rondas, b);
+    printf("%-8s %-10s %10s %10s %12s %12s %12s\n", "", "", "ronda ms", "arena", "compactar ms",
+           "rango antes", "rango despues");
+    long suma = 0;
+    for (int M : {1200, 32}) {
+        for (bool reuso : {false, true}) {
+            RStarTree2D<Viaje> arbol(M, M * 2 / 5);
+            arbol.cargarMasivo(base.begin(), base.end());
+            if (reuso) arbol.activarReuso();
+            // idx de cada rafaga viva, de la mas vieja a la mas nueva
+            vector<vector<uint32_t>> vivas(10);
+            for (int i = 0; i < n; i++) vivas[i / b].push_back((uint32_t)i);
+            auto t0 = Reloj::now();
+            for (const Viajes& r : rafagas) {
+                vector<uint32_t> idxs;
+                arbol.insertarLote(r.begin(), r.end(), idxs);
+                arbol.eliminarLote(vivas.front());
+                vivas.erase(vivas.begin());
+                vivas.push_back(move(idxs));
+            }
+            double ronda = segundosDesde(t0) / rondas;
+            size_t arena = arbol.tamanoArena();
+            mt19937 genConsulta(7);
+            double antes = pasadaRango(arbol, genConsulta, suma);
+            t0 = Reloj::now();
+            arbol.compactar();
+            double compactar = segundosDesde(t0);
+            genConsulta.seed(7);
+            double despues = pasadaRango(arbol, genConsulta, suma);
+            printf("M=%-6d %-10s %10.1f %10zu %12.1f %10.2f ms %10.2f ms\n", M, reuso ? "reuso" : "tombstone",
+                   ronda * 1e3, arena, compactar * 1e3, antes * 1e3, despues * 1e3);
+        }
+    }
+    return suma == 42 ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+// Motor de consultas por lote sobre un arbol compartido de solo lectura:
+// miles de buscarRango / kVecinos independientes repartidos en un pool fijo
+// de hilos. Cada hilo tiene su memoria de trabajo (buffer de aciertos y
+// BufferVecinos) que se reusa entre lotes, y cada consulta escribe solo en
+// su propio tramo del resultado: no hay candados en el camino de consulta.
+// Los hilos toman bloques de consultas de su tramo y roban a los demas al
+// quedarse sin trabajo, asi un lote con consultas de costo dispar se
+// reparte solo (ver pool_hilos.hpp).
+// El arbol NO debe modificarse mientras corre un lote.
+#include "rstartree.hpp"   // incluye pool_hilos.hpp
+
+template <typename T>
+class ConsultasLote {
+public:
+    using Arbol = RStarTree2D<T>;
+    using Resultado = typename Arbol::Resultado;
+    struct Punto { double x, y; };
+
+    // Aciertos de una consulta: tramo contiguo dentro del buffer de un hilo
+    struct Tramo {
+        const Resultado* ini = nullptr;
+        const Resultado* fin = nullptr;
+        const Resultado* begin() const { return ini; }
+        const Resultado* end() const { return fin; }
+        size_t size() const { return (size_t)(fin - ini); }
+        bool empty() const { return ini == fin; }
+        const Resultado& operator[](size_t i) const { return ini[i]; }
+    };
+
+    ConsultasLote(const Arbol& arbol, unsigned hilos = std::thread::hardware_concurrency())
+        : arbol_(arbol), pool_(hilos), porHilo_(pool_.hilos()) {}
+
+    unsigned hilos() const { return pool_.hilos(); }
+
+    // Rango de cada caja. El resultado i son los aciertos de cajas[i]; los
+    // tramos apuntan a memoria del motor y valen hasta el proximo lote.
+    std::vector<Tramo> consultarLote(const Caja* cajas, size_t n) {
+        struct Ubicacion { unsigned hilo; size_t ini, fin; };
+        std::vector<Ubicacion> ubic(n);
+        for (auto& b : porHilo_) b.aciertos.clear();
+        pool_.paraCada(n, BLOQUE, [&](size_t i, unsigned h) {
+            auto& a = porHilo_[h].aciertos;
+            size_t ini = a.size();
+            arbol_.buscarRango(cajas[i], a);
+            ubic[i] = {h, ini, a.size()};   // cada consulta escribe solo su casilla
+        });
+        // los buffers ya no crecen: recien ahora los indices pasan a punteros
+        std::vector<Tramo> res(n);
+        for (size_t i = 0; i < n; i++) {
+            const Resultado* base = porHilo_[ubic[i].hilo].aciertos.data();
+            res[i] = {base + ubic[i].ini, base + ubic[i].fin};
+        }
+        return res;
+    }
+    std::vector<Tramo> consultarLote(const std::vector<Caja>& cajas) {
+        return consultarLote(cajas.data(), cajas.size());
+    }
+
+    // k vecinos de cada punto. Cada consulta tiene reservadas k casillas de
+    // un arreglo plano; el tramo i son los vecinos de puntos[i], del mas
+    // cercano al mas lejano. Valen hasta el proximo lote.
+    std::vector<Tramo> kVecinosLote(const Punto* puntos, size_t n, int k) {
+        std::vector<Tramo> res(n);
+        if (k <= 0) return res;
+        size_t kk = std::min((size_t)k, arbol_.tamano());
+        vecinos_.resize(n * kk);
+        pool_.paraCada(n, BLOQUE, [&](size_t i, unsigned h) {
+            Resultado* s = vecinos_.data() + i * kk;
+            size_t c = arbol_.kVecinos(puntos[i].x, puntos[i].y, k, porHilo_[h].buf, s);
+            res[i] = {s, s + c};
+        });
+        return res;
+    }
+    std::vector<Tramo> kVecinosLote(const std::vector<Punto>& puntos, int k) {
+        return kVecinosLote(puntos.data(), puntos.size(), k);
+    }
+
+private:
+    static constexpr size_t BLOQUE = 16;   // consultas por toma de un tramo
+
+    // alineado a linea de cache: los hilos no comparten lineas al escribir
+    struct alignas(64) MemoriaHilo {
+        std::vector<Resultado> aciertos;
+        typename Arbol::BufferVecinos buf;
+    };
+
+    const Arbol& arbol_;
+    PoolHilos pool_;
+    std::vector<MemoriaHilo> porHilo_;
+    std::vector<Resultado> vecinos_;
+};
@@ -0,0 +1,147 @@
+#pragma once
+// DBSCAN (Ester, Kriegel, Sander y Xu 1996) sobre el indice ya armado, en
+// lugar del clustering geografico en Python (sklearn): los vecinos a <= eps
+// de todos los puntos salen del auto-join del arbol (JoinEspacial), y los
+// clusters de una union-find sin candados sobre los pares de nucleos
+// vecinos, sin materializar las listas de vecinos.
+// Nucleo y ruido se definen como en sklearn.cluster.DBSCAN: un punto es
+// nucleo si tiene al menos minPts puntos a <= eps contandose a si mismo, y
+// es ruido si no es nucleo ni vecino de uno. Los bordes difieren a
+// proposito: sklearn les da el cluster que los alcanza primero al
+// expandir, que depende del orden; aca un borde toma el cluster de su
+// nucleo vecino de menor idx, asi el resultado no depende de los hilos.
+// Un borde vecino de dos clusters puede quedar en otro que con sklearn.
+// Los clusters se numeran 0..k-1 por su menor idx y la etiqueta se
+// escribe en la arena con poner(dato, etiqueta). Con un PoolHilos, el
+// join, la union-find y el etiquetado se reparten en el pool.
+// Escribir en la arena no renueva versiones: un GruposPorHoja que agrupa
+// por esta etiqueta se rearma con construir().
+//   Dbscan<Viaje> dbscan(arbol);
+//   dbscan.etiquetar(0.0005, 20, pool, [](Viaje& v, int32_t c) { v.cluster = c; });
+#include "join_espacial.hpp"
+#include <atomic>
+
+template <typename T>
+class Dbscan {
+public:
+    static constexpr int32_t RUIDO = -1;
+
+    explicit Dbscan(RStarTree2D<T>& arbol) : arbol_(arbol), join_(arbol) {}
+
+    // Corre DBSCAN y etiqueta cada punto del arbol; devuelve cuantos
+    // clusters hallo. El arbol NO debe modificarse mientras corre.
+    // eps < 0 (o NaN) o minPts < 1 lanzan invalid_argument.
+    template <typename Poner>
+    uint32_t etiquetar(double eps, int minPts, Poner poner) {
+        return correr(eps, minPts, nullptr, poner);
+    }
+    template <typename Poner>
+    uint32_t etiquetar(double eps, int minPts, PoolHilos& pool, Poner poner) {
+        return correr(eps, minPts, &pool, poner);
+    }
+
+    // De la ultima corrida, por posicion de la arena. Las posiciones
+    // eliminadas quedan como RUIDO y no se etiquetan. esNucleo es false
+    // antes de etiquetar y para posiciones agregadas despues.
+    const std::vector<int32_t>& etiquetas() const { return etiquetas_; }
+    bool esNucleo(uint32_t idx) const { return idx < nucleo_.size() && nucleo_[idx] != 0; }
+
+private:
+    static constexpr size_t BLOQUE = 1024;   // posiciones por toma de un tramo
+
+    template <typename Poner>
+    uint32_t correr(double eps, int minPts, PoolHilos* pool, Poner& poner) {
+        if (!(eps >= 0)) throw std::invalid_argument("Dbscan: eps debe ser >= 0");
+        if (minPts < 1) throw std::invalid_argument("Dbscan: minPts debe ser >= 1");
+        auto paraCada = [&](size_t n, auto&& f) {
+            if (pool != nullptr) pool->paraCada(n, BLOQUE, [&](size_t i, unsigned) { f((uint32_t)i); });
+            else for (size_t i = 0; i < n; i++) f((uint32_t)i);
+        };
+        auto paraCadaPar = [&](auto&& f) {
+            if (pool != nullptr) join_.unir(eps, *pool, [&](uint32_t i, uint32_t j, unsigned) { f(i, j); });
+            else join_.unir(eps, f);
+        };
+        const size_t n = arbol_.tamanoArena();
+        std::vector<char> vivo(n, 0);
+        arbol_.recorrer([&](const typename RStarTree2D<T>::Resultado& r) { vivo[r.idx] = 1; });
+
+        // Dos pasadas del join en lugar de armar las listas de vecinos:
+        // recorrer el arbol cuesta menos que escribir y ordenar dos veces
+        // cada par. La primera cuenta vecinos para saber quien es nucleo.
+        std::vector<std::atomic<uint32_t>> cuenta(n);
+        paraCada(n, [&](uint32_t i) { cuenta[i].store(0, std::memory_order_relaxed); });
+        paraCadaPar([&](uint32_t i, uint32_t j) {
+            cuenta[i].fetch_add(1, std::memory_order_relaxed);
+            cuenta[j].fetch_add(1, std::memory_order_relaxed);
+        });
+        nucleo_.assign(n, 0);
+        paraCada(n, [&](uint32_t i) {
+            nucleo_[i] = vivo[i] && cuenta[i].load(std::memory_order_relaxed) + 1 >= (size_t)minPts;
+        });
+
+        // La segunda une los nucleos vecinos (la raiz de cada componente es
+        // su menor idx) y guarda para cada borde su nucleo vecino de menor idx
+        std::vector<std::atomic<uint32_t>> padre(n), menorNucleo(n);
+        paraCada(n, [&](uint32_t i) {
+            padre[i].store(i, std::memory_order_relaxed);
+            menorNucleo[i].store(RStarTree2D<T>::SIN_IDX, std::memory_order_relaxed);
+        });
+        paraCadaPar([&](uint32_t i, uint32_t j) {
+            bool ni = nucleo_[i] != 0, nj = nucleo_[j] != 0;
+            if (ni && nj) unir(padre, i, j);
+            else if (ni) bajarA(menorNucleo[j], i);
+            else if (nj) bajarA(menorNucleo[i], j);
+        });
+        std::vector<uint32_t> raizDe(n, RStarTree2D<T>::SIN_IDX);
+        paraCada(n, [&](uint32_t i) {
+            if (nucleo_[i]) { raizDe[i] = raiz(padre, i); return; }
+            uint32_t j = menorNucleo[i].load(std::memory_order_relaxed);
+            if (j != RStarTree2D<T>::SIN_IDX) raizDe[i] = raiz(padre, j);
+        });
+
+        std::vector<int32_t> numero(n, RUIDO);
+        etiquetas_.assign(n, RUIDO);
+        uint32_t k = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint32_t r = raizDe[i];
+            if (r == RStarTree2D<T>::SIN_IDX) continue;
+            if (numero[r] == RUIDO) numero[r] = (int32_t)k++;
+            etiquetas_[i] = numero[r];
+        }
+        paraCada(n, [&](uint32_t i) { if (vivo[i]) poner(arbol_.dato(i), etiquetas_[i]); });
+        return k;
+    }
+
+    // Minimo atomico: deja en m el menor entre su valor y v
+    static void bajarA(std::atomic<uint32_t>& m, uint32_t v) {
+        uint32_t actual = m.load(std::memory_order_relaxed);
+        while (v < actual && !m.compare_exchange_weak(actual, v, std::memory_order_relaxed)) {}
+    }
+
+    // Union-find sin candados: las raices solo se cuelgan de una raiz menor
+    // con un compare-exchange, y find acorta el camino a la mitad
+    static uint32_t raiz(std::vector<std::atomic<uint32_t>>& padre, uint32_t i) {
+        for (;;) {
+            uint32_t p = padre[i].load(std::memory_order_relaxed);
+            if (p == i) return i;
+            uint32_t g = padre[p].load(std::memory_order_relaxed);
+            if (g != p) padre[i].compare_exchange_weak(p, g, std::memory_order_relaxed);
+            i = g;
+        }
+    }
+    static void unir(std::vector<std::atomic<uint32_t>>& padre, uint32_t a, uint32_t b) {
+        for (;;) {
+            a = raiz(padre, a);
+            b = raiz(padre, b);
+            if (a == b) return;
+            if (a < b) std::swap(a, b);
+            uint32_t esperado = a;
+            if (padre[a].compare_exchange_strong(esperado, b)) return;
+        }
+    }
+
+    RStarTree2D<T>& arbol_;
+    JoinEspacial<T, T> join_;
+    std::vector<char> nucleo_;
+    std::vector<int32_t> etiquetas_;
+};
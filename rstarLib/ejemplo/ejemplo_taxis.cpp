@@ -5,6 +5,8 @@
 #include "../grupos_por_hoja.hpp"
 #include <iostream>
 #include <random>
+#include <tuple>
+#include <iterator>
 using namespace std;
 
 struct Taxi {
@@ -21,13 +23,17 @@ int main() {
     uniform_int_distribution<int> dEt(0, 9);
     normal_distribution<double> dPc(0.0, 1.0);
 
-    // FASE CARGA (en un caso real: leidos del .bin ya ordenados por lat/long)
+    // FASE CARGA (en un caso real: leidos del .bin): carga masiva STR,
+    // arma el arbol de abajo hacia arriba sin un insertar por punto
     const int N = 100000;
+    vector<tuple<double, double, Taxi>> entrada;
+    entrada.reserve(N);
     for (int i = 0; i < N; i++) {
         double lat = dLat(gen), lon = dLon(gen);
         int et = dEt(gen);
-        arbol.insertar(lat, lon, Taxi{i, et, {et + dPc(gen) * 0.1, dPc(gen)}, lat, lon});
+        entrada.emplace_back(lat, lon, Taxi{i, et, {et + dPc(gen) * 0.1, dPc(gen)}, lat, lon});
     }
+    arbol.cargarMasivo(make_move_iterator(entrada.begin()), make_move_iterator(entrada.end()));
     cout << "Cargados " << arbol.tamano() << " puntos" << endl;
 
     // FASE PRECOMPUTO (una vez, tras la carga)
@@ -65,5 +71,10 @@ int main() {
     for (auto& v : vecinos) cout << arbol.dato(v.idx).tripID << " ";
     cout << endl;
 
+    // vecinos incrementales con filtro: el mas cercano de etiqueta 3, sin adivinar k
+    auto it = arbol.vecinosIncrementales(40.7528, -73.9765, [](const Taxi& t) { return t.etiqueta == 3; });
+    if (it.siguiente())
+        cout << "Taxi de etiqueta 3 mas cercano a Grand Central: " << arbol.dato(it.actual().idx).tripID << endl;
+
     return 0;
 }
@@ -0,0 +1,177 @@
+#pragma once
+// Nucleos de filtrado de hojas sobre las columnas x[], y[] (ver rstartree.hpp):
+// rango (que posiciones caen en una caja) y distancias al cuadrado para kNN.
+// Tres versiones: escalar sin saltos, SSE2 (2 entradas por paso) y AVX2
+// (4 por paso; las coordenadas son double, 8 por paso pediria AVX-512).
+// Los aciertos se compactan con la mascara de la comparacion y una tabla de
+// permutaciones, sin un salto por entrada. El despacho se decide UNA vez en
+// tiempo de ejecucion segun la CPU; definir RSTAR_SIN_SIMD fuerza la escalar.
+#include <cstdint>
+#include <cstddef>
+
+#if !defined(RSTAR_SIN_SIMD) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define RSTAR_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+enum class NucleoSimd { Escalar, SSE2, AVX2 };
+
+inline bool simdSoporta(NucleoSimd nucleo) {
+#ifdef RSTAR_SIMD_X86
+    switch (nucleo) {
+        case NucleoSimd::AVX2: return __builtin_cpu_supports("avx2");
+        case NucleoSimd::SSE2: return __builtin_cpu_supports("sse2");
+        default: return true;
+    }
+#else
+    return nucleo == NucleoSimd::Escalar;
+#endif
+}
+
+// El mejor nucleo de la CPU actual (se evalua una sola vez)
+inline NucleoSimd nucleoSimdActivo() {
+    static const NucleoSimd activo = simdSoporta(NucleoSimd::AVX2) ? NucleoSimd::AVX2
+                                   : simdSoporta(NucleoSimd::SSE2) ? NucleoSimd::SSE2
+                                   : NucleoSimd::Escalar;
+    return activo;
+}
+
+// Escalar desde la posicion ini; tambien resuelve la cola de las vectoriales.
+inline uint32_t filtrarCajaDesde(const double* xs, const double* ys, uint32_t ini, uint32_t n,
+                                 double x0, double y0, double x1, double y1, uint32_t* salida) {
+    uint32_t k = 0;
+    for (uint32_t i = ini; i < n; i++) {
+        salida[k] = i;   // escritura incondicional: el acierto solo avanza k
+        k += (uint32_t)((xs[i] >= x0) & (xs[i] <= x1) & (ys[i] >= y0) & (ys[i] <= y1));
+    }
+    return k;
+}
+// Posiciones i en [0, n) con (xs[i], ys[i]) dentro de [x0, x1] x [y0, y1]
+// (bordes incluidos, como Caja::contiene), en orden creciente. salida debe
+// tener lugar para n + 4 posiciones. Devuelve cuantas escribio.
+inline uint32_t filtrarCajaEscalar(const double* xs, const double* ys, uint32_t n,
+                                   double x0, double y0, double x1, double y1, uint32_t* salida) {
+    return filtrarCajaDesde(xs, ys, 0, n, x0, y0, x1, y1, salida);
+}
+
+// d2[i] = (xs[i] - qx)^2 + (ys[i] - qy)^2
+inline void distancias2Escalar(const double* xs, const double* ys, uint32_t n,
+                               double qx, double qy, double* d2) {
+    for (uint32_t i = 0; i < n; i++) {
+        double dx = xs[i] - qx, dy = ys[i] - qy;
+        d2[i] = dx * dx + dy * dy;
+    }
+}
+
+#ifdef RSTAR_SIMD_X86
+// Tabla de compactacion: para la mascara b (4 bits), las posiciones de sus
+// bits encendidos al frente, y cuantos son.
+struct TablaCompactacion {
+    alignas(16) uint32_t pos[16][4];
+    uint32_t cuenta[16];
+    TablaCompactacion() {
+        for (int b = 0; b < 16; b++) {
+            int k = 0;
+            for (int j = 0; j < 4; j++) { pos[b][j] = 0; if (b & (1 << j)) pos[b][k++] = (uint32_t)j; }
+            cuenta[b] = (uint32_t)k;
+        }
+    }
+};
+inline const TablaCompactacion& tablaCompactacion() {
+    static const TablaCompactacion t;
+    return t;
+}
+
+__attribute__((target("sse2")))
+inline uint32_t filtrarCajaSSE2(const double* xs, const double* ys, uint32_t n,
+                                double x0, double y0, double x1, double y1, uint32_t* salida) {
+    const TablaCompactacion& t = tablaCompactacion();
+    const __m128d vx0 = _mm_set1_pd(x0), vx1 = _mm_set1_pd(x1);
+    const __m128d vy0 = _mm_set1_pd(y0), vy1 = _mm_set1_pd(y1);
+    uint32_t k = 0, i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(xs + i), y = _mm_loadu_pd(ys + i);
+        __m128d dentro = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(x, vx0), _mm_cmple_pd(x, vx1)),
+                                    _mm_and_pd(_mm_cmpge_pd(y, vy0), _mm_cmple_pd(y, vy1)));
+        int mascara = _mm_movemask_pd(dentro);
+        __m128i p = _mm_add_epi32(_mm_set1_epi32((int)i),
+                                  _mm_load_si128((const __m128i*)t.pos[mascara]));
+        _mm_storel_epi64((__m128i*)(salida + k), p);
+        k += t.cuenta[mascara];
+    }
+    return k + filtrarCajaDesde(xs, ys, i, n, x0, y0, x1, y1, salida + k);
+}
+
+__attribute__((target("sse2")))
+inline void distancias2SSE2(const double* xs, const double* ys, uint32_t n,
+                            double qx, double qy, double* d2) {
+    const __m128d vqx = _mm_set1_pd(qx), vqy = _mm_set1_pd(qy);
+    uint32_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(xs + i), vqx);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(ys + i), vqy);
+        _mm_storeu_pd(d2 + i, _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+    }
+    distancias2Escalar(xs + i, ys + i, n - i, qx, qy, d2 + i);
+}
+
+__attribute__((target("avx2")))
+inline uint32_t filtrarCajaAVX2(const double* xs, const double* ys, uint32_t n,
+                                double x0, double y0, double x1, double y1, uint32_t* salida) {
+    const TablaCompactacion& t = tablaCompactacion();
+    const __m256d vx0 = _mm256_set1_pd(x0), vx1 = _mm256_set1_pd(x1);
+    const __m256d vy0 = _mm256_set1_pd(y0), vy1 = _mm256_set1_pd(y1);
+    uint32_t k = 0, i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(xs + i), y = _mm256_loadu_pd(ys + i);
+        __m256d dentro = _mm256_and_pd(
+            _mm256_and_pd(_mm256_cmp_pd(x, vx0, _CMP_GE_OQ), _mm256_cmp_pd(x, vx1, _CMP_LE_OQ)),
+            _mm256_and_pd(_mm256_cmp_pd(y, vy0, _CMP_GE_OQ), _mm256_cmp_pd(y, vy1, _CMP_LE_OQ)));
+        int mascara = _mm256_movemask_pd(dentro);
+        __m128i p = _mm_add_epi32(_mm_set1_epi32((int)i),
+                                  _mm_load_si128((const __m128i*)t.pos[mascara]));
+        _mm_storeu_si128((__m128i*)(salida + k), p);
+        k += t.cuenta[mascara];
+    }
+    return k + filtrarCajaDesde(xs, ys, i, n, x0, y0, x1, y1, salida + k);
+}
+
+__attribute__((target("avx2")))
+inline void distancias2AVX2(const double* xs, const double* ys, uint32_t n,
+                            double qx, double qy, double* d2) {
+    const __m256d vqx = _mm256_set1_pd(qx), vqy = _mm256_set1_pd(qy);
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs + i), vqx);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys + i), vqy);
+        _mm256_storeu_pd(d2 + i, _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+    }
+    distancias2Escalar(xs + i, ys + i, n - i, qx, qy, d2 + i);
+}
+#endif
+
+// Despacho: mismo contrato que las versiones escalares
+inline uint32_t filtrarCaja(const double* xs, const double* ys, uint32_t n,
+                            double x0, double y0, double x1, double y1, uint32_t* salida) {
+#ifdef RSTAR_SIMD_X86
+    switch (nucleoSimdActivo()) {
+        case NucleoSimd::AVX2: return filtrarCajaAVX2(xs, ys, n, x0, y0, x1, y1, salida);
+        case NucleoSimd::SSE2: return filtrarCajaSSE2(xs, ys, n, x0, y0, x1, y1, salida);
+        default: break;
+    }
+#endif
+    return filtrarCajaEscalar(xs, ys, n, x0, y0, x1, y1, salida);
+}
+
+inline void distancias2(const double* xs, const double* ys, uint32_t n,
+                        double qx, double qy, double* d2) {
+#ifdef RSTAR_SIMD_X86
+    switch (nucleoSimdActivo()) {
+        case NucleoSimd::AVX2: distancias2AVX2(xs, ys, n, qx, qy, d2); return;
+        case NucleoSimd::SSE2: distancias2SSE2(xs, ys, n, qx, qy, d2); return;
+        default: break;
+    }
+#endif
+    distancias2Escalar(xs, ys, n, qx, qy, d2);
+}
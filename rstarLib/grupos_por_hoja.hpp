@@ -33,6 +33,23 @@ public:
         });
     }
 
+    // Tras arbol.compactar(): reescribe los idx de los miembros con su tabla
+    // en vez de rearmar. compactar no cambia las versiones de las hojas; un
+    // cajon con algun miembro ya eliminado es de una hoja vieja y se descarta.
+    void remapear(const std::vector<uint32_t>& remapeo) {
+        for (auto it = cache_.begin(); it != cache_.end();) {
+            bool vigente = true;
+            for (Grupo& g : it->second.grupos)
+                for (Res& m : g.miembros) {
+                    uint32_t nuevo = m.idx < remapeo.size() ? remapeo[m.idx] : RStarTree2D<T>::SIN_IDX;
+                    if (nuevo == RStarTree2D<T>::SIN_IDX) vigente = false;
+                    m.idx = nuevo;
+                }
+            if (vigente) ++it;
+            else it = cache_.erase(it);
+        }
+    }
+
     // Consulta 2 del proyecto: grupos (>= 2 miembros) dentro del bbox,
     // fusionados por etiqueta entre hojas. Devuelve indices a la arena.
     std::vector<std::vector<uint32_t>> gruposEnRango(const Caja& bbox) {
@@ -21,6 +21,21 @@ public:
     }
     // Para mantener el indice al insertar despues de construirlo
     void agregar(const T& dato, uint32_t idx) { mapa_[idDe_(dato)] = idx; }
+    // Al eliminar del arbol: con activarReuso el idx puede pasar a otro dato
+    void quitar(const Id& id) { mapa_.erase(id); }
+    // Tras arbol.compactar(): reescribe las posiciones con su tabla; los ids
+    // cuyo dato ya no estaba en el arbol salen del indice
+    void remapear(const std::vector<uint32_t>& remapeo) {
+        for (auto it = mapa_.begin(); it != mapa_.end();) {
+            uint32_t nuevo = it->second < remapeo.size() ? remapeo[it->second] : RStarTree2D<T>::SIN_IDX;
+            if (nuevo == RStarTree2D<T>::SIN_IDX) {
+                it = mapa_.erase(it);
+            } else {
+                it->second = nuevo;
+                ++it;
+            }
+        }
+    }
     size_t tamano() const { return mapa_.size(); }
 
 private:
@@ -0,0 +1,289 @@
+#pragma once
+// Join espacial por distancia entre dos arboles ("para cada pickup, los
+// dropoffs a menos de d"): todos los pares (idxA, idxB) con distancia
+// euclidea <= d, sin una buscarRango por punto. Recorrido sincronizado de
+// Brinkhoff, Kriegel y Seeger (1993): se bajan a la vez los dos arboles
+// por pares de nodos cuyos MBR estan a <= d. En cada par, los hijos se
+// restringen primero a los que tocan el MBR del otro nodo ampliado en d y
+// se cruzan con un barrido en x (plane sweep) sobre sus MBR ordenados por
+// borde inferior; con alturas distintas baja solo el nodo mas alto. Entre
+// dos hojas, el mismo barrido sobre los puntos.
+// Con un solo arbol es el auto-join por distancia (eps self-join, base de
+// DBSCAN en dbscan.hpp): cada par de puntos distintos una vez; un nodo se
+// cruza consigo mismo solo por los pares de hijos (o de puntos) i < k.
+// d va en las unidades de las coordenadas (grados, con lat/lon).
+// Los arboles NO deben modificarse mientras corre un join.
+//   JoinEspacial<Viaje, Viaje> join(pickups, dropoffs);
+//   join.unir(0.001, [&](uint32_t a, uint32_t b) { ... });
+//   join.unir(0.001, pool, [&](uint32_t a, uint32_t b, unsigned hilo) { ... });
+//   JoinEspacial<Viaje, Viaje> autoJoin(pickups);
+//   auto vecinos = autoJoin.listasVecinos(0.001, pool);
+#include "rstartree.hpp"   // incluye pool_hilos.hpp
+
+template <typename TA, typename TB>
+class JoinEspacial {
+public:
+    JoinEspacial(const RStarTree2D<TA>& a, const RStarTree2D<TB>& b) : a_(a), b_(b), borradores_(1) {}
+    // Auto-join: pares {i, j} con i != j, cada uno una vez y en cualquier
+    // orden; nunca (i, i)
+    explicit JoinEspacial(const RStarTree2D<TA>& arbol) : a_(arbol), b_(arbol), mismo_(true), borradores_(1) {
+        static_assert(std::is_same_v<TA, TB>, "el auto-join es JoinEspacial<T, T>");
+    }
+
+    // Vecinos a <= d de cada posicion de la arena en formato CSR: sin el
+    // propio punto, sin repetidos y en orden de idx; las posiciones
+    // eliminadas tienen la lista vacia. Solo auto-join.
+    struct ListasVecinos {
+        struct Lista {
+            const uint32_t* ini = nullptr;
+            const uint32_t* fin = nullptr;
+            const uint32_t* begin() const { return ini; }
+            const uint32_t* end() const { return fin; }
+            size_t size() const { return (size_t)(fin - ini); }
+            bool empty() const { return ini == fin; }
+        };
+        std::vector<uint64_t> inicio;   // tamanoArena() + 1
+        std::vector<uint32_t> vecinos;
+        size_t tamano() const { return inicio.empty() ? 0 : inicio.size() - 1; }
+        Lista de(uint32_t idx) const { return {vecinos.data() + inicio[idx], vecinos.data() + inicio[idx + 1]}; }
+    };
+    ListasVecinos listasVecinos(double d) { return armarListas(d, nullptr); }
+    // El join y el orden de las listas en el pool
+    ListasVecinos listasVecinos(double d, PoolHilos& pool) { return armarListas(d, &pool); }
+
+    // emitir(idxA, idxB) por cada par; cada par una sola vez. d < 0 (o NaN)
+    // lanza invalid_argument.
+    template <typename Emitir>
+    void unir(double d, Emitir&& emitir) {
+        comprobarDistancia(d);
+        NodoA ra = a_.raiz();
+        NodoB rb = b_.raiz();
+        if (!ra.valida() || !rb.valida() || !cerca(ra.mbr(), rb.mbr(), d)) return;
+        Borrador& w = borradores_[0];
+        preparar(w, ra, rb);
+        unirNodos(ra, rb, d, 0, w, emitir);
+    }
+
+    // En paralelo: baja los primeros niveles de los dos arboles en este
+    // hilo hasta juntar unos 16 pares de subarboles por hilo (o llegar a
+    // pares de hojas) y reparte los pares en el pool; cada hilo sigue el
+    // recorrido sincronizado desde los suyos con su propia memoria.
+    // emitir(idxA, idxB, hilo) se llama desde varios hilos a la vez: cada
+    // hilo deberia escribir solo en lo suyo.
+    template <typename Emitir>
+    void unir(double d, PoolHilos& pool, Emitir&& emitir) {
+        comprobarDistancia(d);
+        NodoA ra = a_.raiz();
+        NodoB rb = b_.raiz();
+        if (!ra.valida() || !rb.valida() || !cerca(ra.mbr(), rb.mbr(), d)) return;
+        if (borradores_.size() < pool.hilos()) borradores_.resize(pool.hilos());
+        Borrador& w0 = borradores_[0];
+        preparar(w0, ra, rb);
+        std::vector<std::pair<NodoA, NodoB>> frente{{ra, rb}}, siguiente;
+        const size_t objetivo = 16 * (size_t)pool.hilos();
+        while (frente.size() < objetivo) {
+            siguiente.clear();
+            bool bajo = false;
+            for (auto& [na, nb] : frente) {
+                if (na.esHoja() && nb.esHoja()) { siguiente.push_back({na, nb}); continue; }
+                bajo = true;
+                barrer(na, nb, mismoNodo(na, nb), d, 0, w0, [&](NodoA x, NodoB y) { siguiente.push_back({x, y}); });
+            }
+            frente.swap(siguiente);
+            if (!bajo) break;
+        }
+        pool.paraCada(frente.size(), 1, [&](size_t i, unsigned h) {
+            Borrador& w = borradores_[h];
+            preparar(w, frente[i].first, frente[i].second);
+            auto emitirHilo = [&](uint32_t x, uint32_t y) { emitir(x, y, h); };
+            unirNodos(frente[i].first, frente[i].second, d, 0, w, emitirHilo);
+        });
+    }
+
+private:
+    using NodoA = typename RStarTree2D<TA>::NodoVista;
+    using NodoB = typename RStarTree2D<TB>::NodoVista;
+    struct Punto { double x, y; uint32_t idx; };
+
+    // Memoria de trabajo por hilo, reusada entre joins: listas de hijos por
+    // profundidad de la recursion y los puntos de las dos hojas del barrido
+    struct Borrador {
+        std::vector<std::pair<std::vector<NodoA>, std::vector<NodoB>>> niveles;
+        std::vector<Punto> pa, pb;
+        std::vector<std::pair<uint32_t, uint32_t>> pares;   // listasVecinos
+    };
+    template <typename NA, typename NB>
+    static void preparar(Borrador& w, NA na, NB nb) {
+        size_t prof = (size_t)na.nivel() + (size_t)nb.nivel() + 1;
+        if (w.niveles.size() < prof) w.niveles.resize(prof);
+    }
+
+    static double separacion(double aLo, double aHi, double bLo, double bHi) {
+        return std::max(0.0, std::max(aLo - bHi, bLo - aHi));
+    }
+    static void comprobarDistancia(double d) {
+        if (!(d >= 0)) throw std::invalid_argument("JoinEspacial: d debe ser >= 0");
+    }
+    static bool cerca(const Caja& a, const Caja& b, double d) {
+        double sx = separacion(a.lo[0], a.hi[0], b.lo[0], b.hi[0]);
+        double sy = separacion(a.lo[1], a.hi[1], b.lo[1], b.hi[1]);
+        return sx * sx + sy * sy <= d * d;
+    }
+    static Caja ampliada(const Caja& c, double d) {
+        return Caja(c.lo[0] - d, c.lo[1] - d, c.hi[0] + d, c.hi[1] + d);
+    }
+
+    bool mismoNodo(NodoA na, NodoB nb) const { return mismo_ && na.clave() == nb.clave(); }
+
+    template <typename Emitir>
+    void unirNodos(NodoA na, NodoB nb, double d, size_t prof, Borrador& w, Emitir& emitir) {
+        bool mismo = mismoNodo(na, nb);
+        if (na.esHoja() && nb.esHoja()) {
+            if (mismo) unirHojaConsigo(na.entradas(), d, w, emitir);
+            else unirHojas(na.entradas(), na.mbr(), nb.entradas(), nb.mbr(), d, w, emitir);
+            return;
+        }
+        barrer(na, nb, mismo, d, prof, w, [&](NodoA x, NodoB y) { unirNodos(x, y, d, prof + 1, w, emitir); });
+    }
+
+    // Pares de hijos (o del nodo que no baja) con MBR a <= d: filtro contra
+    // el MBR del otro ampliado en d y barrido en x sobre los bordes
+    // inferiores. Cada par se examina una vez. Un nodo consigo (auto-join):
+    // cada hijo consigo y con los que le siguen en el barrido.
+    template <typename Par>
+    static void barrer(NodoA na, NodoB nb, bool mismo, double d, size_t prof, Borrador& w, Par&& par) {
+        auto porLo = [](const auto& x, const auto& y) { return x.mbr().lo[0] < y.mbr().lo[0]; };
+        if constexpr (std::is_same_v<TA, TB>) {
+            if (mismo) {
+                auto& l = w.niveles[prof].first;
+                l.clear();
+                for (size_t i = 0; i < na.nHijos(); i++) l.push_back(na.hijo(i));
+                std::sort(l.begin(), l.end(), porLo);
+                for (size_t i = 0; i < l.size(); i++) {
+                    const Caja& c = l[i].mbr();
+                    par(l[i], l[i]);
+                    for (size_t k = i + 1; k < l.size() && l[k].mbr().lo[0] <= c.hi[0] + d; k++)
+                        if (cerca(c, l[k].mbr(), d)) par(l[i], l[k]);
+                }
+                return;
+            }
+        }
+        bool bajarA = !na.esHoja() && (nb.esHoja() || na.nivel() >= nb.nivel());
+        bool bajarB = !nb.esHoja() && (na.esHoja() || nb.nivel() >= na.nivel());
+        auto& [la, lb] = w.niveles[prof];
+        la.clear();
+        lb.clear();
+        Caja zonaA = ampliada(nb.mbr(), d), zonaB = ampliada(na.mbr(), d);
+        if (bajarA) {
+            for (size_t i = 0; i < na.nHijos(); i++)
+                if (na.hijo(i).mbr().interseca(zonaA)) la.push_back(na.hijo(i));
+        } else {
+            la.push_back(na);
+        }
+        if (bajarB) {
+            for (size_t i = 0; i < nb.nHijos(); i++)
+                if (nb.hijo(i).mbr().interseca(zonaB)) lb.push_back(nb.hijo(i));
+        } else {
+            lb.push_back(nb);
+        }
+        std::sort(la.begin(), la.end(), porLo);
+        std::sort(lb.begin(), lb.end(), porLo);
+        size_t i = 0, j = 0;
+        while (i < la.size() && j < lb.size()) {
+            if (la[i].mbr().lo[0] <= lb[j].mbr().lo[0]) {
+                const Caja& c = la[i].mbr();
+                for (size_t k = j; k < lb.size() && lb[k].mbr().lo[0] <= c.hi[0] + d; k++)
+                    if (cerca(c, lb[k].mbr(), d)) par(la[i], lb[k]);
+                i++;
+            } else {
+                const Caja& c = lb[j].mbr();
+                for (size_t k = i; k < la.size() && la[k].mbr().lo[0] <= c.hi[0] + d; k++)
+                    if (cerca(la[k].mbr(), c, d)) par(la[k], lb[j]);
+                j++;
+            }
+        }
+    }
+
+    // Dos hojas: los puntos de cada una dentro del MBR de la otra ampliado
+    // en d, ordenados por x; para cada punto de A, ventana [x - d, x + d]
+    // sobre los de B
+    template <typename ColA, typename ColB, typename Emitir>
+    static void unirHojas(const ColA& ca, const Caja& mbrA, const ColB& cb, const Caja& mbrB, double d,
+                          Borrador& w, Emitir& emitir) {
+        Caja zonaA = ampliada(mbrB, d), zonaB = ampliada(mbrA, d);
+        w.pa.clear();
+        w.pb.clear();
+        for (uint32_t i = 0; i < ca.n; i++)
+            if (zonaA.contiene(ca.x[i], ca.y[i])) w.pa.push_back({ca.x[i], ca.y[i], ca.idx[i]});
+        if (w.pa.empty()) return;
+        for (uint32_t i = 0; i < cb.n; i++)
+            if (zonaB.contiene(cb.x[i], cb.y[i])) w.pb.push_back({cb.x[i], cb.y[i], cb.idx[i]});
+        if (w.pb.empty()) return;
+        auto porX = [](const Punto& p, const Punto& q) { return p.x < q.x; };
+        std::sort(w.pa.begin(), w.pa.end(), porX);
+        std::sort(w.pb.begin(), w.pb.end(), porX);
+        double d2 = d * d;
+        size_t desde = 0;
+        for (const Punto& p : w.pa) {
+            while (desde < w.pb.size() && w.pb[desde].x < p.x - d) desde++;
+            for (size_t k = desde; k < w.pb.size() && w.pb[k].x <= p.x + d; k++) {
+                double dx = w.pb[k].x - p.x, dy = w.pb[k].y - p.y;
+                if (dx * dx + dy * dy <= d2) emitir(p.idx, w.pb[k].idx);
+            }
+        }
+    }
+
+    // Una hoja consigo: sus puntos ordenados por x, cada uno contra los que
+    // le siguen dentro de la ventana
+    template <typename Col, typename Emitir>
+    static void unirHojaConsigo(const Col& c, double d, Borrador& w, Emitir& emitir) {
+        w.pa.clear();
+        for (uint32_t i = 0; i < c.n; i++) w.pa.push_back({c.x[i], c.y[i], c.idx[i]});
+        std::sort(w.pa.begin(), w.pa.end(), [](const Punto& p, const Punto& q) { return p.x < q.x; });
+        double d2 = d * d;
+        for (size_t i = 0; i < w.pa.size(); i++) {
+            const Punto& p = w.pa[i];
+            for (size_t k = i + 1; k < w.pa.size() && w.pa[k].x <= p.x + d; k++) {
+                double dx = w.pa[k].x - p.x, dy = w.pa[k].y - p.y;
+                if (dx * dx + dy * dy <= d2) emitir(p.idx, w.pa[k].idx);
+            }
+        }
+    }
+
+    // Pares del auto-join juntados por hilo, despues contados y repartidos
+    // en las listas de los dos extremos
+    ListasVecinos armarListas(double d, PoolHilos* pool) {
+        if (!mismo_) throw std::logic_error("listasVecinos requiere el auto-join (JoinEspacial(arbol))");
+        for (Borrador& w : borradores_) w.pares.clear();
+        if (pool != nullptr)
+            unir(d, *pool, [&](uint32_t i, uint32_t j, unsigned h) { borradores_[h].pares.push_back({i, j}); });
+        else
+            unir(d, [&](uint32_t i, uint32_t j) { borradores_[0].pares.push_back({i, j}); });
+        ListasVecinos l;
+        size_t n = a_.tamanoArena();
+        l.inicio.assign(n + 1, 0);
+        for (const Borrador& w : borradores_)
+            for (auto [i, j] : w.pares) { l.inicio[i + 1]++; l.inicio[j + 1]++; }
+        for (size_t i = 0; i < n; i++) l.inicio[i + 1] += l.inicio[i];
+        l.vecinos.resize(l.inicio[n]);
+        std::vector<uint64_t> cursor(l.inicio.begin(), l.inicio.end() - 1);
+        for (Borrador& w : borradores_) {
+            for (auto [i, j] : w.pares) {
+                l.vecinos[cursor[i]++] = j;
+                l.vecinos[cursor[j]++] = i;
+            }
+            std::vector<std::pair<uint32_t, uint32_t>>().swap(w.pares);   // pueden ser muchos: se sueltan
+        }
+        auto ordenar = [&](size_t i, unsigned) {
+            std::sort(l.vecinos.begin() + l.inicio[i], l.vecinos.begin() + l.inicio[i + 1]);
+        };
+        if (pool != nullptr) pool->paraCada(n, 1024, ordenar);
+        else for (size_t i = 0; i < n; i++) ordenar(i, 0);
+        return l;
+    }
+
+    const RStarTree2D<TA>& a_;
+    const RStarTree2D<TB>& b_;
+    bool mismo_ = false;                 // auto-join
+    std::vector<Borrador> borradores_;   // uno por hilo
+};
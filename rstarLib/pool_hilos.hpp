@@ -0,0 +1,195 @@
+#pragma once
+// Pool fijo de hilos con robo de trabajo, para ciclos "n tareas, f(tarea,
+// hilo)" (consultas por lote, carga masiva en paralelo). Cada hilo arranca
+// con un tramo contiguo de tareas y las toma de a 'bloque' por el frente;
+// el que se queda sin tareas le roba la mitad trasera del tramo a otro. Un
+// tramo es un par (ini, fin) de 32 bits en un solo atomico: tomar y robar
+// son un compare-exchange, sin candados. El candado solo despierta y espera
+// a los hilos al empezar y terminar cada ciclo.
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+class PoolHilos {
+public:
+    // El hilo que llama participa como hilo 0: con hilos = 1 no se crea ninguno.
+    explicit PoolHilos(unsigned hilos = std::thread::hardware_concurrency())
+        : tramos_(new Tramo[hilos == 0 ? 1 : hilos]) {
+        if (hilos == 0) hilos = 1;
+        for (unsigned h = 1; h < hilos; h++) trabajadores_.emplace_back([this, h] { bucle(h); });
+    }
+    ~PoolHilos() {
+        {
+            std::lock_guard<std::mutex> l(mutex_);
+            cerrar_ = true;
+        }
+        hayTrabajo_.notify_all();
+        for (auto& t : trabajadores_) t.join();
+    }
+    PoolHilos(const PoolHilos&) = delete;
+    PoolHilos& operator=(const PoolHilos&) = delete;
+
+    unsigned hilos() const { return (unsigned)trabajadores_.size() + 1; }
+
+    // Ejecuta f(i, hilo) para i en [0, n), de a 'bloque' tareas consecutivas.
+    // Bloquea hasta que terminan todas. No reentrante.
+    void paraCada(size_t n, size_t bloque, const std::function<void(size_t, unsigned)>& f) {
+        if (n == 0) return;
+        if (n > UINT32_MAX) throw std::length_error("paraCada admite hasta 2^32 - 1 tareas");
+        unsigned H = hilos();
+        {
+            std::lock_guard<std::mutex> l(mutex_);
+            f_ = &f;
+            bloque_ = bloque == 0 ? 1 : bloque;
+            for (unsigned h = 0; h < H; h++)
+                tramos_[h].v.store(empaquetar(n * h / H, n * (h + 1) / H), std::memory_order_relaxed);
+            pendientes_ = H - 1;
+            generacion_++;
+        }
+        hayTrabajo_.notify_all();
+        trabajar(0);
+        std::unique_lock<std::mutex> l(mutex_);
+        terminaron_.wait(l, [this] { return pendientes_ == 0; });
+        f_ = nullptr;
+    }
+
+private:
+    struct alignas(64) Tramo { std::atomic<uint64_t> v{0}; };   // ini << 32 | fin
+    static uint64_t empaquetar(size_t ini, size_t fin) { return (uint64_t)ini << 32 | (uint64_t)fin; }
+
+    void trabajar(unsigned h) {
+        unsigned H = hilos();
+        for (;;) {
+            uint64_t v = tramos_[h].v.load();
+            size_t ini = v >> 32, fin = (uint32_t)v;
+            if (ini < fin) {
+                size_t hasta = std::min(fin, ini + bloque_);
+                if (!tramos_[h].v.compare_exchange_weak(v, empaquetar(hasta, fin))) continue;
+                for (size_t i = ini; i < hasta; i++) (*f_)(i, h);
+                continue;
+            }
+            // sin tareas propias: robar la mitad trasera de otro tramo
+            bool robo = false;
+            for (unsigned k = 1; k < H && !robo; k++) {
+                Tramo& otro = tramos_[(h + k) % H];
+                uint64_t w = otro.v.load();
+                size_t oi = w >> 32, of = (uint32_t)w;
+                while (oi < of) {
+                    size_t medio = of - std::max<size_t>(1, (of - oi) / 2);
+                    if (otro.v.compare_exchange_weak(w, empaquetar(oi, medio))) {
+                        tramos_[h].v.store(empaquetar(medio, of));
+                        robo = true;
+                        break;
+                    }
+                    oi = w >> 32;
+                    of = (uint32_t)w;
+                }
+            }
+            // nada que robar: lo pendiente ya tiene dueno que lo termina
+            if (!robo) return;
+        }
+    }
+    void bucle(unsigned h) {
+        uint64_t visto = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> l(mutex_);
+                hayTrabajo_.wait(l, [&] { return cerrar_ || generacion_ != visto; });
+                if (cerrar_) return;
+                visto = generacion_;
+            }
+            trabajar(h);
+            std::lock_guard<std::mutex> l(mutex_);
+            if (--pendientes_ == 0) terminaron_.notify_one();
+        }
+    }
+
+    std::unique_ptr<Tramo[]> tramos_;
+    std::vector<std::thread> trabajadores_;
+    std::mutex mutex_;
+    std::condition_variable hayTrabajo_, terminaron_;
+    const std::function<void(size_t, unsigned)>* f_ = nullptr;
+    size_t bloque_ = 1;
+    unsigned pendientes_ = 0;
+    uint64_t generacion_ = 0;
+    bool cerrar_ = false;
+};
+
+// f(i) para i en [0, n): en el pool si hay uno, si no en el hilo actual
+template <typename F>
+void paraCadaEn(PoolHilos* pool, size_t n, size_t bloque, F&& f) {
+    if (pool == nullptr || pool->hilos() == 1) {
+        for (size_t i = 0; i < n; i++) f(i);
+        return;
+    }
+    pool->paraCada(n, bloque, [&](size_t i, unsigned) { f(i); });
+}
+
+// Orden estable en paralelo: stable_sort por trozos y rondas de mezcla de a
+// pares, cada mezcla partida en pedazos por busqueda binaria (merge path).
+// El resultado es identico al de std::stable_sort con el mismo comparador.
+// Con ordenTotal (el comparador no tiene empates) los trozos y el caso de
+// un hilo usan std::sort, mas rapido y con el mismo resultado.
+template <typename E, typename Cmp>
+void ordenarEstable(std::vector<E>& v, Cmp cmp, PoolHilos* pool, bool ordenTotal = false) {
+    size_t n = v.size();
+    unsigned H = pool == nullptr ? 1 : pool->hilos();
+    auto ordenarTrozo = [&](E* a, E* b) {
+        if (ordenTotal) std::sort(a, b, cmp);
+        else std::stable_sort(a, b, cmp);
+    };
+    if (H == 1 || n < (1u << 14)) {
+        ordenarTrozo(v.data(), v.data() + n);
+        return;
+    }
+    size_t trozos = 1;
+    while (trozos < 2 * (size_t)H) trozos *= 2;
+    std::vector<size_t> borde(trozos + 1);
+    for (size_t t = 0; t <= trozos; t++) borde[t] = n * t / trozos;
+    pool->paraCada(trozos, 1, [&](size_t t, unsigned) {
+        ordenarTrozo(v.data() + borde[t], v.data() + borde[t + 1]);
+    });
+
+    std::vector<E> tmp(n);
+    E* src = v.data();
+    E* dst = tmp.data();
+    const size_t porPedazo = std::max<size_t>(1 << 12, n / (4 * (size_t)H));
+    for (size_t ancho = 1; ancho < trozos; ancho *= 2) {
+        struct Pedazo { size_t a0, a1, b0, b1, out; };
+        std::vector<Pedazo> pedazos;
+        for (size_t t = 0; t < trozos; t += 2 * ancho) {
+            size_t l = borde[t], m = borde[t + ancho], r = borde[std::min(trozos, t + 2 * ancho)];
+            size_t na = m - l, nb = r - m, q = std::max<size_t>(1, (r - l) / porPedazo);
+            // i = cuantos de a van antes de la posicion k de la mezcla (empates: a primero)
+            auto corte = [&](size_t k) {
+                size_t lo = k > nb ? k - nb : 0, hi = std::min(k, na);
+                while (lo < hi) {
+                    size_t i = (lo + hi) / 2, j = k - i;
+                    if (j > 0 && !cmp(src[m + j - 1], src[l + i])) lo = i + 1;
+                    else hi = i;
+                }
+                return lo;
+            };
+            size_t iPrev = 0, kPrev = 0;
+            for (size_t p = 1; p <= q; p++) {
+                size_t k = (r - l) * p / q, i = p == q ? na : corte(k);
+                pedazos.push_back({l + iPrev, l + i, m + (kPrev - iPrev), m + (k - i), l + kPrev});
+                iPrev = i;
+                kPrev = k;
+            }
+        }
+        pool->paraCada(pedazos.size(), 1, [&](size_t p, unsigned) {
+            const Pedazo& z = pedazos[p];
+            std::merge(src + z.a0, src + z.a1, src + z.b0, src + z.b1, dst + z.out, cmp);
+        });
+        std::swap(src, dst);
+    }
+    if (src != v.data()) std::copy(src, src + n, v.data());
+}
@@ -9,86 +9,747 @@
 #include <cstdint>
 #include <stdexcept>
 #include <cmath>
+#include <type_traits>
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <iterator>
+#include <array>
+#include <tuple>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include "filtro_hojas.hpp"
+#include "pool_hilos.hpp"
 
-struct Caja {
-    double lo[2], hi[2];
-    Caja() { reset(); }
-    Caja(double xmin, double ymin, double xmax, double ymax) {
+// Caja alineada a los ejes en DIM dimensiones (lo/hi por eje). Caja es la
+// de 2D, con los atajos (x, y) que usa RStarTree2D; los ciclos sobre DIM son
+// de largo constante y el compilador los desenrolla.
+template <int DIM>
+struct CajaN {
+    static_assert(DIM >= 1, "DIM debe ser >= 1");
+    double lo[DIM], hi[DIM];
+    CajaN() { reset(); }
+    CajaN(const std::array<double, DIM>& min, const std::array<double, DIM>& max) {
+        for (int d = 0; d < DIM; d++) { lo[d] = min[d]; hi[d] = max[d]; }
+    }
+    template <int D = DIM, std::enable_if_t<D == 2, int> = 0>
+    CajaN(double xmin, double ymin, double xmax, double ymax) {
         lo[0] = xmin; lo[1] = ymin; hi[0] = xmax; hi[1] = ymax;
     }
     void reset() {
-        lo[0] = lo[1] = std::numeric_limits<double>::max();
-        hi[0] = hi[1] = std::numeric_limits<double>::lowest();
+        for (int d = 0; d < DIM; d++) {
+            lo[d] = std::numeric_limits<double>::max();
+            hi[d] = std::numeric_limits<double>::lowest();
+        }
     }
-    void estirar(const Caja& o) {
-        for (int d = 0; d < 2; d++) {
+    void estirar(const CajaN& o) {
+        for (int d = 0; d < DIM; d++) {
             lo[d] = std::min(lo[d], o.lo[d]);
             hi[d] = std::max(hi[d], o.hi[d]);
         }
     }
+    void estirar(const double* p) {   // punto de DIM coordenadas
+        for (int d = 0; d < DIM; d++) { lo[d] = std::min(lo[d], p[d]); hi[d] = std::max(hi[d], p[d]); }
+    }
+    template <int D = DIM, std::enable_if_t<D == 2, int> = 0>
     void estirar(double x, double y) {
         lo[0] = std::min(lo[0], x); hi[0] = std::max(hi[0], x);
         lo[1] = std::min(lo[1], y); hi[1] = std::max(hi[1], y);
     }
-    double area() const { return (hi[0] - lo[0]) * (hi[1] - lo[1]); }
-    double margen() const { return 2.0 * ((hi[0] - lo[0]) + (hi[1] - lo[1])); }
-    double overlap(const Caja& o) const {
-        double a = std::max(0.0, std::min(hi[0], o.hi[0]) - std::max(lo[0], o.lo[0]));
-        double b = std::max(0.0, std::min(hi[1], o.hi[1]) - std::max(lo[1], o.lo[1]));
-        return a * b;
+    double area() const {   // volumen en DIM dimensiones
+        double v = hi[0] - lo[0];
+        for (int d = 1; d < DIM; d++) v *= hi[d] - lo[d];
+        return v;
+    }
+    double margen() const {   // suma de las aristas: 2^(DIM-1) por eje
+        double s = hi[0] - lo[0];
+        for (int d = 1; d < DIM; d++) s += hi[d] - lo[d];
+        return (double)(1 << (DIM - 1)) * s;
     }
-    bool interseca(const Caja& o) const {
-        return !(hi[0] < o.lo[0] || o.hi[0] < lo[0] || hi[1] < o.lo[1] || o.hi[1] < lo[1]);
+    double overlap(const CajaN& o) const {
+        double v = 1.0;
+        for (int d = 0; d < DIM; d++) v *= std::max(0.0, std::min(hi[d], o.hi[d]) - std::max(lo[d], o.lo[d]));
+        return v;
     }
+    bool interseca(const CajaN& o) const {
+        for (int d = 0; d < DIM; d++) if (hi[d] < o.lo[d] || o.hi[d] < lo[d]) return false;
+        return true;
+    }
+    bool contiene(const double* p) const {
+        for (int d = 0; d < DIM; d++) if (!(p[d] >= lo[d] && p[d] <= hi[d])) return false;
+        return true;
+    }
+    template <int D = DIM, std::enable_if_t<D == 2, int> = 0>
     bool contiene(double x, double y) const {
         return x >= lo[0] && x <= hi[0] && y >= lo[1] && y <= hi[1];
     }
+    bool cubre(const CajaN& o) const {   // o entera dentro de esta caja
+        for (int d = 0; d < DIM; d++) if (o.lo[d] < lo[d] || o.hi[d] > hi[d]) return false;
+        return true;
+    }
     // distancia al cuadrado del punto a la caja (0 si esta dentro)
+    double dist2A(const double* p) const {
+        double s = 0.0;
+        for (int d = 0; d < DIM; d++) {
+            double e = std::max({lo[d] - p[d], 0.0, p[d] - hi[d]});
+            s += e * e;
+        }
+        return s;
+    }
+    template <int D = DIM, std::enable_if_t<D == 2, int> = 0>
     double dist2A(double x, double y) const {
         double dx = std::max({lo[0] - x, 0.0, x - hi[0]});
         double dy = std::max({lo[1] - y, 0.0, y - hi[1]});
         return dx * dx + dy * dy;
     }
 };
+using Caja = CajaN<2>;
 
-// R*-tree 2D con arena: las hojas guardan {x, y, idx} y el dato T completo
-// vive una sola vez en la arena (vector<T>). Ver DISENO.md seccion 2.
+// Clave de Hilbert de la celda (x, y) en una grilla 2^16 x 2^16 (xy2d
+// clasico). Celdas con claves consecutivas son vecinas: ordenar por esta
+// clave da hojas compactas, a diferencia del orden lexicografico (lat, lon).
+inline uint32_t claveHilbert(uint32_t x, uint32_t y) {
+    const uint32_t n = 1u << 16;
+    uint32_t d = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2) {
+        uint32_t rx = (x & s) ? 1 : 0, ry = (y & s) ? 1 : 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) { x = n - 1 - x; y = n - 1 - y; }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+enum class Empaquetado { STR, Hilbert };   // estrategia de cargarMasivo
+enum class Disposicion { BFS, vEB };       // orden de los nodos en congelar
+
+// Memoria de trabajo de split, reinsert y chooseSubtree, a lo sumo M+1
+// elementos. Con capacidad fija (CAP = M+1, variante de compilacion) es un
+// arreglo; con CAP = 0, un vector que conserva su capacidad entre
+// operaciones.
+template <typename E, size_t CAP>
+struct ArregloPila {
+    std::array<E, CAP> d;
+    uint32_t n = 0;
+    size_t size() const { return n; }
+    void reserve(size_t) {}
+    void resize(size_t k, const E& v = E()) {
+        for (size_t i = n; i < k; i++) d[i] = v;
+        n = (uint32_t)k;
+    }
+    void push_back(const E& e) { d[n++] = e; }
+    E* begin() { return d.data(); }
+    E* end() { return d.data() + n; }
+    const E* begin() const { return d.data(); }
+    const E* end() const { return d.data() + n; }
+    E& operator[](size_t i) { return d[i]; }
+    const E& operator[](size_t i) const { return d[i]; }
+};
+template <typename E, size_t CAP>
+using TrabajoRStar = std::conditional_t<CAP != 0, ArregloPila<E, CAP>, std::vector<E>>;
+
+// Arreglo de capacidad fija (M+1) dentro de la celda del nodo en el pool;
+// interfaz minima de vector. Guarda los hijos de los nodos internos (y
+// en RStarTree<T, DIM>, tambien las entradas de las hojas).
+template <typename E>
+struct BloqueCelda {
+    E* d = nullptr;
+    uint32_t n = 0;
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+    E* begin() { return d; }
+    E* end() { return d + n; }
+    const E* begin() const { return d; }
+    const E* end() const { return d + n; }
+    E& operator[](size_t i) { return d[i]; }
+    const E& operator[](size_t i) const { return d[i]; }
+    void push_back(const E& e) { d[n++] = e; }
+    void clear() { n = 0; }
+    void erase(E* it) { std::copy(it + 1, d + n, it); n--; }
+    template <typename It>
+    void assign(It a, It b) { n = 0; for (; a != b; ++a) d[n++] = *a; }
+};
+
+// Pool de celdas de tamano fijo [Nodo | M+1 entradas] reservadas en slabs
+// de ~1MB: el nodo y sus entradas quedan contiguos, nodos hermanos creados
+// juntos quedan cerca, y los nodos liberados por condensar se reciclan
+// por una lista libre intrusiva.
+class PoolCeldas {
+public:
+    explicit PoolCeldas(size_t tamCelda)
+        : tamCelda_(tamCelda), celdasPorSlab_(std::max<size_t>(1, (1u << 20) / tamCelda)) {}
+    void* tomar() {
+        if (libre_ != nullptr) {
+            void* c = libre_;
+            libre_ = *(void**)c;
+            return c;
+        }
+        if (slabs_.empty() || usadas_ == celdasPorSlab_) {
+            slabs_.emplace_back(new unsigned char[tamCelda_ * celdasPorSlab_]);
+            usadas_ = 0;
+        }
+        return slabs_.back().get() + tamCelda_ * usadas_++;
+    }
+    void devolver(void* c) {
+        *(void**)c = libre_;
+        libre_ = c;
+    }
+    size_t bytesReservados() const { return slabs_.size() * celdasPorSlab_ * tamCelda_; }
+
+    // Celda de un nodo de tamNodo bytes seguido de M+1 entradas; las
+    // entradas empiezan en desplazamientoDatos(tamNodo)
+    static constexpr size_t alinear(size_t b, size_t a) { return (b + a - 1) / a * a; }
+    static constexpr size_t desplazamientoDatos(size_t tamNodo) {
+        return alinear(tamNodo, alignof(std::max_align_t));
+    }
+    static size_t tamCelda(size_t tamNodo, size_t tamEntrada, int M) {
+        return alinear(desplazamientoDatos(tamNodo) + tamEntrada * (size_t)(M + 1), alignof(std::max_align_t));
+    }
+private:
+    size_t tamCelda_, celdasPorSlab_, usadas_ = 0;
+    void* libre_ = nullptr;
+    std::vector<std::unique_ptr<unsigned char[]>> slabs_;
+};
+
+// Arena en tramos de 4096 T que nunca se mueven: agregar no invalida
+// referencias, y un lector de otro hilo puede leer arena_[idx] mientras
+// el escritor agrega (el directorio de tramos se reemplaza entero al
+// crecer y los directorios viejos siguen vivos hasta el destructor).
 template <typename T>
-class RStarTree2D {
+class ArenaTramos {
 public:
-    struct Resultado { double x, y; uint32_t idx; };
+    static constexpr unsigned BITS = 12;
+    static constexpr size_t TRAMO = size_t(1) << BITS;
+    ArenaTramos() = default;
+    ArenaTramos(const ArenaTramos&) = delete;
+    ArenaTramos& operator=(const ArenaTramos&) = delete;
+    ~ArenaTramos() {
+        T** dir = dir_.load();
+        for (size_t i = 0; i < n_; i++) dir[i >> BITS][i & (TRAMO - 1)].~T();
+        for (size_t t = 0; t < tramos_; t++)
+            ::operator delete(dir[t], std::align_val_t(alignof(T)));
+    }
+    size_t size() const { return n_; }
+    bool empty() const { return n_ == 0; }
+    T& operator[](size_t i) { return dir_.load(std::memory_order_acquire)[i >> BITS][i & (TRAMO - 1)]; }
+    const T& operator[](size_t i) const {
+        return dir_.load(std::memory_order_acquire)[i >> BITS][i & (TRAMO - 1)];
+    }
+    void clear() {
+        for (size_t i = 0; i < n_; i++) (*this)[i].~T();
+        n_ = 0;
+    }
+    // f(datos, n) por cada tramo ocupado, en orden
+    template <typename F>
+    void porTramos(F f) const {
+        for (size_t i = 0; i < n_; i += TRAMO) f(&(*this)[i], std::min(TRAMO, n_ - i));
+    }
+    // Agrega n T trivialmente copiables escritos en crudo por
+    // leer(destino, bytes), de a un tramo por llamada.
+    template <typename F>
+    void agregarCrudo(size_t n, F leer) {
+        while (n > 0) {
+            if ((n_ & (TRAMO - 1)) == 0 && (n_ >> BITS) == tramos_) nuevoTramo();
+            size_t k = std::min(n, TRAMO - (n_ & (TRAMO - 1)));
+            leer(&dir_.load(std::memory_order_relaxed)[n_ >> BITS][n_ & (TRAMO - 1)], k * sizeof(T));
+            n_ += k;
+            n -= k;
+        }
+    }
+    template <typename U>
+    void push_back(U&& v) {
+        if ((n_ & (TRAMO - 1)) == 0 && (n_ >> BITS) == tramos_) nuevoTramo();
+        new (&dir_.load(std::memory_order_relaxed)[n_ >> BITS][n_ & (TRAMO - 1)]) T(std::forward<U>(v));
+        n_++;
+    }
+    // Destruye las posiciones [n, size()) y suelta los tramos que quedan
+    // vacios. Sin lectores concurrentes (compactar).
+    void recortar(size_t n) {
+        T** dir = dir_.load(std::memory_order_relaxed);
+        for (size_t i = n; i < n_; i++) dir[i >> BITS][i & (TRAMO - 1)].~T();
+        n_ = n;
+        for (size_t usados = (n + TRAMO - 1) >> BITS; tramos_ > usados; tramos_--)
+            ::operator delete(dir[tramos_ - 1], std::align_val_t(alignof(T)));
+    }
+private:
+    void nuevoTramo() {
+        T** dir = dir_.load(std::memory_order_relaxed);
+        if (tramos_ == capDir_) {
+            size_t cap = std::max<size_t>(8, capDir_ * 2);
+            std::unique_ptr<T*[]> nuevo(new T*[cap]);
+            std::copy(dir, dir + tramos_, nuevo.get());
+            dir = nuevo.get();
+            directorios_.push_back(std::move(nuevo));
+            capDir_ = cap;
+        }
+        dir[tramos_] = (T*)::operator new(sizeof(T) * TRAMO, std::align_val_t(alignof(T)));
+        tramos_++;
+        dir_.store(dir, std::memory_order_release);
+    }
+    std::atomic<T**> dir_{nullptr};
+    size_t n_ = 0, tramos_ = 0, capDir_ = 0;
+    std::vector<std::unique_ptr<T*[]>> directorios_;
+};
+
+// Decisiones del R*-tree (Beckmann et al. 1990, seccion 4) sobre cajas de
+// DIM ejes, compartidas por RStarTree2D y RStarTree<T, DIM>: cada arbol
+// arma las cajas de su nodo a su manera (hojas en columnas o en filas,
+// copia-en-escritura, mapa de ubicaciones) y aca se elige el hijo de
+// ChooseSubtree, las entradas a reinsertar y el corte del split. La
+// memoria de trabajo vive aca y se reusa: con CAP = M+1 son arreglos de
+// capacidad fija, con CAP = 0 vectores que conservan su capacidad.
+template <int DIM, size_t CAP = 0>
+class EleccionRStar {
+public:
+    using CajaD = CajaN<DIM>;
+    template <typename E>
+    using Trabajo = TrabajoRStar<E, CAP>;
+
+    // Resultado de la seleccion de split (4.2): la permutacion es
+    // orden(sel); los primeros tamGrupo1 van al grupo 1
+    struct SeleccionSplit {
+        int eje, clave;
+        int tamGrupo1;
+    };
+
+    static double ampliacionArea(const CajaD& c, const CajaD& e) {
+        CajaD ampliada = c;
+        ampliada.estirar(e);
+        return ampliada.area() - c.area();
+    }
+
+    // 4.1 ChooseSubtree con hijos internos: minima ampliacion de area,
+    // empate por menor area. mbr(i) es la caja del hijo i; devuelve su
+    // posicion (-1 sin hijos).
+    template <typename Mbr>
+    static int hijoConMenorAmpliacionArea(int total, Mbr&& mbr, const CajaD& entrada) {
+        int mejor = -1;
+        double mejorCosto = std::numeric_limits<double>::infinity();
+        double mejorArea = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < total; i++) {
+            const CajaD& h = mbr(i);
+            double costo = ampliacionArea(h, entrada);
+            double area = h.area();
+            if (costo < mejorCosto || (costo == mejorCosto && area < mejorArea)) {
+                mejorCosto = costo;
+                mejorArea = area;
+                mejor = i;
+            }
+        }
+        return mejor;
+    }
+
+    // Con hijos-hoja: minima ampliacion de overlap del paper,
+    // overlap(E_k) = sum_{i!=k} area(E_k ∩ E_i).
+    // Optimizacion del paper (4.1): evaluar solo los 32 hijos con menor
+    // ampliacion de area — el costo exacto es cuadratico en M.
+    // La ampliacion de area se calcula una vez por hijo y solo se ordenan
+    // los candidatos (desempate por posicion, determinista).
+    template <typename Mbr>
+    int hijoConMenorAmpliacionOverlap(int total, Mbr&& mbr, const CajaD& entrada) {
+        const int CANDIDATOS = 32;
+        auto& orden = ampliacion_;
+        orden.resize(total);
+        for (int i = 0; i < total; i++) orden[i] = {ampliacionArea(mbr(i), entrada), i};
+        int evaluar = std::min(total, CANDIDATOS);
+        std::partial_sort(orden.begin(), orden.begin() + evaluar, orden.end());
+
+        int mejor = -1;
+        double mejorOverlap = std::numeric_limits<double>::infinity();
+        double mejorCostoArea = std::numeric_limits<double>::infinity();
+        double mejorArea = std::numeric_limits<double>::infinity();
+
+        for (int c = 0; c < evaluar; c++) {
+            int k = orden[c].second;
+            const CajaD& hijoK = mbr(k);
+            CajaD ampliado = hijoK;
+            ampliado.estirar(entrada);
+
+            double antes = 0.0, despues = 0.0;
+            for (int i = 0; i < total; i++) {
+                if (i == k) continue;
+                antes   += hijoK.overlap(mbr(i));
+                despues += ampliado.overlap(mbr(i));
+            }
+            double costoOverlap = despues - antes;
+            double costoArea = orden[c].first;
+            double area = hijoK.area();
+
+            if (costoOverlap < mejorOverlap ||
+                (costoOverlap == mejorOverlap &&
+                 (costoArea < mejorCostoArea ||
+                  (costoArea == mejorCostoArea && area < mejorArea)))) {
+                mejorOverlap = costoOverlap;
+                mejorCostoArea = costoArea;
+                mejorArea = area;
+                mejor = k;
+            }
+        }
+        return mejor;
+    }
+
+    // 4.3 ReInsert (RI1-RI3), variante close reinsert (la mejor del paper):
+    // elige las p = 30% de M entradas mas lejanas al centro del MBR.
+    // centro(i, c) escribe en c[DIM] el centro de la entrada i. Devuelve p
+    // (0: nada que reinsertar); lejana(c) es la c-esima mas lejana y
+    // sale(i) dice si la entrada i es una de ellas.
+    template <typename Centro>
+    int elegirReinsert(const CajaD& mbr, int total, int M, Centro&& centro) {
+        int p = (int)(M * 0.3);                     // p = 30% de M (paper 4.3)
+        if (p < 1) p = 1;
+        if (p > total - 1) p = total - 1;
+        if (p < 1) return 0;
 
-    explicit RStarTree2D(int M = 1200, int m = 480) : M_(M), m_(m) {
+        double medio[DIM], c[DIM];
+        for (int d = 0; d < DIM; d++) medio[d] = (mbr.lo[d] + mbr.hi[d]) / 2.0;
+        dist_.resize(total);   // {distancia^2, indice}
+        for (int i = 0; i < total; i++) {
+            centro(i, c);
+            double s = 0.0;
+            for (int d = 0; d < DIM; d++) s += (c[d] - medio[d]) * (c[d] - medio[d]);
+            dist_[i] = {s, i};
+        }
+        // RI2: orden decreciente de distancia
+        std::sort(dist_.begin(), dist_.end(),
+                  [](const auto& a, const auto& b) { return a.first > b.first; });
+        // RI3: marcar las p mas lejanas
+        quitar_.resize(0);
+        quitar_.resize(total, false);
+        for (int k = 0; k < p; k++) quitar_[dist_[k].second] = true;
+        return p;
+    }
+    int lejana(int c) const { return dist_[c].second; }
+    bool sale(int i) const { return quitar_[i]; }
+
+    // Cajas de las entradas del nodo a partir: el arbol las llena antes de
+    // llamar a elegirSplit
+    Trabajo<CajaD>& cajas() { return cajas_; }
+
+    // S1 ChooseSplitAxis (suma S de margenes de todas las distribuciones,
+    // ambos ordenes lower/upper, sobre los DIM ejes) + S2 ChooseSplitIndex
+    // (minimo overlap, empate por area). MBRs prefijo/sufijo => O(E) por
+    // orden.
+    SeleccionSplit elegirSplit(int mMin) {
+        const Trabajo<CajaD>& ent = cajas_;
+        int E = (int)ent.size();
+        int m = mMin;
+        if (m > E / 2) m = E / 2;   // salvaguarda: >= 1 distribucion
+        if (m < 1) m = 1;
+        int numDistribuciones = E - 2 * m + 1;
+
+        auto& pref = pref_;
+        auto& suf = suf_;
+        double S[DIM] = {};
+
+        auto prefSuf = [&](const Trabajo<int>& orden) {
+            pref.resize(E); suf.resize(E);
+            pref[0] = ent[orden[0]];
+            for (int i = 1; i < E; i++) { pref[i] = pref[i - 1]; pref[i].estirar(ent[orden[i]]); }
+            suf[E - 1] = ent[orden[E - 1]];
+            for (int i = E - 2; i >= 0; i--) { suf[i] = suf[i + 1]; suf[i].estirar(ent[orden[i]]); }
+        };
+
+        for (int eje = 0; eje < DIM; eje++) {
+            for (int clave = 0; clave < 2; clave++) {
+                Trabajo<int>& orden = ordenes_[eje][clave];
+                orden.resize(E);
+                for (int i = 0; i < E; i++) orden[i] = i;
+                std::sort(orden.begin(), orden.end(), [&](int a, int b) {
+                    double ka = (clave == 0) ? ent[a].lo[eje] : ent[a].hi[eje];
+                    double kb = (clave == 0) ? ent[b].lo[eje] : ent[b].hi[eje];
+                    return ka < kb;
+                });
+                prefSuf(orden);
+                for (int k = 0; k < numDistribuciones; k++) {
+                    int g1 = m + k;
+                    S[eje] += pref[g1 - 1].margen() + suf[g1].margen();
+                }
+            }
+        }
+
+        SeleccionSplit sel;
+        sel.eje = 0;                                 // CSA2: en empate, el primer eje
+        for (int eje = 1; eje < DIM; eje++)
+            if (S[eje] < S[sel.eje]) sel.eje = eje;
+        sel.clave = 0;
+        sel.tamGrupo1 = m;
+
+        double mejorOverlap = std::numeric_limits<double>::infinity();
+        double mejorArea = std::numeric_limits<double>::infinity();
+        for (int clave = 0; clave < 2; clave++) {
+            prefSuf(ordenes_[sel.eje][clave]);
+            for (int k = 0; k < numDistribuciones; k++) {
+                int g1 = m + k;
+                double ov = pref[g1 - 1].overlap(suf[g1]);
+                double ar = pref[g1 - 1].area() + suf[g1].area();
+                if (ov < mejorOverlap || (ov == mejorOverlap && ar < mejorArea)) {
+                    mejorOverlap = ov;
+                    mejorArea = ar;
+                    sel.clave = clave;
+                    sel.tamGrupo1 = g1;
+                }
+            }
+        }
+        return sel;
+    }
+    const Trabajo<int>& orden(const SeleccionSplit& sel) const { return ordenes_[sel.eje][sel.clave]; }
+
+private:
+    Trabajo<std::pair<double, int>> ampliacion_;   // chooseSubtree: {ampliacion de area, hijo}
+    Trabajo<std::pair<double, int>> dist_;         // reinsertar: {distancia^2, indice}
+    Trabajo<bool> quitar_;
+    Trabajo<CajaD> cajas_, pref_, suf_;            // split
+    Trabajo<int> ordenes_[DIM][2];                 // [eje][clave: 0=inferior, 1=superior]
+};
+
+// Capacidad de los nodos: M y m del constructor, o constantes de
+// compilacion en la variante fija (RStarTree2DFijo).
+template <int MFijo, int mFijo>
+struct CapacidadNodos {
+    static_assert(mFijo >= 2 && mFijo <= MFijo / 2, "m debe cumplir 2 <= m <= M/2");
+    static constexpr int M_ = MFijo, m_ = mFijo;
+    CapacidadNodos(int M, int m) {
+        if (M != MFijo || m != mFijo) throw std::invalid_argument("M y m son fijos en esta variante");
+    }
+};
+template <>
+struct CapacidadNodos<0, 0> {
+    int M_, m_;
+    CapacidadNodos(int M, int m) : M_(M), m_(m) {
         if (m < 2 || m > M / 2) throw std::invalid_argument("m debe cumplir 2 <= m <= M/2");
     }
-    ~RStarTree2D() { delete raiz_; }
+};
+
+template <typename T>
+class RStarTree2DMapeado;
+
+// R*-tree 2D con arena: las hojas guardan {x, y, idx} y el dato T completo
+// vive una sola vez en la arena (tramos fijos de T). Ver DISENO.md seccion 2.
+// Con MFijo > 0 la capacidad es constante de compilacion: ver RStarTree2DFijo.
+template <typename T, int MFijo = 0, int mFijo = 0>
+class RStarTree2D : CapacidadNodos<MFijo, mFijo> {
+    using Capacidad = CapacidadNodos<MFijo, mFijo>;
+    using Capacidad::M_;
+    using Capacidad::m_;
+    static constexpr bool FIJO = MFijo > 0;
+    struct Nodo;
+
+    template <typename E>
+    using Trabajo = TrabajoRStar<E, FIJO ? (size_t)MFijo + 1 : 0>;
+
+    // Recorrido en profundidad sin recursion: pila explicita de (nodo,
+    // proximo hijo) por nivel, acotada por la altura, sin memoria dinamica.
+    // Entrega las hojas cuyo MBR interseca la caja.
+    struct PilaRango {
+        static constexpr int MAX_ALTURA = 64;
+        const Nodo* nodo[MAX_ALTURA];
+        uint32_t sig[MAX_ALTURA];
+        int tope = -1;
+        Caja bbox;
+        void iniciar(const Nodo* raiz, const Caja& b) {
+            bbox = b;
+            tope = -1;
+            if (raiz != nullptr && raiz->mbr.interseca(b)) { tope = 0; nodo[0] = raiz; sig[0] = 0; }
+        }
+        const Nodo* proximaHoja() {
+            while (tope >= 0) {
+                const Nodo* n = nodo[tope];
+                if (n->esHoja) { tope--; return n; }
+                if (sig[tope] == n->hijos.n) { tope--; continue; }
+                const Nodo* h = n->hijos[sig[tope]++];
+                if (h->mbr.interseca(bbox)) { tope++; nodo[tope] = h; sig[tope] = 0; }
+            }
+            return nullptr;
+        }
+    };
+
+public:
+    struct Resultado { double x, y; uint32_t idx; };
+    // compactar(): posicion sin dato vivo en la tabla de reasignacion
+    static constexpr uint32_t SIN_IDX = std::numeric_limits<uint32_t>::max();
+
+    template <typename E>
+    using Bloque = BloqueCelda<E>;
+
+    // Hoja en columnas (structure of arrays): x[], y[] e idx[] contiguos en la
+    // celda del nodo, sin relleno entre entradas. Los escaneos de rango y kNN
+    // leen solo las columnas de coordenadas y arman el Resultado al confirmar
+    // un acierto; operator[] e iteradores devuelven Resultado por valor.
+    struct Columnas {
+        double* x = nullptr;
+        double* y = nullptr;
+        uint32_t* idx = nullptr;
+        uint32_t n = 0;
+
+        class iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = Resultado;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const Resultado*;
+            using reference = Resultado;
+            iterator(const Columnas* c, uint32_t i) : c_(c), i_(i) {}
+            Resultado operator*() const { return (*c_)[i_]; }
+            iterator& operator++() { i_++; return *this; }
+            iterator operator++(int) { iterator t = *this; i_++; return t; }
+            bool operator==(const iterator& o) const { return i_ == o.i_; }
+            bool operator!=(const iterator& o) const { return i_ != o.i_; }
+        private:
+            const Columnas* c_;
+            uint32_t i_;
+        };
+
+        size_t size() const { return n; }
+        bool empty() const { return n == 0; }
+        iterator begin() const { return iterator(this, 0); }
+        iterator end() const { return iterator(this, n); }
+        Resultado operator[](size_t i) const { return {x[i], y[i], idx[i]}; }
+        void poner(size_t i, const Resultado& e) { x[i] = e.x; y[i] = e.y; idx[i] = e.idx; }
+        void push_back(const Resultado& e) { poner(n++, e); }
+        void clear() { n = 0; }
+        void erase(size_t pos) {
+            std::copy(x + pos + 1, x + n, x + pos);
+            std::copy(y + pos + 1, y + n, y + pos);
+            std::copy(idx + pos + 1, idx + n, idx + pos);
+            n--;
+        }
+        template <typename It>
+        void assign(It a, It b) { n = 0; for (; a != b; ++a) push_back(*a); }
+    };
+
+    explicit RStarTree2D(int M = FIJO ? MFijo : 1200, int m = FIJO ? mFijo : 480)
+        : Capacidad(M, m),
+          poolHojas_(tamCelda(2 * sizeof(double) + sizeof(uint32_t), M)),
+          poolInternos_(tamCelda(sizeof(Nodo*), M)) {}
+    // Los nodos son trivialmente destructibles y viven en los pools:
+    // soltar los slabs libera el arbol entero sin recorrerlo.
+    ~RStarTree2D() = default;
     RStarTree2D(const RStarTree2D&) = delete;
     RStarTree2D& operator=(const RStarTree2D&) = delete;
 
     uint32_t insertar(double x, double y, T dato) {
-        arena_.push_back(std::move(dato));
-        uint32_t idx = (uint32_t)(arena_.size() - 1);
-        nivelReinsertado_.assign(64, false);   // OT1: un reinsert por nivel por operacion
+        uint32_t idx = alojar(std::move(dato));
+        reinsertados_ = 0;   // OT1: un reinsert por nivel por operacion
         insertarEntrada({x, y, idx});
         n_puntos_++;
         return idx;
     }
+
+    // Insercion por lotes (rafagas del feed en vivo). Los puntos se ordenan
+    // por clave de Hilbert y se agrupan: se desciende una vez por grupo, y
+    // los puntos que siguen y caen dentro del MBR de esa hoja (no la
+    // ampliarian) entran en ella sin volver a descender, hasta llenarla a
+    // M+1. Cada grupo ajusta los MBR hacia arriba una vez y desborda la hoja
+    // a lo sumo una vez; OT1 vale para el lote entero (un reinsert forzado
+    // por nivel por lote). Lo que se ahorra son descensos y ajustes, no
+    // divisiones: la misma hoja (o sus mitades) recibe un grupo tras otro y
+    // se divide cada vez que llega a M+1, asi que un lote concentrado en una
+    // hoja la divide varias veces, tantas como insertar de a uno (cada
+    // division necesita al menos m entradas nuevas en la mitad que la
+    // recibe). Elementos como en cargarMasivo ([x, y, dato]).
+    // Devuelve el idx del primero; los demas siguen consecutivos salvo con
+    // activarReuso, que llena primero los huecos: para saber el idx de cada
+    // uno, la version que los agrega a 'idxs' en el orden de entrada.
+    template <typename It>
+    uint32_t insertarLote(It primero, It ultimo) {
+        return insertarLoteEn(primero, ultimo, nullptr);
+    }
+    template <typename It>
+    uint32_t insertarLote(It primero, It ultimo, std::vector<uint32_t>& idxs) {
+        return insertarLoteEn(primero, ultimo, &idxs);
+    }
+
+    // Carga masiva de abajo hacia arriba (sin chooseSubTree ni reinserts).
+    // STR, Sort-Tile-Recursive (Leutenegger et al. 1997): ordena por x, corta
+    // en S = ceil(sqrt(P)) franjas, ordena cada franja por y y empaqueta hojas
+    // llenas; los niveles internos se arman igual sobre los centros.
+    // Hilbert (Kamel y Faloutsos 1993): ordena por clave de Hilbert (radix
+    // sort) y empaqueta hojas consecutivas; los niveles internos agrupan
+    // nodos consecutivos, que ya quedan en orden de curva.
+    // Cada elemento del rango se descompone como [x, y, dato] (tuple, struct);
+    // con std::make_move_iterator los datos se mueven a la arena.
+    template <typename It>
+    void cargarMasivo(It primero, It ultimo, Empaquetado modo = Empaquetado::STR) {
+        cargarMasivoEn(primero, ultimo, modo, nullptr);
+    }
+    // Igual, con los ordenamientos, el armado de hojas y los niveles
+    // superiores repartidos en el pool. Los ordenamientos son estables y los
+    // grupos se cortan igual, asi el arbol queda identico al de la version
+    // de un hilo. Llenar la arena sigue siendo secuencial (recorre el rango
+    // de entrada una vez).
+    template <typename It>
+    void cargarMasivo(It primero, It ultimo, Empaquetado modo, PoolHilos& pool) {
+        cargarMasivoEn(primero, ultimo, modo, &pool);
+    }
+
     const T& dato(uint32_t idx) const { return arena_[idx]; }
     T& dato(uint32_t idx) { return arena_[idx]; }
     size_t tamano() const { return n_puntos_; }
+    // Posiciones ocupadas en la arena (incluye los datos de puntos eliminados)
+    size_t tamanoArena() const { return arena_.size(); }
 
     std::vector<Resultado> buscarRango(const Caja& bbox) const {
         std::vector<Resultado> res;
-        rangoRec(raiz_, bbox, res);
+        buscarRango(bbox, res);
         return res;
     }
+    // Agrega los aciertos al final de un buffer del llamador (reusable entre
+    // consultas: sin reservas una vez que alcanzo su tamano de regimen).
+    void buscarRango(const Caja& bbox, std::vector<Resultado>& salida) const {
+        rangoDesde(raiz_, bbox, salida);
+    }
+
+    // Cursor de rango pull-style: entrega los aciertos hoja por hoja. Quien
+    // solo necesita los primeros N, o los vuelca a disco, nunca materializa
+    // la respuesta completa. El lote se reusa entre hojas y reiniciar()
+    // reusa el cursor para otra caja. Invalido si el arbol se modifica.
+    //   auto c = arbol.cursorRango(bbox);
+    //   while (c.siguiente()) for (const auto& r : c.lote()) ...
+    class CursorRango {
+    public:
+        bool siguiente() {   // avanza a la proxima hoja con aciertos
+            lote_.clear();
+            while (const Nodo* h = pila_.proximaHoja()) {
+                filtrarHoja(h, pila_.bbox, lote_);
+                if (!lote_.empty()) return true;
+            }
+            return false;
+        }
+        const std::vector<Resultado>& lote() const { return lote_; }
+        void reiniciar(const Caja& bbox) {
+            pila_.iniciar(arbol_->raiz_, bbox);
+            lote_.clear();
+        }
+    private:
+        friend class RStarTree2D;
+        CursorRango(const RStarTree2D* arbol, const Caja& bbox) : arbol_(arbol) { reiniciar(bbox); }
+        const RStarTree2D* arbol_;
+        PilaRango pila_;
+        std::vector<Resultado> lote_;
+    };
+    CursorRango cursorRango(const Caja& bbox) const { return CursorRango(this, bbox); }
+    // Cuantos puntos caen en la caja (R-tree agregado): un nodo cuyo MBR
+    // queda entero dentro de la caja suma su cuenta sin descender. Costo
+    // proporcional al borde de la caja, no a la cantidad de aciertos.
+    size_t contarEnRango(const Caja& bbox) const {
+        return raiz_ == nullptr ? 0 : contarRec(raiz_, bbox);
+    }
+
     void recorrer(const std::function<void(const Resultado&)>& visita) const {
         recorrerRec(raiz_, visita);
     }
 
     // Elimina la PRIMERA entrada en (x, y) cuyo dato cumple el predicado.
-    // La arena conserva el dato (tombstone): dato(idx) sigue valido, pero el
-    // punto deja de existir en el indice espacial. Condensacion del paper:
+    // La arena conserva el dato (tombstone): dato(idx) sigue valido (con
+    // activarReuso, hasta que un insert reusa el idx), pero el punto deja
+    // de existir en el indice espacial. Condensacion del paper:
     // nodos con underflow se disuelven y sus entradas se reinsertan.
     bool eliminar(double x, double y, const std::function<bool(const T&)>& coincide) {
         if (raiz_ == nullptr) return false;
@@ -96,103 +757,1328 @@ public:
         int pos = -1;
         buscarEntrada(raiz_, x, y, coincide, hoja, pos);
         if (hoja == nullptr) return false;
-        hoja->entradas.erase(hoja->entradas.begin() + pos);
+        quitarDeHoja(privado(hoja), (uint32_t)pos);
+        return true;
+    }
+
+    // Mapa inverso idx -> (hoja, posicion), opcional: con el, eliminarPorIdx
+    // y actualizar van directo a la entrada en vez de buscar por coordenadas
+    // (los puntos repetidos de los taxis hacen que eliminar visite muchas
+    // hojas). Se arma una vez en O(n) y lo mantienen al dia insertar, split,
+    // reinsert, condensar, las cargas y las eliminaciones. 16 bytes por
+    // posicion de la arena.
+    void activarUbicaciones() {
+        if (ubicar_) return;
+        ubicar_ = true;
+        ubicarSubarbol(raiz_);
+    }
+    bool ubicacionesActivas() const { return ubicar_; }
+
+    // Elimina la entrada de ese idx (requiere activarUbicaciones). false si
+    // el idx no esta en el indice espacial. Misma condensacion que eliminar.
+    bool eliminarPorIdx(uint32_t idx) {
+        Nodo* hoja = hojaDe(idx, "eliminarPorIdx");
+        if (hoja == nullptr) return false;
+        hoja = privado(hoja);
+        quitarDeHoja(hoja, ubicaciones_[idx].pos);
+        return true;
+    }
+    // Reemplaza el dato de idx y renueva la version de su hoja y de los
+    // subarboles que la contienen, asi los caches por version
+    // (GruposPorHoja, AgregadosPorNodo) se rearman; escribir en dato(idx)
+    // no les avisa. Requiere activarUbicaciones; false si el idx no esta.
+    // El dato se reescribe en su lugar de la arena, que las instantaneas
+    // leen sin candados: no admite instantaneas activas (eliminarPorIdx +
+    // insertar deja a los lectores el dato viejo).
+    bool actualizar(uint32_t idx, T dato) {
+        if (lectores_) throw std::logic_error("actualizar no admite instantaneas activas");
+        Nodo* hoja = hojaDe(idx, "actualizar");
+        if (hoja == nullptr) return false;
+        arena_[idx] = std::move(dato);
+        for (Nodo* n = privado(hoja); n != nullptr; n = n->padre) tocar(n);
+        return true;
+    }
+
+    // Mueve el punto idx a (nx, ny) conservando el idx (vehiculos que
+    // reportan posicion cada pocos segundos). Requiere activarUbicaciones.
+    // Camino rapido de abajo hacia arriba, al estilo del LUR-tree: si la
+    // nueva posicion cae en el MBR de su hoja, o en una ampliacion que no
+    // sale del MBR del padre ni agrega overlap con las hermanas, la entrada
+    // se cambia en su lugar y se renuevan las versiones del camino; los MBR
+    // se recalculan solo mientras cambian. Si no, y una hermana que ya
+    // cubre el punto tiene lugar, la entrada pasa a ella. Si no, eliminar +
+    // insertar (condensar, chooseSubtree, overflow). false si el idx no esta.
+    bool mover(uint32_t idx, double nx, double ny) {
+        Nodo* hoja = hojaDe(idx, "mover");
+        if (hoja == nullptr) return false;
+        uint32_t pos = ubicaciones_[idx].pos;
+        if (!cabeEnHoja(hoja, nx, ny)) {
+            if (Nodo* hermana = hermanaConLugar(hoja, nx, ny)) {
+                // pasa a una hermana que ya cubre el punto: sin underflow ni overflow
+                hoja = privado(hoja);
+                hermana = privado(hermana);
+                desubicar(idx);
+                hoja->entradas.erase(pos);
+                ubicar(hoja, pos);
+                hermana->entradas.push_back({nx, ny, idx});
+                ubicar(hermana, hermana->entradas.n - 1);
+                actualizarMBR(hoja);
+                actualizarMBR(hermana);
+                ajustarHaciaArriba(hoja->padre);
+                return true;
+            }
+            quitarDeHoja(privado(hoja), pos, false);
+            reinsertados_ = 0;
+            insertarEntrada({nx, ny, idx});
+            n_puntos_++;
+            return true;
+        }
+        hoja = privado(hoja);
+        Columnas& c = hoja->entradas;
+        const Caja& b = hoja->mbr;
+        bool recalcular = c.x[pos] == b.lo[0] || c.x[pos] == b.hi[0] || c.y[pos] == b.lo[1] ||
+                          c.y[pos] == b.hi[1] || !b.contiene(nx, ny);
+        c.x[pos] = nx;
+        c.y[pos] = ny;
+        for (Nodo* n = hoja; n != nullptr; n = n->padre) {
+            if (!recalcular) { tocar(n); continue; }
+            Caja antes = n->mbr;
+            actualizarMBR(n);
+            recalcular = !(antes.cubre(n->mbr) && n->mbr.cubre(antes));
+        }
+        return true;
+    }
+
+    // Eliminacion masiva (vencimiento de viajes). Primero quita todas las
+    // entradas que coinciden, despues condensa una sola vez subiendo nivel
+    // por nivel por los nodos tocados, y al final reinserta lo huerfano:
+    // los subarboles enteros en su nivel y las entradas sueltas, si son al
+    // menos M, empaquetadas en hojas llenas con STR en vez de una por una.
+    // Si lo huerfano es al menos lo que quedo en el arbol, lo rearma entero
+    // con STR. Como eliminar, los datos quedan en la arena. Devuelven
+    // cuantas quitaron.
+
+    // Todas las entradas dentro de bbox. Los subarboles que bbox cubre
+    // enteros se sueltan sin recorrer sus hojas.
+    size_t eliminarEnRango(const Caja& bbox) {
+        return eliminarDonde(&bbox, true, [](const Resultado&) { return true; });
+    }
+    // Las entradas dentro de bbox cuyo dato cumple el predicado
+    size_t eliminarEnRango(const Caja& bbox, const std::function<bool(const T&)>& coincide) {
+        return eliminarDonde(&bbox, false, [&](const Resultado& e) { return coincide(arena_[e.idx]); });
+    }
+    // Las entradas con esos idx (repetidos y fuera de la arena se ignoran).
+    // Con activarUbicaciones va directo a sus hojas; sin el mapa no hay
+    // poda: recorre todas las hojas una vez.
+    size_t eliminarLote(const std::vector<uint32_t>& idxs) {
+        std::vector<bool> marca(arena_.size(), false);
+        for (uint32_t i : idxs) if (i < marca.size()) marca[i] = true;
+        auto quita = [&](const Resultado& e) { return (bool)marca[e.idx]; };
+        if (!ubicar_) return eliminarDonde(nullptr, false, quita);
+        std::vector<Nodo*> hojas;
+        std::unordered_set<Nodo*> vistas;
+        for (uint32_t i : idxs) {
+            Nodo* h = i < ubicaciones_.size() ? ubicaciones_[i].hoja : nullptr;
+            if (h != nullptr && vistas.insert(h).second) hojas.push_back(h);
+        }
+        return quitarMarcadas(nullptr, quita, hojas, {});
+    }
+
+    // ---- Reuso y compactacion de la arena ----
+    // eliminar deja el dato en la arena y la arena solo crece: con una
+    // ventana deslizante (entran viajes nuevos, vencen los viejos) crece sin
+    // limite. activarReuso() lleva una lista de posiciones libres: lo que
+    // quita puntos del indice (eliminar, eliminarPorIdx, eliminarEnRango,
+    // eliminarLote) deja ahi su idx, e insertar / insertarLote la vacian
+    // antes de agregar al final. Al activarlo se recorren las hojas una vez
+    // para encontrar los huecos que ya habia. Con instantaneas, un idx
+    // liberado espera, como los nodos retirados, a que terminen los
+    // lectores que todavia podian verlo. Con Congelados vivos lanza
+    // logic_error, y si ya estaba activo insertar deja de reusar hasta que
+    // se suelten: el Congelado lee la arena por idx.
+    void activarReuso() {
+        if (reusar_) return;
+        if (congelados_) throw std::logic_error("activarReuso no admite Congelados vivos");
+        reusar_ = true;
+        buscarHuecos();
+    }
+    bool reusoActivo() const { return reusar_; }
+    // Posiciones de la arena listas para reusar
+    size_t huecosLibres() const { return libres_.size(); }
+
+    // Reescribe la arena con solo los datos vivos, en el orden de las hojas
+    // (puntos cercanos quedan cerca en memoria), reescribe los idx de las
+    // hojas y devuelve la tabla de reasignacion: remapeo[viejo] = nuevo, o
+    // SIN_IDX si el dato ya no estaba en el indice. Despues tamanoArena() ==
+    // tamano() y no quedan huecos. Lo que guarda idx por fuera se actualiza
+    // con la misma tabla (IndicePorId::remapear, GruposPorHoja::remapear);
+    // las versiones de las hojas no cambian, asi los caches siguen validos.
+    // No admite instantaneas activas (los lectores leen la arena sin
+    // candados) ni Congelados vivos (sus idx quedarian viejos o fuera de la
+    // arena recortada): congelar de nuevo despues de compactar.
+    std::vector<uint32_t> compactar() {
+        if (lectores_) throw std::logic_error("compactar no admite instantaneas activas");
+        if (congelados_) throw std::logic_error("compactar no admite Congelados vivos");
+        std::vector<uint32_t> remapeo(arena_.size(), SIN_IDX);
+        std::vector<uint32_t> orden;   // orden[nuevo] = viejo
+        orden.reserve(n_puntos_);
+        renumerar(raiz_, remapeo, orden);
+        std::vector<T> vivos;
+        vivos.reserve(orden.size());
+        for (uint32_t viejo : orden) vivos.push_back(std::move(arena_[viejo]));
+        for (size_t i = 0; i < vivos.size(); i++) arena_[i] = std::move(vivos[i]);
+        arena_.recortar(vivos.size());
+        libres_.clear();
+        if (ubicar_) {
+            ubicaciones_.assign(arena_.size(), Ubicacion());
+            ubicarSubarbol(raiz_);
+        }
+        return remapeo;
+    }
+
+    // k vecinos mas cercanos a (x, y), ordenados de mas cercano a mas lejano.
+    // Best-first sobre los MBRs con poda por el peor de los k hallados.
+    std::vector<Resultado> kVecinos(double x, double y, int k) const {
+        std::vector<Resultado> res;
+        if (raiz_ == nullptr || k <= 0) return res;
+        BufferVecinos buf;
+        res.resize(std::min((size_t)k, n_puntos_));
+        res.resize(kVecinos(x, y, k, buf, res.data()));
+        return res;
+    }
+
+    // Memoria de trabajo de kVecinos: colas y distancias de una hoja. Reusada
+    // entre consultas (una por hilo) no reserva nada en regimen.
+    struct BufferVecinos {
+        std::vector<std::pair<double, const Nodo*>> nodos;   // {dist2 minima al MBR, nodo}
+        std::vector<std::pair<double, Resultado>> mejores;   // max-heap de los mejores k
+        std::vector<double> dHoja;                           // distancias de una hoja
+        std::vector<std::pair<double, uint32_t>> lineas;     // idem nodos, por linea o nodo (Congelado, mapeado)
+    };
+    // Variante sin reservas: escribe los vecinos en salida (lugar para
+    // min(k, tamano()) resultados) y devuelve cuantos escribio.
+    size_t kVecinos(double x, double y, int k, BufferVecinos& buf, Resultado* salida) const {
+        return kVecinosDesde(raiz_, x, y, k, buf, salida);
+    }
+
+    // Vecinos en orden creciente de distancia, uno por vez (distance
+    // browsing, Hjaltason y Samet 1999). Una sola cola de prioridad mezcla
+    // nodos (por distancia a su MBR) y puntos: un punto sale de la cola solo
+    // cuando ningun nodo pendiente puede tener algo mas cerca. No hace falta
+    // conocer k: se pide el siguiente mientras haga falta, y la cola se
+    // conserva entre llamadas. El filtro opcional se evalua al sacar cada
+    // punto, en orden de distancia: solo se examinan los candidatos mas
+    // cercanos que el vecino que finalmente se entrega.
+    // Invalido si el arbol se modifica mientras se recorre.
+    //   auto it = arbol.vecinosIncrementales(x, y, [](const T& t) { return t.libre; });
+    //   while (it.siguiente()) { usar(it.actual()); if (basta) break; }
+    class IteradorVecinos {
+    public:
+        bool siguiente() {
+            while (!cola_.empty()) {
+                Item it = cola_.top();
+                cola_.pop();
+                if (it.nodo == nullptr) {
+                    if (filtro_ && !filtro_(arbol_->arena_[it.e.idx])) continue;
+                    actual_ = it.e;
+                    dist2_ = it.d2;
+                    return true;
+                }
+                const Nodo* n = it.nodo;
+                if (n->esHoja) {
+                    const Columnas& c = n->entradas;
+                    dHoja_.resize(c.n + 1);
+                    distancias2(c.x, c.y, c.n, x_, y_, dHoja_.data());
+                    for (uint32_t i = 0; i < c.n; i++) cola_.push({dHoja_[i], nullptr, c[i]});
+                } else {
+                    for (const Nodo* h : n->hijos) cola_.push({h->mbr.dist2A(x_, y_), h, Resultado{}});
+                }
+            }
+            return false;
+        }
+        const Resultado& actual() const { return actual_; }
+        double distancia2() const { return dist2_; }   // del vecino actual
+    private:
+        friend class RStarTree2D;
+        struct Item {
+            double d2;
+            const Nodo* nodo;   // nullptr => punto
+            Resultado e;
+        };
+        struct PorDistancia {
+            bool operator()(const Item& a, const Item& b) const { return a.d2 > b.d2; }
+        };
+        IteradorVecinos(const RStarTree2D* arbol, double x, double y, std::function<bool(const T&)> filtro)
+            : arbol_(arbol), x_(x), y_(y), filtro_(std::move(filtro)) {
+            if (arbol->raiz_ != nullptr) cola_.push({arbol->raiz_->mbr.dist2A(x, y), arbol->raiz_, Resultado{}});
+        }
+        const RStarTree2D* arbol_;
+        double x_, y_;
+        std::function<bool(const T&)> filtro_;
+        std::priority_queue<Item, std::vector<Item>, PorDistancia> cola_;
+        std::vector<double> dHoja_;
+        Resultado actual_{};
+        double dist2_ = 0.0;
+    };
+    IteradorVecinos vecinosIncrementales(double x, double y,
+                                         std::function<bool(const T&)> filtro = nullptr) const {
+        return IteradorVecinos(this, x, y, std::move(filtro));
+    }
+
+    // Inspeccion estructural (tests, estadisticas):
+    // f(esHoja, nivel, profundidad, mbr, nEntradas, nHijos, esRaiz)
+    void inspeccionar(const std::function<void(bool, int, int, const Caja&, size_t, size_t, bool)>& f) const {
+        inspeccionarRec(raiz_, 0, true, f);
+    }
+
+    // Calidad de la estructura, para comparar estrategias de carga.
+    // overlap: suma de areas de interseccion entre hermanos, todos los niveles.
+    // espacioMuerto: area cubierta que no cubre datos; en las hojas es todo
+    // su MBR (los puntos no tienen area), en los internos lo que el MBR
+    // excede a la suma de areas de sus hijos.
+    struct Calidad {
+        size_t hojas = 0, internos = 0;
+        int altura = 0;
+        double ocupacion = 0.0;      // entradas por nodo / M, promedio
+        double overlap = 0.0;
+        double espacioMuerto = 0.0;
+        double areaRaiz = 0.0;       // para normalizar las dos anteriores
+        size_t bytesNodos = 0;       // reservados por los pools de nodos
+    };
+    Calidad calidad() const {
+        Calidad c;
+        c.bytesNodos = poolHojas_.bytesReservados() + poolInternos_.bytesReservados();
+        if (raiz_ == nullptr) return c;
+        c.altura = raiz_->nivel + 1;
+        c.areaRaiz = raiz_->mbr.area();
+        double sumaOcupacion = 0.0;
+        calidadRec(raiz_, c, sumaOcupacion);
+        c.ocupacion = sumaOcupacion / (double)(c.hojas + c.internos);
+        return c;
+    }
+
+    // Vista de una hoja para caches externos (GruposPorHoja): la clave
+    // identifica la hoja y la version cambia con CADA mutacion de su contenido.
+    struct HojaVista {
+        uintptr_t clave;
+        uint64_t version;
+        const Caja& mbr;
+        const Columnas& entradas;
+    };
+    void visitarHojas(const std::function<void(const HojaVista&)>& f) const {
+        visitarHojasRec(raiz_, nullptr, f);
+    }
+    void visitarHojasEnRango(const Caja& bbox, const std::function<void(const HojaVista&)>& f) const {
+        visitarHojasRec(raiz_, &bbox, f);
+    }
+
+    // Vista de solo lectura de cualquier nodo, para capas externas que
+    // cachean resumenes por subarbol (AgregadosPorNodo). La version cambia
+    // cada vez que cambia algo dentro del subarbol: actualizarMBR la toca en
+    // todo el camino de cada mutacion.
+    class NodoVista {
+    public:
+        bool valida() const { return n_ != nullptr; }
+        uintptr_t clave() const { return (uintptr_t)n_; }
+        uint64_t version() const { return n_->version; }
+        const Caja& mbr() const { return n_->mbr; }
+        bool esHoja() const { return n_->esHoja; }
+        int nivel() const { return n_->nivel; }   // 0 = hoja
+        uint64_t cuenta() const { return n_->cuenta; }
+        const Columnas& entradas() const { return n_->entradas; }   // solo hojas
+        size_t nHijos() const { return n_->hijos.size(); }
+        NodoVista hijo(size_t i) const { return NodoVista(n_->hijos[i]); }
+    private:
+        friend class RStarTree2D;
+        explicit NodoVista(const Nodo* n) : n_(n) {}
+        const Nodo* n_;
+    };
+    NodoVista raiz() const { return NodoVista(raiz_); }
+
+    // ---- Instantaneas: lectores concurrentes con un escritor ----
+    // Tras activarInstantaneas() el arbol pasa a copia-en-escritura: insertar,
+    // eliminar, split, reinsertar y condensar no tocan un nodo ya publicado,
+    // lo clonan junto con el camino hasta la raiz (una vez por generacion) y
+    // cuelgan el clon. publicar() hace visible de un golpe todo lo escrito
+    // desde la publicacion anterior. Un lector toma una Instantanea (fija la
+    // raiz publicada y anuncia su epoca) y consulta un arbol inmutable sin
+    // candados ni esperas, mientras el escritor sigue. Los nodos reemplazados
+    // se reciclan recien cuando ningun lector anunciado en una epoca
+    // anterior sigue activo (reclamacion por epocas).
+    // Un solo escritor a la vez; los lectores solo usan Instantanea.
+    //   arbol.activarInstantaneas();
+    //   escritor: for (...) arbol.insertar(...); arbol.publicar();
+    //   lector:   auto s = arbol.instantanea(); s.buscarRango(caja, salida);
+    class Instantanea {
+    public:
+        Instantanea(Instantanea&& o) noexcept : arbol_(o.arbol_), raiz_(o.raiz_), ranura_(o.ranura_) {
+            o.ranura_ = nullptr;
+        }
+        Instantanea(const Instantanea&) = delete;
+        Instantanea& operator=(const Instantanea&) = delete;
+        Instantanea& operator=(Instantanea&&) = delete;
+        ~Instantanea() {
+            if (ranura_ != nullptr) ranura_->store(0);   // fin de la lectura
+        }
+
+        size_t tamano() const { return raiz_ == nullptr ? 0 : (size_t)raiz_->cuenta; }
+        const T& dato(uint32_t idx) const { return arbol_->arena_[idx]; }
+        std::vector<Resultado> buscarRango(const Caja& bbox) const {
+            std::vector<Resultado> res;
+            rangoDesde(raiz_, bbox, res);
+            return res;
+        }
+        void buscarRango(const Caja& bbox, std::vector<Resultado>& salida) const {
+            rangoDesde(raiz_, bbox, salida);
+        }
+        size_t contarEnRango(const Caja& bbox) const {
+            return raiz_ == nullptr ? 0 : contarRec(raiz_, bbox);
+        }
+        std::vector<Resultado> kVecinos(double x, double y, int k) const {
+            std::vector<Resultado> res;
+            if (raiz_ == nullptr || k <= 0) return res;
+            BufferVecinos buf;
+            res.resize(std::min((size_t)k, tamano()));
+            res.resize(arbol_->kVecinosDesde(raiz_, x, y, k, buf, res.data()));
+            return res;
+        }
+        size_t kVecinos(double x, double y, int k, BufferVecinos& buf, Resultado* salida) const {
+            return arbol_->kVecinosDesde(raiz_, x, y, k, buf, salida);
+        }
+    private:
+        friend class RStarTree2D;
+        Instantanea(const RStarTree2D* a, const Nodo* r, std::atomic<uint64_t>* ranura)
+            : arbol_(a), raiz_(r), ranura_(ranura) {}
+        const RStarTree2D* arbol_;
+        const Nodo* raiz_;
+        std::atomic<uint64_t>* ranura_;
+    };
+
+    void activarInstantaneas() {
+        if (lectores_) return;
+        lectores_ = std::make_unique<Lectores>();
+        genActual_ = 1;   // los nodos existentes (generacion 0) quedan publicados
+        lectores_->raiz.store(raiz_);
+    }
+    bool instantaneasActivas() const { return lectores_ != nullptr; }
+
+    // Escritor: publica la raiz actual y recicla los nodos retirados (y los
+    // idx liberados, con activarReuso) que ya ningun lector puede estar
+    // viendo.
+    void publicar() {
+        if (!lectores_) throw std::logic_error("publicar requiere activarInstantaneas()");
+        lectores_->raiz.store(raiz_);
+        uint64_t e = lectores_->epoca.fetch_add(1) + 1;
+        for (Nodo* n : retiradosGen_) retirados_.push_back({e, n});
+        retiradosGen_.clear();
+        for (uint32_t i : libresGen_) libresRetenidos_.push_back({e, i});
+        libresGen_.clear();
+        genActual_++;
+        reciclarRetirados();
+    }
+
+    // Lector (desde cualquier hilo): fija la ultima raiz publicada
+    Instantanea instantanea() const {
+        if (!lectores_) throw std::logic_error("instantanea requiere activarInstantaneas()");
+        Lectores& l = *lectores_;
+        size_t i = std::hash<std::thread::id>()(std::this_thread::get_id()) % Lectores::RANURAS;
+        for (;; i = (i + 1) % Lectores::RANURAS) {
+            uint64_t libre = 0;
+            // anunciar la epoca ANTES de leer la raiz: el escritor que no vea
+            // el anuncio ya publico una raiz que no usa lo que recicla
+            if (l.ranuras[i].e.load(std::memory_order_relaxed) == 0 &&
+                l.ranuras[i].e.compare_exchange_strong(libre, l.epoca.load()))
+                return Instantanea(this, l.raiz.load(), &l.ranuras[i].e);
+            if (i + 1 == Lectores::RANURAS) std::this_thread::yield();   // todas ocupadas
+        }
+    }
+
+    // Nodos reemplazados que esperan a que terminen lectores anteriores
+    size_t nodosRetenidos() const { return retirados_.size() + retiradosGen_.size(); }
+
+    // ---- Arbol congelado ----
+    // congelar() copia el indice a un solo bloque contiguo e inmutable, en
+    // orden BFS o van Emde Boas. Cada nodo ocupa lineas de cache enteras:
+    // cabecera, y despues los MBR de sus hijos uno al lado del otro seguidos
+    // de los numeros de linea de los hijos (internos) o las columnas x, y, idx
+    // (hojas). Decidir a que hijos bajar lee solo el bloque del padre, sin
+    // saltar a cada hijo. Pensado para arboles que ya no cambian despues de
+    // la carga; el Congelado no ve mutaciones posteriores y lee los datos de
+    // la arena del arbol, que debe seguir vivo. Mientras haya Congelados
+    // vivos los idx que guardan siguen valiendo: insertar no reusa huecos
+    // (agrega al final) y compactar / activarReuso lanzan logic_error. Para
+    // compactar, soltar los Congelados y volver a congelar despues.
+    //   auto fijo = arbol.congelar(Disposicion::vEB);
+    //   fijo.buscarRango(caja, salida);
+    class Congelado {
+    public:
+        // El arbol cuenta sus Congelados vivos para no mover ni reusar
+        // posiciones de la arena mientras alguno pueda leerlas
+        Congelado(const Congelado& o)
+            : arbol_(o.arbol_), bloque_(o.bloque_), mbrRaiz_(o.mbrRaiz_), puntos_(o.puntos_),
+              maxEntradas_(o.maxEntradas_) { if (arbol_) arbol_->congelados_++; }
+        Congelado(Congelado&& o) noexcept
+            : arbol_(o.arbol_), bloque_(std::move(o.bloque_)), mbrRaiz_(o.mbrRaiz_), puntos_(o.puntos_),
+              maxEntradas_(o.maxEntradas_) { o.arbol_ = nullptr; }
+        Congelado& operator=(Congelado o) noexcept {
+            std::swap(arbol_, o.arbol_);
+            std::swap(bloque_, o.bloque_);
+            std::swap(mbrRaiz_, o.mbrRaiz_);
+            std::swap(puntos_, o.puntos_);
+            std::swap(maxEntradas_, o.maxEntradas_);
+            return *this;
+        }
+        ~Congelado() { if (arbol_) arbol_->congelados_--; }
+
+        size_t tamano() const { return puntos_; }
+        size_t bytes() const { return bloque_.size() * sizeof(Linea); }
+        const T& dato(uint32_t idx) const { return arbol_->arena_[idx]; }
+        std::vector<Resultado> buscarRango(const Caja& bbox) const {
+            std::vector<Resultado> res;
+            buscarRango(bbox, res);
+            return res;
+        }
+        void buscarRango(const Caja& bbox, std::vector<Resultado>& salida) const {
+            hojasEn(&bbox, [&](uint32_t l, const Caja& mbr) { filtrarColumnas(columnas(l), mbr, bbox, salida); });
+        }
+        size_t contarEnRango(const Caja& bbox) const {
+            return bloque_.empty() ? 0 : contarLinea(0, mbrRaiz_, bbox);
+        }
+        std::vector<Resultado> kVecinos(double x, double y, int k) const {
+            std::vector<Resultado> res;
+            if (bloque_.empty() || k <= 0) return res;
+            BufferVecinos buf;
+            res.resize(std::min((size_t)k, puntos_));
+            res.resize(kVecinos(x, y, k, buf, res.data()));
+            return res;
+        }
+        size_t kVecinos(double x, double y, int k, BufferVecinos& buf, Resultado* salida) const {
+            if (bloque_.empty() || k <= 0) return 0;
+            auto cmpN = [](const std::pair<double, uint32_t>& a,
+                           const std::pair<double, uint32_t>& b) { return a.first > b.first; };
+            auto& lineas = buf.lineas;
+            lineas.clear();
+            buf.mejores.clear();
+            buf.dHoja.resize(maxEntradas_ + 4);
+            lineas.push_back({mbrRaiz_.dist2A(x, y), 0});
+            while (!lineas.empty()) {
+                std::pop_heap(lineas.begin(), lineas.end(), cmpN);
+                auto [d2, l] = lineas.back();
+                lineas.pop_back();
+                if ((int)buf.mejores.size() == k && d2 > buf.mejores.front().first) break;   // poda
+                const Cabecera& c = cabecera(l);
+                if (c.hoja) {
+                    mejoresDeHoja(columnas(l), x, y, k, buf);
+                    continue;
+                }
+                const Caja* m = mbrs(l);
+                const uint32_t* h = hijos(l);
+                for (uint32_t i = 0; i < c.n; i++) {
+                    lineas.push_back({m[i].dist2A(x, y), h[i]});
+                    std::push_heap(lineas.begin(), lineas.end(), cmpN);
+                }
+            }
+            return volcarMejores(buf, salida);
+        }
+        // Misma vista que RStarTree2D; la clave es la linea del nodo en el bloque
+        void visitarHojas(const std::function<void(const HojaVista&)>& f) const {
+            hojasEn(nullptr, [&](uint32_t l, const Caja& mbr) { visitar(l, mbr, f); });
+        }
+        void visitarHojasEnRango(const Caja& bbox, const std::function<void(const HojaVista&)>& f) const {
+            hojasEn(&bbox, [&](uint32_t l, const Caja& mbr) { visitar(l, mbr, f); });
+        }
+
+    private:
+        friend class RStarTree2D;
+        struct alignas(64) Linea { unsigned char b[64]; };
+        struct Cabecera {
+            uint32_t n;          // hijos o entradas
+            uint32_t hoja;
+            uint64_t cuenta;     // puntos del subarbol
+            uint64_t version;
+            uint64_t relleno;    // los MBR quedan alineados a 32 bytes
+        };
+        static constexpr int MAX_ALTURA = 64;
+
+        explicit Congelado(const RStarTree2D* a) : arbol_(a) { arbol_->congelados_++; }
+        static size_t lineasDe(const Nodo* n) {
+            size_t bytes = sizeof(Cabecera) + (n->esHoja ? n->entradas.n * (2 * sizeof(double) + sizeof(uint32_t))
+                                                         : n->hijos.n * (sizeof(Caja) + sizeof(uint32_t)));
+            return (bytes + sizeof(Linea) - 1) / sizeof(Linea);
+        }
+        const unsigned char* base(uint32_t l) const { return bloque_[l].b; }
+        const Cabecera& cabecera(uint32_t l) const { return *(const Cabecera*)base(l); }
+        const Caja* mbrs(uint32_t l) const { return (const Caja*)(base(l) + sizeof(Cabecera)); }
+        const uint32_t* hijos(uint32_t l) const { return (const uint32_t*)(mbrs(l) + cabecera(l).n); }
+        Columnas columnas(uint32_t l) const {
+            Columnas c;
+            c.n = cabecera(l).n;
+            c.x = (double*)(base(l) + sizeof(Cabecera));   // vista de solo lectura
+            c.y = c.x + c.n;
+            c.idx = (uint32_t*)(c.y + c.n);
+            return c;
+        }
+        void visitar(uint32_t l, const Caja& mbr, const std::function<void(const HojaVista&)>& f) const {
+            Columnas c = columnas(l);
+            f(HojaVista{(uintptr_t)l, cabecera(l).version, mbr, c});
+        }
+        // Hojas cuyo MBR interseca la caja (todas si es nullptr), en orden,
+        // con pila de (linea, proximo hijo) por nivel como PilaRango
+        template <typename F>
+        void hojasEn(const Caja* bbox, F&& f) const {
+            if (bloque_.empty() || (bbox != nullptr && !mbrRaiz_.interseca(*bbox))) return;
+            uint32_t linea[MAX_ALTURA], sig[MAX_ALTURA];
+            const Caja* mbr[MAX_ALTURA];
+            int tope = 0;
+            linea[0] = 0; sig[0] = 0; mbr[0] = &mbrRaiz_;
+            while (tope >= 0) {
+                uint32_t l = linea[tope];
+                const Cabecera& c = cabecera(l);
+                if (c.hoja) { f(l, *mbr[tope]); tope--; continue; }
+                if (sig[tope] == c.n) { tope--; continue; }
+                uint32_t i = sig[tope]++;
+                const Caja& m = mbrs(l)[i];
+                if (bbox == nullptr || m.interseca(*bbox)) {
+                    tope++;
+                    linea[tope] = hijos(l)[i]; sig[tope] = 0; mbr[tope] = &m;
+                }
+            }
+        }
+        size_t contarLinea(uint32_t l, const Caja& mbr, const Caja& bbox) const {
+            if (!mbr.interseca(bbox)) return 0;
+            const Cabecera& c = cabecera(l);
+            if (bbox.cubre(mbr)) return (size_t)c.cuenta;
+            if (c.hoja) return contarColumnas(columnas(l), bbox);
+            size_t total = 0;
+            for (uint32_t i = 0; i < c.n; i++) total += contarLinea(hijos(l)[i], mbrs(l)[i], bbox);
+            return total;
+        }
+
+        const RStarTree2D* arbol_;
+        std::vector<Linea> bloque_;
+        Caja mbrRaiz_;
+        size_t puntos_ = 0;
+        uint32_t maxEntradas_ = 0;
+    };
+
+    Congelado congelar(Disposicion disposicion = Disposicion::BFS) const {
+        Congelado c(this);
+        if (raiz_ == nullptr) return c;
+        if (raiz_->nivel + 1 > Congelado::MAX_ALTURA) throw std::length_error("congelar: arbol demasiado alto");
+        std::vector<const Nodo*> orden;
+        if (disposicion == Disposicion::BFS) {
+            orden.push_back(raiz_);
+            for (size_t i = 0; i < orden.size(); i++)
+                for (const Nodo* h : orden[i]->hijos) orden.push_back(h);
+        } else {
+            ordenVEB(raiz_, raiz_->nivel + 1, orden);
+        }
+        std::unordered_map<const Nodo*, uint32_t> linea;
+        linea.reserve(orden.size());
+        size_t total = 0;
+        for (const Nodo* n : orden) {
+            linea[n] = (uint32_t)total;
+            total += Congelado::lineasDe(n);
+            if (total > UINT32_MAX) throw std::length_error("congelar: bloque de mas de 2^32 lineas");
+        }
+        c.bloque_.resize(total);
+        for (const Nodo* n : orden) {
+            unsigned char* p = c.bloque_[linea[n]].b;
+            auto& cab = *(typename Congelado::Cabecera*)p;
+            cab = {n->esHoja ? n->entradas.n : n->hijos.n, n->esHoja ? 1u : 0u, n->cuenta, n->version, 0};
+            p += sizeof(typename Congelado::Cabecera);
+            if (n->esHoja) {
+                const Columnas& e = n->entradas;
+                std::memcpy(p, e.x, e.n * sizeof(double));
+                std::memcpy(p + e.n * sizeof(double), e.y, e.n * sizeof(double));
+                std::memcpy(p + 2 * e.n * sizeof(double), e.idx, e.n * sizeof(uint32_t));
+                c.maxEntradas_ = std::max(c.maxEntradas_, e.n);
+            } else {
+                Caja* m = (Caja*)p;
+                uint32_t* h = (uint32_t*)(m + n->hijos.n);
+                for (uint32_t i = 0; i < n->hijos.n; i++) {
+                    m[i] = n->hijos[i]->mbr;
+                    h[i] = linea[n->hijos[i]];
+                }
+            }
+        }
+        c.mbrRaiz_ = raiz_->mbr;
+        c.puntos_ = (size_t)raiz_->cuenta;
+        return c;
+    }
+
+    // ---- Archivo binario ----
+    // guardar escribe un solo archivo versionado: cabecera (formato, M, m,
+    // sizeof(T), cantidades), los nodos en preorden (MBR, version y cuenta;
+    // las hojas con sus tres columnas, los internos seguidos de sus hijos) y
+    // la arena. cargar reconstruye el arbol sin insertar: cada columna se lee
+    // directo a la celda de su hoja y, con T trivialmente copiable, la arena
+    // se lee de a tramos de 4096 T. Para otros T se pasan
+    // escribir(std::ostream&, const T&) y leer(std::istream&) -> T.
+    // El arbol destino debe estar vacio y tener los mismos M y m. El archivo
+    // usa el orden de bytes de la maquina (se verifica al cargar).
+    void guardar(const std::string& ruta) const {
+        static_assert(std::is_trivially_copyable_v<T>, "T no trivial: usar guardar(ruta, escribir)");
+        guardarCon(ruta, sizeof(T), [&](std::ostream& out) {
+            arena_.porTramos([&](const T* datos, size_t n) {
+                out.write((const char*)datos, (std::streamsize)(n * sizeof(T)));
+            });
+        });
+    }
+    template <typename Escribir>
+    void guardar(const std::string& ruta, Escribir escribir) const {
+        guardarCon(ruta, 0, [&](std::ostream& out) {
+            for (size_t i = 0; i < arena_.size(); i++) escribir(out, arena_[i]);
+        });
+    }
+    void cargar(const std::string& ruta) {
+        static_assert(std::is_trivially_copyable_v<T>, "T no trivial: usar cargar(ruta, leer)");
+        cargarCon(ruta, sizeof(T), [&](std::istream& in, size_t n) {
+            arena_.agregarCrudo(n, [&](void* destino, size_t bytes) {
+                in.read((char*)destino, (std::streamsize)bytes);
+                if (!in) throw std::runtime_error("cargar: archivo truncado (arena)");
+            });
+        });
+    }
+    template <typename Leer>
+    void cargar(const std::string& ruta, Leer leer) {
+        cargarCon(ruta, 0, [&](std::istream& in, size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                arena_.push_back(leer(in));
+                if (!in) throw std::runtime_error("cargar: archivo truncado (arena)");
+            }
+        });
+    }
+
+private:
+    // usa los filtros de hoja (filtrarColumnas, contarColumnas, mejoresDeHoja)
+    template <typename> friend class RStarTree2DMapeado;
+
+    struct Nodo {
+        bool esHoja;
+        int nivel = 0;                   // 0 = hoja
+        Caja mbr;
+        Bloque<Nodo*> hijos;             // solo internos
+        Columnas entradas;               // solo hojas
+        Nodo* padre = nullptr;
+        uint64_t version = 0;            // del subarbol, para caches externos
+        uint64_t cuenta = 0;             // puntos del subarbol (contarEnRango)
+        uint64_t gen = 0;                // generacion de escritura (instantaneas)
+        explicit Nodo(bool hoja) : esHoja(hoja) {}
+        Nodo(const Nodo&) = delete;
+        Nodo& operator=(const Nodo&) = delete;
+    };
+
+    using Pool = PoolCeldas;
+    using Arena = ArenaTramos<T>;
+
+    // Estado compartido con los lectores de instantaneas: raiz publicada,
+    // epoca global y una ranura por lector activo (0 = libre), cada una en
+    // su propia linea de cache.
+    struct Lectores {
+        static constexpr size_t RANURAS = 128;
+        struct alignas(64) Ranura { std::atomic<uint64_t> e{0}; };
+        std::atomic<const Nodo*> raiz{nullptr};
+        std::atomic<uint64_t> epoca{1};
+        Ranura ranuras[RANURAS];
+    };
+
+    static constexpr size_t desplazamientoDatos() { return Pool::desplazamientoDatos(sizeof(Nodo)); }
+    static size_t tamCelda(size_t tamEntrada, int M) { return Pool::tamCelda(sizeof(Nodo), tamEntrada, M); }
+
+    Pool poolHojas_, poolInternos_;
+    Arena arena_;
+    Nodo* raiz_ = nullptr;
+    size_t n_puntos_ = 0;
+    uint64_t contadorVersion_ = 0;
+    uint64_t reinsertados_ = 0;          // OT1: bit por nivel ya reinsertado en esta operacion
+    // Memoria de trabajo de insertar y eliminar, reusada entre operaciones:
+    // en regimen no se reserva nada (solo crecen arena y pools). split,
+    // elegirSplit y el armado de reinsertar no se anidan; lo que reinsertar
+    // reinserta se recorre mientras otras operaciones anidadas corren, pero
+    // en otros niveles (OT1), asi que va una lista por nivel.
+    struct Quitados {
+        Trabajo<Resultado> entradas;
+        Trabajo<Nodo*> subarboles;
+    };
+    using Eleccion = EleccionRStar<2, FIJO ? (size_t)MFijo + 1 : 0>;
+    struct Borrador {
+        Eleccion eleccion;                            // chooseSubtree, reinsertar y split
+        std::vector<Quitados> quitados;               // por nivel
+        Trabajo<Resultado> copiaEntradas;
+        Trabajo<Nodo*> copiaHijos;
+        std::vector<Resultado> huerfanas;             // condensar
+        std::vector<Nodo*> huerfanos;
+    };
+    Borrador borrador_;
+    // mapa inverso idx -> lugar en su hoja (activarUbicaciones); hoja nula:
+    // el idx no esta en el indice espacial
+    struct Ubicacion {
+        Nodo* hoja = nullptr;
+        uint32_t pos = 0;
+    };
+    std::vector<Ubicacion> ubicaciones_;
+    bool ubicar_ = false;
+    // posiciones de la arena reusables (activarReuso); con instantaneas, los
+    // idx liberados en esta generacion y los que esperan su epoca
+    std::vector<uint32_t> libres_;
+    std::vector<uint32_t> libresGen_;
+    std::vector<std::pair<uint64_t, uint32_t>> libresRetenidos_;
+    bool reusar_ = false;
+    // Congelados vivos: leen la arena por idx, que no se mueve ni se reusa
+    mutable size_t congelados_ = 0;
+    // instantaneas: los nodos con gen < genActual_ estan publicados y no se
+    // modifican; los reemplazados esperan en retirados_ con su epoca
+    std::unique_ptr<Lectores> lectores_;
+    uint64_t genActual_ = 0;
+    std::vector<Nodo*> retiradosGen_;
+    std::vector<std::pair<uint64_t, Nodo*>> retirados_;
+
+    void tocar(Nodo* hoja) { hoja->version = ++contadorVersion_; }
+
+    // Mapa inverso: apunta las entradas [desde, n) de la hoja a su lugar.
+    // Todo lo que mueve entradas de hoja lo llama; sin mapa no hace nada.
+    void ubicar(Nodo* hoja, uint32_t desde = 0) {
+        if (!ubicar_) return;
+        if (ubicaciones_.size() < arena_.size()) ubicaciones_.resize(arena_.size());
+        const Columnas& c = hoja->entradas;
+        for (uint32_t i = desde; i < c.n; i++) ubicaciones_[c.idx[i]] = {hoja, i};
+    }
+    void desubicar(uint32_t idx) {
+        if (ubicar_) ubicaciones_[idx] = Ubicacion();
+    }
+    void ubicarSubarbol(Nodo* n) {
+        if (n == nullptr) return;
+        if (n->esHoja) ubicar(n);
+        else for (Nodo* h : n->hijos) ubicarSubarbol(h);
+    }
+    // El idx salio del indice espacial: se desubica y, con reuso, queda
+    // libre (con instantaneas, recien cuando ningun lector pueda verlo)
+    void soltarIdx(uint32_t idx) {
+        desubicar(idx);
+        if (reusar_) (lectores_ ? libresGen_ : libres_).push_back(idx);
+    }
+    void soltarSubarbol(const Nodo* n) {
+        if (n->esHoja) for (uint32_t i = 0; i < n->entradas.n; i++) soltarIdx(n->entradas.idx[i]);
+        else for (const Nodo* h : n->hijos) soltarSubarbol(h);
+    }
+    // Nueva posicion para un dato: un hueco si hay (y ningun Congelado puede
+    // leerlo), si no al final
+    bool hayHueco() const { return !libres_.empty() && congelados_ == 0; }
+    template <typename U>
+    uint32_t alojar(U&& dato) {
+        if (!hayHueco()) {
+            arena_.push_back(std::forward<U>(dato));
+            return (uint32_t)(arena_.size() - 1);
+        }
+        uint32_t idx = libres_.back();
+        libres_.pop_back();
+        arena_[idx] = std::forward<U>(dato);
+        return idx;
+    }
+    // Lista de libres desde cero: las posiciones de la arena que no estan en
+    // ninguna hoja, de modo que se reusen primero las mas bajas
+    void buscarHuecos() {
+        std::vector<bool> vivo(arena_.size(), false);
+        recorrerNodos(raiz_, [&](const Nodo* n) {
+            if (n->esHoja) for (uint32_t i = 0; i < n->entradas.n; i++) vivo[n->entradas.idx[i]] = true;
+        });
+        libres_.clear();
+        for (size_t i = vivo.size(); i-- > 0;)
+            if (!vivo[i]) (lectores_ ? libresGen_ : libres_).push_back((uint32_t)i);
+    }
+    // compactar: nuevos idx consecutivos en el orden del recorrido
+    static void renumerar(Nodo* n, std::vector<uint32_t>& remapeo, std::vector<uint32_t>& orden) {
+        if (n == nullptr) return;
+        if (!n->esHoja) {
+            for (Nodo* h : n->hijos) renumerar(h, remapeo, orden);
+            return;
+        }
+        for (uint32_t i = 0; i < n->entradas.n; i++) {
+            uint32_t& idx = n->entradas.idx[i];
+            remapeo[idx] = (uint32_t)orden.size();
+            orden.push_back(idx);
+            idx = remapeo[idx];
+        }
+    }
+    Nodo* hojaDe(uint32_t idx, const char* quien) const {
+        if (!ubicar_) throw std::logic_error(std::string(quien) + " requiere activarUbicaciones()");
+        return idx < ubicaciones_.size() ? ubicaciones_[idx].hoja : nullptr;
+    }
+
+    // Camino rapido de mover: (nx, ny) cae en el MBR de la hoja, o en una
+    // ampliacion dentro del MBR del padre que no agrega overlap con las
+    // hermanas. Una hoja raiz no tiene hermanas: siempre cabe.
+    static bool cabeEnHoja(const Nodo* hoja, double nx, double ny) {
+        if (hoja->mbr.contiene(nx, ny)) return true;
+        const Nodo* p = hoja->padre;
+        if (p == nullptr) return true;
+        if (!p->mbr.contiene(nx, ny)) return false;
+        Caja ampliada = hoja->mbr;
+        ampliada.estirar(nx, ny);
+        for (const Nodo* h : p->hijos)
+            if (h != hoja && ampliada.overlap(h->mbr) > hoja->mbr.overlap(h->mbr)) return false;
+        return true;
+    }
+
+    // Segundo camino de mover: una hermana cuyo MBR ya cubre (nx, ny) y
+    // tiene lugar, si la hoja puede ceder una entrada sin quedar bajo m.
+    Nodo* hermanaConLugar(const Nodo* hoja, double nx, double ny) const {
+        const Nodo* p = hoja->padre;
+        if (p == nullptr || (int)hoja->entradas.n <= m_) return nullptr;
+        for (Nodo* h : p->hijos)
+            if (h != hoja && (int)h->entradas.n < M_ && h->mbr.contiene(nx, ny)) return h;
+        return nullptr;
+    }
+
+    // Quita la entrada pos de una hoja ya privada y condensa (eliminar).
+    // soltar = false: el idx vuelve enseguida al indice (mover)
+    void quitarDeHoja(Nodo* hoja, uint32_t pos, bool soltar = true) {
+        if (soltar) soltarIdx(hoja->entradas.idx[pos]);
+        else desubicar(hoja->entradas.idx[pos]);
+        hoja->entradas.erase(pos);
+        ubicar(hoja, pos);
         tocar(hoja);
         n_puntos_--;
-        nivelReinsertado_.assign(64, false);
+        reinsertados_ = 0;
         condensar(hoja);
-        // raiz interna con un solo hijo: acortar el arbol
+        acortarRaiz();
+    }
+    // raiz interna con un solo hijo: acortar el arbol
+    void acortarRaiz() {
         while (raiz_ != nullptr && !raiz_->esHoja && raiz_->hijos.size() == 1) {
             Nodo* h = raiz_->hijos[0];
-            raiz_->hijos.clear();
-            delete raiz_;
+            liberar(raiz_);
             raiz_ = h;
             h->padre = nullptr;
         }
-        return true;
     }
 
-    // k vecinos mas cercanos a (x, y), ordenados de mas cercano a mas lejano.
-    // Best-first sobre los MBRs con poda por el peor de los k hallados.
-    std::vector<Resultado> kVecinos(double x, double y, int k) const {
-        std::vector<Resultado> res;
-        if (raiz_ == nullptr || k <= 0) return res;
+    Nodo* nuevoNodo(bool hoja) {
+        void* celda = (hoja ? poolHojas_ : poolInternos_).tomar();
+        Nodo* n = new (celda) Nodo(hoja);
+        n->gen = genActual_;
+        unsigned char* datos = (unsigned char*)celda + desplazamientoDatos();
+        if (hoja) {
+            size_t cap = (size_t)M_ + 1;
+            n->entradas.x = (double*)datos;
+            n->entradas.y = n->entradas.x + cap;
+            n->entradas.idx = (uint32_t*)(n->entradas.y + cap);
+        } else {
+            n->hijos.d = (Nodo**)datos;
+        }
+        return n;
+    }
+    void liberar(Nodo* n) {
+        if (n->gen != genActual_) retiradosGen_.push_back(n);   // publicado: algun lector puede verlo
+        else (n->esHoja ? poolHojas_ : poolInternos_).devolver(n);
+    }
+
+    template <typename It>
+    uint32_t insertarLoteEn(It primero, It ultimo, std::vector<uint32_t>* idxs) {
+        uint32_t primerIdx = hayHueco() ? libres_.back() : (uint32_t)arena_.size();
+        std::vector<Resultado> lote;
+        for (It it = primero; it != ultimo; ++it) {
+            auto&& [x, y, d] = *it;
+            uint32_t idx;
+            if constexpr (std::is_rvalue_reference_v<decltype(*it)>) idx = alojar(std::move(d));
+            else idx = alojar(d);
+            lote.push_back({(double)x, (double)y, idx});
+            if (idxs != nullptr) idxs->push_back(idx);
+        }
+        if (lote.empty()) return primerIdx;
+        ordenarHilbert(lote, nullptr);   // solo el orden: los grupos de hojas no se usan
+        if (raiz_ == nullptr) raiz_ = nuevoNodo(true);
+        reinsertados_ = 0;
+        size_t i = 0;
+        while (i < lote.size()) {
+            const Resultado& e = lote[i];
+            Nodo* hoja = privado(chooseSubTree(Caja(e.x, e.y, e.x, e.y), 0));
+            Caja mbr = hoja->mbr;   // el de antes del grupo: dentro no amplia nada
+            uint32_t desde = hoja->entradas.n;
+            hoja->entradas.push_back(lote[i++]);
+            while (i < lote.size() && (int)hoja->entradas.size() <= M_ && mbr.contiene(lote[i].x, lote[i].y))
+                hoja->entradas.push_back(lote[i++]);
+            ubicar(hoja, desde);
+            tocar(hoja);
+            ajustarHaciaArriba(hoja);
+            if ((int)hoja->entradas.size() > M_) overflowTreatment(hoja);
+        }
+        n_puntos_ += lote.size();
+        return primerIdx;
+    }
 
-        using ItemN = std::pair<double, const Nodo*>;   // {dist2 minima al MBR, nodo}
-        auto cmpN = [](const ItemN& a, const ItemN& b) { return a.first > b.first; };
-        std::priority_queue<ItemN, std::vector<ItemN>, decltype(cmpN)> nodos(cmpN);
-        nodos.push({raiz_->mbr.dist2A(x, y), raiz_});
+    template <typename It>
+    void cargarMasivoEn(It primero, It ultimo, Empaquetado modo, PoolHilos* pool) {
+        if (raiz_ != nullptr || !arena_.empty())
+            throw std::logic_error("cargarMasivo requiere un arbol vacio");
+        std::vector<Resultado> entradas;
+        for (It it = primero; it != ultimo; ++it) {
+            auto&& [x, y, d] = *it;
+            if constexpr (std::is_rvalue_reference_v<decltype(*it)>) arena_.push_back(std::move(d));
+            else arena_.push_back(d);
+            entradas.push_back({(double)x, (double)y, (uint32_t)(arena_.size() - 1)});
+        }
+        raiz_ = empaquetar(entradas, modo, pool);
+        n_puntos_ = entradas.size();
+    }
 
-        using ItemP = std::pair<double, Resultado>;     // max-heap de los mejores k
-        auto cmpP = [](const ItemP& a, const ItemP& b) { return a.first < b.first; };
-        std::priority_queue<ItemP, std::vector<ItemP>, decltype(cmpP)> mejores(cmpP);
+    // Arma un subarbol de abajo hacia arriba con las entradas (las reordena)
+    // y devuelve su raiz, o nullptr si no hay entradas.
+    Nodo* empaquetar(std::vector<Resultado>& entradas, Empaquetado modo, PoolHilos* pool) {
+        if (entradas.empty()) return nullptr;
 
-        while (!nodos.empty()) {
-            auto [d2, n] = nodos.top();
-            nodos.pop();
-            if ((int)mejores.size() == k && d2 > mejores.top().first) break;   // poda
+        // entradas: desempate por la otra coordenada y por idx (orden total)
+        std::vector<std::pair<size_t, size_t>> grupos = (modo == Empaquetado::STR)
+            ? teselarSTR(entradas,
+                         [](const Resultado& a, const Resultado& b) {
+                             return std::tie(a.x, a.y, a.idx) < std::tie(b.x, b.y, b.idx); },
+                         [](const Resultado& a, const Resultado& b) {
+                             return std::tie(a.y, a.x, a.idx) < std::tie(b.y, b.x, b.idx); },
+                         true, pool)
+            : ordenarHilbert(entradas, pool);
+        // el pool de nodos no es concurrente: se toman las celdas en orden y
+        // se llenan en paralelo
+        std::vector<Nodo*> nivel(grupos.size());
+        for (Nodo*& h : nivel) h = nuevoNodo(true);
+        paraCadaEn(pool, grupos.size(), 16, [&](size_t g) {
+            nivel[g]->entradas.assign(entradas.begin() + grupos[g].first, entradas.begin() + grupos[g].second);
+            recalcularMBR(nivel[g]);
+        });
+        for (Nodo* h : nivel) { tocar(h); ubicar(h); }
+        while (nivel.size() > 1) {
+            if (modo == Empaquetado::STR) {
+                grupos = teselarSTR(nivel,
+                                    [](const Nodo* a, const Nodo* b) {
+                                        return a->mbr.lo[0] + a->mbr.hi[0] < b->mbr.lo[0] + b->mbr.hi[0]; },
+                                    [](const Nodo* a, const Nodo* b) {
+                                        return a->mbr.lo[1] + a->mbr.hi[1] < b->mbr.lo[1] + b->mbr.hi[1]; },
+                                    false, pool);
+            } else {
+                grupos.clear();
+                cortarEnGrupos(0, nivel.size(), grupos);
+            }
+            std::vector<Nodo*> superior(grupos.size());
+            for (Nodo*& p : superior) p = nuevoNodo(false);
+            paraCadaEn(pool, grupos.size(), 4, [&](size_t g) {
+                Nodo* p = superior[g];
+                auto [ini, fin] = grupos[g];
+                p->nivel = nivel[ini]->nivel + 1;
+                p->hijos.assign(nivel.begin() + ini, nivel.begin() + fin);
+                for (Nodo* h : p->hijos) h->padre = p;
+                recalcularMBR(p);
+            });
+            for (Nodo* p : superior) tocar(p);
+            nivel = std::move(superior);
+        }
+        return nivel[0];
+    }
+
+    static constexpr char MAGIA_ARCHIVO[8] = "RSTAR2D";
+    static constexpr uint32_t FORMATO_ARCHIVO = 1;
+    static constexpr uint32_t ORDEN_BYTES = 0x01020304;
+    struct CabeceraArchivo {
+        char magia[8];
+        uint32_t formato, ordenBytes;
+        int32_t M, m;
+        uint32_t tamT;        // sizeof(T) con arena cruda, 0 con serializador
+        uint32_t relleno;
+        uint64_t puntos, arena, nodos, contadorVersion;
+    };
+    struct RegistroNodo {
+        uint8_t esHoja, relleno[3];
+        int32_t nivel;
+        uint32_t n;           // entradas (hoja) o hijos (interno)
+        uint32_t relleno2;
+        double lo[2], hi[2];
+        uint64_t version, cuenta;
+    };
+
+    template <typename EscribirArena>
+    void guardarCon(const std::string& ruta, uint32_t tamT, EscribirArena escribirArena) const {
+        std::ofstream out(ruta, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("guardar: no se pudo abrir " + ruta);
+        CabeceraArchivo c{};
+        std::memcpy(c.magia, MAGIA_ARCHIVO, sizeof c.magia);
+        c.formato = FORMATO_ARCHIVO;
+        c.ordenBytes = ORDEN_BYTES;
+        c.M = M_;
+        c.m = m_;
+        c.tamT = tamT;
+        c.puntos = n_puntos_;
+        c.arena = arena_.size();
+        c.contadorVersion = contadorVersion_;
+        c.nodos = 0;
+        recorrerNodos(raiz_, [&](const Nodo*) { c.nodos++; });
+        out.write((const char*)&c, sizeof c);
+        if (raiz_ != nullptr) escribirNodo(out, raiz_);
+        escribirArena(out);
+        if (!out) throw std::runtime_error("guardar: error de escritura en " + ruta);
+    }
+    void escribirNodo(std::ostream& out, const Nodo* n) const {
+        RegistroNodo r{};
+        r.esHoja = n->esHoja;
+        r.nivel = n->nivel;
+        r.n = n->esHoja ? n->entradas.n : n->hijos.n;
+        for (int d = 0; d < 2; d++) { r.lo[d] = n->mbr.lo[d]; r.hi[d] = n->mbr.hi[d]; }
+        r.version = n->version;
+        r.cuenta = n->cuenta;
+        out.write((const char*)&r, sizeof r);
+        if (n->esHoja) {
+            const Columnas& e = n->entradas;
+            out.write((const char*)e.x, e.n * sizeof(double));
+            out.write((const char*)e.y, e.n * sizeof(double));
+            out.write((const char*)e.idx, e.n * sizeof(uint32_t));
+        } else {
+            for (const Nodo* h : n->hijos) escribirNodo(out, h);
+        }
+    }
+    template <typename F>
+    static void recorrerNodos(const Nodo* n, F&& f) {
+        if (n == nullptr) return;
+        f(n);
+        if (!n->esHoja) for (const Nodo* h : n->hijos) recorrerNodos(h, f);
+    }
+
+    template <typename LeerArena>
+    void cargarCon(const std::string& ruta, uint32_t tamT, LeerArena leerArena) {
+        if (raiz_ != nullptr || !arena_.empty())
+            throw std::logic_error("cargar requiere un arbol vacio");
+        std::ifstream in(ruta, std::ios::binary);
+        if (!in) throw std::runtime_error("cargar: no se pudo abrir " + ruta);
+        CabeceraArchivo c;
+        in.read((char*)&c, sizeof c);
+        if (!in || std::memcmp(c.magia, MAGIA_ARCHIVO, sizeof c.magia) != 0)
+            throw std::runtime_error("cargar: " + ruta + " no es un archivo de RStarTree2D");
+        if (c.formato != FORMATO_ARCHIVO || c.ordenBytes != ORDEN_BYTES)
+            throw std::runtime_error("cargar: formato u orden de bytes no soportado");
+        if (c.M != M_ || c.m != m_)
+            throw std::runtime_error("cargar: el archivo es de M=" + std::to_string(c.M) + ", m=" +
+                                     std::to_string(c.m) + "; construir el arbol con esos valores");
+        if (c.tamT != tamT)
+            throw std::runtime_error("cargar: la arena se guardo con otro tipo o serializador");
+        try {
+            uint64_t leidos = 0;
+            if (c.nodos > 0) raiz_ = leerNodo(in, nullptr, leidos, c.nodos, c.arena);
+            if (leidos != c.nodos || (raiz_ ? raiz_->cuenta : 0) != c.puntos)
+                throw std::runtime_error("cargar: archivo corrupto (nodos)");
+            leerArena(in, (size_t)c.arena);
+            n_puntos_ = c.puntos;
+            contadorVersion_ = std::max(contadorVersion_, c.contadorVersion);
+            if (ubicar_) ubicarSubarbol(raiz_);
+            if (reusar_) buscarHuecos();
+        } catch (...) {
+            // leerNodo ya devolvio las celdas de un subarbol a medio leer; si
+            // fallo despues, el arbol leido entero vuelve a los pools
+            if (raiz_ != nullptr) liberarSubarbol(raiz_);
+            raiz_ = nullptr;
+            n_puntos_ = 0;
+            arena_.clear();
+            ubicaciones_.clear();
+            libres_.clear();
+            throw;
+        }
+    }
+    // Un nodo y su subarbol en preorden. Si algo falla, libera lo que ya
+    // tomo (el nodo y los hijos leidos) antes de propagar la excepcion.
+    Nodo* leerNodo(std::istream& in, Nodo* padre, uint64_t& leidos, uint64_t maxNodos, uint64_t nArena) {
+        RegistroNodo r;
+        in.read((char*)&r, sizeof r);
+        if (!in || r.n > (uint32_t)M_ || ++leidos > maxNodos)
+            throw std::runtime_error("cargar: archivo corrupto o truncado (nodos)");
+        // el resto del arbol supone hojas en 0 y cada hijo un nivel abajo
+        if ((r.esHoja != 0) != (r.nivel == 0) || r.nivel < 0 || (padre != nullptr && r.nivel != padre->nivel - 1))
+            throw std::runtime_error("cargar: archivo corrupto (niveles)");
+        Nodo* n = nuevoNodo(r.esHoja != 0);
+        n->nivel = r.nivel;
+        n->padre = padre;
+        for (int d = 0; d < 2; d++) { n->mbr.lo[d] = r.lo[d]; n->mbr.hi[d] = r.hi[d]; }
+        n->version = r.version;
+        n->cuenta = r.cuenta;
+        try {
             if (n->esHoja) {
-                for (const auto& e : n->entradas) {
-                    double dx = e.x - x, dy = e.y - y, dd = dx * dx + dy * dy;
-                    if ((int)mejores.size() < k) mejores.push({dd, e});
-                    else if (dd < mejores.top().first) { mejores.pop(); mejores.push({dd, e}); }
-                }
+                Columnas& e = n->entradas;
+                in.read((char*)e.x, r.n * sizeof(double));
+                in.read((char*)e.y, r.n * sizeof(double));
+                in.read((char*)e.idx, r.n * sizeof(uint32_t));
+                e.n = r.n;
+                if (!in) throw std::runtime_error("cargar: archivo truncado (hojas)");
+                for (uint32_t i = 0; i < e.n; i++)
+                    if (e.idx[i] >= nArena) throw std::runtime_error("cargar: archivo corrupto (idx fuera de la arena)");
             } else {
-                for (const Nodo* h : n->hijos) nodos.push({h->mbr.dist2A(x, y), h});
+                for (uint32_t i = 0; i < r.n; i++) n->hijos.push_back(leerNodo(in, n, leidos, maxNodos, nArena));
             }
+        } catch (...) {
+            liberarSubarbol(n);
+            throw;
         }
-        res.resize(mejores.size());
-        for (int i = (int)mejores.size() - 1; i >= 0; i--) {
-            res[i] = mejores.top().second;
-            mejores.pop();
+        return n;
+    }
+
+    // Copia-en-escritura: devuelve n si ya es de esta generacion; si no, un
+    // clon colgado en su lugar. El padre se privatiza primero, asi que tras
+    // privado(hoja) todo el camino hasta la raiz es escribible. Sin
+    // instantaneas genActual_ es 0 en todos los nodos y no copia nada.
+    // Los lectores nunca siguen padre: reasignarlo en nodos compartidos es
+    // inocuo.
+    Nodo* privado(Nodo* n) {
+        if (n->gen == genActual_) return n;
+        Nodo* c = nuevoNodo(n->esHoja);
+        c->nivel = n->nivel;
+        c->mbr = n->mbr;
+        c->version = n->version;
+        c->cuenta = n->cuenta;
+        if (n->esHoja) {
+            const Columnas& o = n->entradas;
+            std::copy(o.x, o.x + o.n, c->entradas.x);
+            std::copy(o.y, o.y + o.n, c->entradas.y);
+            std::copy(o.idx, o.idx + o.n, c->entradas.idx);
+            c->entradas.n = o.n;
+            ubicar(c);
+        } else {
+            c->hijos.assign(n->hijos.begin(), n->hijos.end());
+            for (Nodo* h : c->hijos) h->padre = c;
         }
-        return res;
+        Nodo* p = n->padre;
+        if (p == nullptr) {
+            raiz_ = c;
+        } else {
+            p = privado(p);
+            *std::find(p->hijos.begin(), p->hijos.end(), n) = c;
+        }
+        c->padre = p;
+        liberar(n);
+        return c;
     }
 
-    // Inspeccion estructural (tests, estadisticas):
-    // f(esHoja, nivel, profundidad, mbr, nEntradas, nHijos, esRaiz)
-    void inspeccionar(const std::function<void(bool, int, int, const Caja&, size_t, size_t, bool)>& f) const {
-        inspeccionarRec(raiz_, 0, true, f);
+    // Devuelve al pool los retirados cuya epoca ya no tiene lectores
+    // anteriores activos (anunciados con una epoca menor).
+    void reciclarRetirados() {
+        uint64_t minimo = std::numeric_limits<uint64_t>::max();
+        for (const auto& r : lectores_->ranuras) {
+            uint64_t e = r.e.load();
+            if (e != 0) minimo = std::min(minimo, e);
+        }
+        size_t k = 0;
+        while (k < retirados_.size() && retirados_[k].first <= minimo) {
+            Nodo* n = retirados_[k++].second;
+            (n->esHoja ? poolHojas_ : poolInternos_).devolver(n);
+        }
+        retirados_.erase(retirados_.begin(), retirados_.begin() + k);
+        k = 0;
+        while (k < libresRetenidos_.size() && libresRetenidos_[k].first <= minimo)
+            libres_.push_back(libresRetenidos_[k++].second);
+        libresRetenidos_.erase(libresRetenidos_.begin(), libresRetenidos_.begin() + k);
     }
 
-    // Vista de una hoja para caches externos (GruposPorHoja): la clave
-    // identifica la hoja y la version cambia con CADA mutacion de su contenido.
-    struct HojaVista {
-        uintptr_t clave;
-        uint64_t version;
-        const Caja& mbr;
-        const std::vector<Resultado>& entradas;
-    };
-    void visitarHojas(const std::function<void(const HojaVista&)>& f) const {
-        visitarHojasRec(raiz_, nullptr, f);
+    // STR: reordena v in situ y devuelve los grupos [ini, fin) de un nivel.
+    // P = ceil(n/M) grupos llenos en S = ceil(sqrt(P)) franjas de ceil(P/S)
+    // grupos cada una; una franja final con menos de m elementos se une a la
+    // anterior. Con o sin pool el resultado es el mismo: los comparadores
+    // son de orden total (ordenTotal) o el orden es estable. Con pool, el
+    // orden por x es un merge sort paralelo y cada franja se ordena por y en
+    // un hilo.
+    template <typename E, typename MenorX, typename MenorY>
+    std::vector<std::pair<size_t, size_t>> teselarSTR(std::vector<E>& v, MenorX menorX, MenorY menorY,
+                                                      bool ordenTotal, PoolHilos* pool) const {
+        size_t n = v.size(), M = (size_t)M_;
+        size_t P = (n + M - 1) / M;
+        size_t S = (size_t)std::ceil(std::sqrt((double)P));
+        size_t porFranja = ((P + S - 1) / S) * M;
+        ordenarEstable(v, menorX, pool, ordenTotal);
+        std::vector<std::pair<size_t, size_t>> franjas;
+        for (size_t ini = 0; ini < n; ini += porFranja) {
+            size_t fin = std::min(n, ini + porFranja);
+            if (n - fin < (size_t)m_) fin = n;
+            franjas.push_back({ini, fin});
+            if (fin == n) break;
+        }
+        paraCadaEn(pool, franjas.size(), 1, [&](size_t f) {
+            auto a = v.begin() + franjas[f].first, b = v.begin() + franjas[f].second;
+            if (ordenTotal) std::sort(a, b, menorY);
+            else std::stable_sort(a, b, menorY);
+        });
+        std::vector<std::pair<size_t, size_t>> grupos;
+        for (auto [ini, fin] : franjas) cortarEnGrupos(ini, fin, grupos);
+        return grupos;
     }
-    void visitarHojasEnRango(const Caja& bbox, const std::function<void(const HojaVista&)>& f) const {
-        visitarHojasRec(raiz_, &bbox, f);
+
+    // Corta [ini, fin) en grupos consecutivos de M. Solo el ultimo puede
+    // quedar incompleto; si queda bajo m se reparte con el anterior (ambos
+    // quedan con >= M/2 >= m).
+    void cortarEnGrupos(size_t ini, size_t fin, std::vector<std::pair<size_t, size_t>>& grupos) const {
+        size_t primero = grupos.size(), M = (size_t)M_;
+        for (size_t g = ini; g < fin; g += M) grupos.push_back({g, std::min(fin, g + M)});
+        auto& ult = grupos.back();
+        if (grupos.size() - primero >= 2 && ult.second - ult.first < (size_t)m_) {
+            auto& pen = grupos[grupos.size() - 2];
+            size_t medio = pen.first + (ult.second - pen.first) / 2;
+            pen.second = medio;
+            ult.first = medio;
+        }
     }
 
-private:
-    struct Nodo {
-        bool esHoja;
-        int nivel = 0;                   // 0 = hoja
-        Caja mbr;
-        std::vector<Nodo*> hijos;        // solo internos
-        std::vector<Resultado> entradas; // solo hojas
-        Nodo* padre = nullptr;
-        uint64_t version = 0;            // para caches externos (grupos)
-        explicit Nodo(bool hoja) : esHoja(hoja) {}
-        ~Nodo() { for (Nodo* h : hijos) delete h; }
-        Nodo(const Nodo&) = delete;
-        Nodo& operator=(const Nodo&) = delete;
-    };
+    // Hilbert: cuantiza al MBR global en una grilla 2^16 x 2^16, ordena por
+    // clave con radix sort y devuelve los grupos consecutivos de hojas. Con
+    // pool, el MBR, las claves, el radix y la permutacion van por bloques.
+    std::vector<std::pair<size_t, size_t>> ordenarHilbert(std::vector<Resultado>& v,
+                                                          PoolHilos* pool) const {
+        const size_t n = v.size(), B = bloquesDe(n, pool);
+        std::vector<Caja> parcial(B);
+        paraCadaEn(pool, B, 1, [&](size_t b) {
+            for (size_t i = n * b / B; i < n * (b + 1) / B; i++) parcial[b].estirar(v[i].x, v[i].y);
+        });
+        Caja total;
+        for (const Caja& c : parcial) total.estirar(c);
+        double ex = total.hi[0] - total.lo[0], ey = total.hi[1] - total.lo[1];
+        auto celda = [](double t, double lo, double ext) {
+            return ext > 0 ? (uint32_t)((t - lo) / ext * 65535.0) : 0u;
+        };
+        std::vector<uint64_t> claves(n);   // {clave << 32 | posicion}
+        paraCadaEn(pool, B, 1, [&](size_t b) {
+            for (size_t i = n * b / B; i < n * (b + 1) / B; i++)
+                claves[i] = ((uint64_t)claveHilbert(celda(v[i].x, total.lo[0], ex),
+                                                    celda(v[i].y, total.lo[1], ey)) << 32) | i;
+        });
+        ordenarRadix(claves, pool);
+        std::vector<Resultado> ordenadas(n);
+        paraCadaEn(pool, B, 1, [&](size_t b) {
+            for (size_t i = n * b / B; i < n * (b + 1) / B; i++) ordenadas[i] = v[(uint32_t)claves[i]];
+        });
+        v = std::move(ordenadas);
+        std::vector<std::pair<size_t, size_t>> grupos;
+        cortarEnGrupos(0, n, grupos);
+        return grupos;
+    }
 
-    int M_, m_;
-    std::vector<T> arena_;
-    Nodo* raiz_ = nullptr;
-    size_t n_puntos_ = 0;
-    uint64_t contadorVersion_ = 0;
-    std::vector<bool> nivelReinsertado_; // OT1: un reinsert por nivel por operacion
+    // Bloques de trabajo para n elementos: 1 sin pool, si no ~4 por hilo
+    // (de al menos 16k elementos, para que el reparto no domine).
+    static size_t bloquesDe(size_t n, PoolHilos* pool) {
+        if (pool == nullptr || pool->hilos() == 1) return 1;
+        return std::max<size_t>(1, std::min<size_t>(4 * (size_t)pool->hilos(), n >> 14));
+    }
 
-    void tocar(Nodo* hoja) { hoja->version = ++contadorVersion_; }
+    // LSD radix sort por los 32 bits altos: 4 pasadas de 8 bits, estable.
+    // Por bloques: histograma de cada bloque, desplazamientos por (digito,
+    // bloque) y reparto de cada bloque a sus destinos; estable igual.
+    static void ordenarRadix(std::vector<uint64_t>& v, PoolHilos* pool) {
+        const size_t n = v.size(), B = bloquesDe(n, pool);
+        std::vector<uint64_t> tmp(n);
+        std::vector<std::array<size_t, 256>> cuenta(B);
+        for (int desp = 32; desp < 64; desp += 8) {
+            paraCadaEn(pool, B, 1, [&](size_t b) {
+                cuenta[b].fill(0);
+                for (size_t i = n * b / B; i < n * (b + 1) / B; i++) cuenta[b][(v[i] >> desp) & 0xFF]++;
+            });
+            size_t acum = 0;
+            for (int d = 0; d < 256; d++)
+                for (size_t b = 0; b < B; b++) { size_t c = cuenta[b][d]; cuenta[b][d] = acum; acum += c; }
+            paraCadaEn(pool, B, 1, [&](size_t b) {
+                for (size_t i = n * b / B; i < n * (b + 1) / B; i++) tmp[cuenta[b][(v[i] >> desp) & 0xFF]++] = v[i];
+            });
+            v.swap(tmp);
+        }
+    }
 
     // ========================================================================
     // INSERCION R*-TREE (Beckmann et al. 1990, seccion 4)
@@ -202,10 +2088,11 @@ private:
 
     // I1-I4: inserta una entrada de datos en el nivel hoja
     void insertarEntrada(const Resultado& e) {
-        if (raiz_ == nullptr) raiz_ = new Nodo(true);
+        if (raiz_ == nullptr) raiz_ = nuevoNodo(true);
         Caja ce(e.x, e.y, e.x, e.y);
-        Nodo* hoja = chooseSubTree(ce, 0);                  // I1
+        Nodo* hoja = privado(chooseSubTree(ce, 0));         // I1
         hoja->entradas.push_back(e);                        // I2
+        ubicar(hoja, hoja->entradas.n - 1);
         tocar(hoja);
         ajustarHaciaArriba(hoja);                           // I4
         if ((int)hoja->entradas.size() > M_)                // I2/I3
@@ -215,7 +2102,7 @@ private:
     // Reinsercion de una entrada de nodo interno: cuelga el subarbol completo
     // en un nodo del nivel que le corresponde (paper 4.3)
     void insertarSubarbol(Nodo* sub) {
-        Nodo* n = chooseSubTree(sub->mbr, sub->nivel + 1);
+        Nodo* n = privado(chooseSubTree(sub->mbr, sub->nivel + 1));
         sub->padre = n;
         n->hijos.push_back(sub);
         ajustarHaciaArriba(n);
@@ -228,85 +2115,17 @@ private:
     Nodo* chooseSubTree(const Caja& entrada, int nivelDestino) {
         Nodo* n = raiz_;                                    // CS1
         while (n != nullptr && n->nivel > nivelDestino) {   // CS2/CS3
-            Nodo* mejor = (n->nivel == 1)
-                ? hijoConMenorAmpliacionOverlap(n, entrada)
-                : hijoConMenorAmpliacionArea(n, entrada);
-            if (mejor == nullptr) return n;                 // no deberia ocurrir
-            n = mejor;
+            auto mbr = [n](int i) -> const Caja& { return n->hijos[i]->mbr; };
+            int total = (int)n->hijos.size();
+            int mejor = (n->nivel == 1)
+                ? borrador_.eleccion.hijoConMenorAmpliacionOverlap(total, mbr, entrada)
+                : Eleccion::hijoConMenorAmpliacionArea(total, mbr, entrada);
+            if (mejor < 0) return n;                        // no deberia ocurrir
+            n = n->hijos[mejor];
         }
         return n;
     }
 
-    static double ampliacionArea(const Caja& c, const Caja& e) {
-        Caja ampliada = c;
-        ampliada.estirar(e);
-        return ampliada.area() - c.area();
-    }
-
-    Nodo* hijoConMenorAmpliacionArea(Nodo* n, const Caja& entrada) const {
-        Nodo* mejor = nullptr;
-        double mejorCosto = std::numeric_limits<double>::infinity();
-        double mejorArea = std::numeric_limits<double>::infinity();
-        for (Nodo* h : n->hijos) {
-            double costo = ampliacionArea(h->mbr, entrada);
-            double area = h->mbr.area();
-            if (costo < mejorCosto || (costo == mejorCosto && area < mejorArea)) {
-                mejorCosto = costo;
-                mejorArea = area;
-                mejor = h;
-            }
-        }
-        return mejor;
-    }
-
-    // Overlap del paper: overlap(E_k) = sum_{i!=k} area(E_k ∩ E_i).
-    // Optimizacion del paper (4.1): evaluar solo los 32 hijos con menor
-    // ampliacion de area — el costo exacto es cuadratico en M.
-    Nodo* hijoConMenorAmpliacionOverlap(Nodo* n, const Caja& entrada) const {
-        const int CANDIDATOS = 32;
-        int total = (int)n->hijos.size();
-
-        std::vector<int> orden(total);
-        for (int i = 0; i < total; i++) orden[i] = i;
-        std::sort(orden.begin(), orden.end(), [&](int a, int b) {
-            return ampliacionArea(n->hijos[a]->mbr, entrada) <
-                   ampliacionArea(n->hijos[b]->mbr, entrada);
-        });
-
-        int evaluar = std::min(total, CANDIDATOS);
-        Nodo* mejor = nullptr;
-        double mejorOverlap = std::numeric_limits<double>::infinity();
-        double mejorCostoArea = std::numeric_limits<double>::infinity();
-        double mejorArea = std::numeric_limits<double>::infinity();
-
-        for (int c = 0; c < evaluar; c++) {
-            Nodo* hijoK = n->hijos[orden[c]];
-            Caja ampliado = hijoK->mbr;
-            ampliado.estirar(entrada);
-
-            double antes = 0.0, despues = 0.0;
-            for (int i = 0; i < total; i++) {
-                if (n->hijos[i] == hijoK) continue;
-                antes   += hijoK->mbr.overlap(n->hijos[i]->mbr);
-                despues += ampliado.overlap(n->hijos[i]->mbr);
-            }
-            double costoOverlap = despues - antes;
-            double costoArea = ampliacionArea(hijoK->mbr, entrada);
-            double area = hijoK->mbr.area();
-
-            if (costoOverlap < mejorOverlap ||
-                (costoOverlap == mejorOverlap &&
-                 (costoArea < mejorCostoArea ||
-                  (costoArea == mejorCostoArea && area < mejorArea)))) {
-                mejorOverlap = costoOverlap;
-                mejorCostoArea = costoArea;
-                mejorArea = area;
-                mejor = hijoK;
-            }
-        }
-        return mejor;
-    }
-
     // I4: los MBR de todo el camino hasta la raiz deben cubrir la entrada
     void ajustarHaciaArriba(Nodo* n) {
         while (n != nullptr) {
@@ -315,20 +2134,34 @@ private:
         }
     }
 
+    // Recalcula el MBR y la cuenta del subarbol a partir del contenido del
+    // nodo y renueva su version. Todo camino que muta (insertar, split,
+    // reinsertar, condensar, carga masiva) pasa por aca, asi cuentas y
+    // versiones de subarbol quedan siempre al dia.
     void actualizarMBR(Nodo* n) {
+        tocar(n);
+        recalcularMBR(n);
+    }
+    static void recalcularMBR(Nodo* n) {   // sin tocar: apto para hilos (carga masiva)
         n->mbr.reset();
         if (n->esHoja) {
-            for (const auto& e : n->entradas) n->mbr.estirar(e.x, e.y);
+            const Columnas& c = n->entradas;
+            for (uint32_t i = 0; i < c.n; i++) n->mbr.estirar(c.x[i], c.y[i]);
+            n->cuenta = c.n;
         } else {
-            for (const Nodo* h : n->hijos) n->mbr.estirar(h->mbr);
+            n->cuenta = 0;
+            for (const Nodo* h : n->hijos) {
+                n->mbr.estirar(h->mbr);
+                n->cuenta += h->cuenta;
+            }
         }
     }
 
     // OT1: primera vez en el nivel (y no raiz) => reinsertar; si no => split
     void overflowTreatment(Nodo* n) {
-        int nivel = n->nivel < (int)nivelReinsertado_.size() ? n->nivel : 0;
-        if (n != raiz_ && !nivelReinsertado_[nivel]) {
-            nivelReinsertado_[nivel] = true;
+        uint64_t bit = 1ull << (n->nivel < 64 ? n->nivel : 0);
+        if (n != raiz_ && !(reinsertados_ & bit)) {
+            reinsertados_ |= bit;
             reinsertar(n);
         } else {
             split(n);
@@ -339,169 +2172,88 @@ private:
     // quitar las p=30% de M entradas mas lejanas al centro del MBR y
     // reinsertarlas empezando por la de distancia MINIMA.
     void reinsertar(Nodo* n) {
-        double cx = (n->mbr.lo[0] + n->mbr.hi[0]) / 2.0;
-        double cy = (n->mbr.lo[1] + n->mbr.hi[1]) / 2.0;
-
         int total = n->esHoja ? (int)n->entradas.size() : (int)n->hijos.size();
-        int p = (int)(M_ * 0.3);                    // p = 30% de M (paper 4.3)
-        if (p < 1) p = 1;
-        if (p > total - 1) p = total - 1;
-        if (p < 1) return;
-
-        std::vector<std::pair<double, int>> dist(total);   // {distancia^2, indice}
-        for (int i = 0; i < total; i++) {
-            double x, y;
-            if (n->esHoja) { x = n->entradas[i].x; y = n->entradas[i].y; }
-            else {
-                x = (n->hijos[i]->mbr.lo[0] + n->hijos[i]->mbr.hi[0]) / 2.0;
-                y = (n->hijos[i]->mbr.lo[1] + n->hijos[i]->mbr.hi[1]) / 2.0;
-            }
-            double dx = x - cx, dy = y - cy;
-            dist[i] = {dx * dx + dy * dy, i};
-        }
-        // RI2: orden decreciente de distancia
-        std::sort(dist.begin(), dist.end(),
-                  [](const auto& a, const auto& b) { return a.first > b.first; });
-
-        // RI3: quitar las p mas lejanas
-        std::vector<bool> quitar(total, false);
-        for (int c = 0; c < p; c++) quitar[dist[c].second] = true;
+        Eleccion& el = borrador_.eleccion;
+        int p = el.elegirReinsert(n->mbr, total, M_, [n](int i, double* c) {
+            if (n->esHoja) { c[0] = n->entradas.x[i]; c[1] = n->entradas.y[i]; return; }
+            const Caja& h = n->hijos[i]->mbr;
+            c[0] = (h.lo[0] + h.hi[0]) / 2.0;
+            c[1] = (h.lo[1] + h.hi[1]) / 2.0;
+        });
+        if (p == 0) return;
 
-        std::vector<Resultado> entradasQuitadas;
-        std::vector<Nodo*> subarbolesQuitados;
+        size_t nivel = (size_t)n->nivel;
+        if (borrador_.quitados.size() <= nivel) borrador_.quitados.resize(nivel + 1);
+        Quitados& q = borrador_.quitados[nivel];
+        q.entradas.resize(0);
+        q.subarboles.resize(0);
         // guardadas en orden de distancia CRECIENTE (close reinsert)
         for (int c = p - 1; c >= 0; c--) {
-            int i = dist[c].second;
-            if (n->esHoja) entradasQuitadas.push_back(n->entradas[i]);
-            else           subarbolesQuitados.push_back(n->hijos[i]);
+            int i = el.lejana(c);
+            if (n->esHoja) q.entradas.push_back(n->entradas[i]);
+            else           q.subarboles.push_back(n->hijos[i]);
         }
 
+        // compactar en el lugar: las que quedan conservan su orden
+        uint32_t j = 0;
         if (n->esHoja) {
-            std::vector<Resultado> resto;
-            resto.reserve(total - p);
-            for (int i = 0; i < total; i++) if (!quitar[i]) resto.push_back(n->entradas[i]);
-            n->entradas = std::move(resto);
+            for (int i = 0; i < total; i++) if (!el.sale(i)) n->entradas.poner(j++, n->entradas[i]);
+            n->entradas.n = j;
+            ubicar(n);
             tocar(n);
         } else {
-            std::vector<Nodo*> resto;
-            resto.reserve(total - p);
-            for (int i = 0; i < total; i++) if (!quitar[i]) resto.push_back(n->hijos[i]);
-            n->hijos = std::move(resto);
+            for (int i = 0; i < total; i++) if (!el.sale(i)) n->hijos[j++] = n->hijos[i];
+            n->hijos.n = j;
         }
         ajustarHaciaArriba(n);
 
-        // RI4: reinsertar empezando por la distancia minima
-        for (const auto& e : entradasQuitadas) insertarEntrada(e);
-        for (Nodo* s : subarbolesQuitados) insertarSubarbol(s);
-    }
-
-    // Resultado de la seleccion de split (4.2): permutacion y tamano de grupo1
-    struct SeleccionSplit {
-        int eje;
-        std::vector<int> orden;
-        int tamGrupo1;
-    };
-
-    // S1 ChooseSplitAxis (suma S de margenes de todas las distribuciones,
-    // ambos ordenes lower/upper) + S2 ChooseSplitIndex (minimo overlap,
-    // empate por area). MBRs prefijo/sufijo => O(E) por orden.
-    SeleccionSplit elegirSplit(const std::vector<Caja>& ent) const {
-        int E = (int)ent.size();
-        int m = m_;
-        if (m > E / 2) m = E / 2;   // salvaguarda: >= 1 distribucion
-        if (m < 1) m = 1;
-        int numDistribuciones = E - 2 * m + 1;
-
-        std::vector<int> ordenes[2][2];  // [eje][clave: 0=inferior, 1=superior]
-        double S[2] = {0.0, 0.0};
-
-        auto prefSuf = [&](const std::vector<int>& orden, std::vector<Caja>& pref, std::vector<Caja>& suf) {
-            pref.resize(E); suf.resize(E);
-            pref[0] = ent[orden[0]];
-            for (int i = 1; i < E; i++) { pref[i] = pref[i - 1]; pref[i].estirar(ent[orden[i]]); }
-            suf[E - 1] = ent[orden[E - 1]];
-            for (int i = E - 2; i >= 0; i--) { suf[i] = suf[i + 1]; suf[i].estirar(ent[orden[i]]); }
-        };
-
-        for (int eje = 0; eje < 2; eje++) {
-            for (int clave = 0; clave < 2; clave++) {
-                std::vector<int>& orden = ordenes[eje][clave];
-                orden.resize(E);
-                for (int i = 0; i < E; i++) orden[i] = i;
-                std::sort(orden.begin(), orden.end(), [&](int a, int b) {
-                    double ka = (clave == 0) ? ent[a].lo[eje] : ent[a].hi[eje];
-                    double kb = (clave == 0) ? ent[b].lo[eje] : ent[b].hi[eje];
-                    return ka < kb;
-                });
-                std::vector<Caja> pref, suf;
-                prefSuf(orden, pref, suf);
-                for (int k = 0; k < numDistribuciones; k++) {
-                    int g1 = m + k;
-                    S[eje] += pref[g1 - 1].margen() + suf[g1].margen();
-                }
-            }
-        }
-
-        SeleccionSplit sel;
-        sel.eje = (S[0] <= S[1]) ? 0 : 1;   // CSA2
-        sel.tamGrupo1 = m;
-
-        double mejorOverlap = std::numeric_limits<double>::infinity();
-        double mejorArea = std::numeric_limits<double>::infinity();
-        for (int clave = 0; clave < 2; clave++) {
-            const std::vector<int>& orden = ordenes[sel.eje][clave];
-            std::vector<Caja> pref, suf;
-            prefSuf(orden, pref, suf);
-            for (int k = 0; k < numDistribuciones; k++) {
-                int g1 = m + k;
-                double ov = pref[g1 - 1].overlap(suf[g1]);
-                double ar = pref[g1 - 1].area() + suf[g1].area();
-                if (ov < mejorOverlap || (ov == mejorOverlap && ar < mejorArea)) {
-                    mejorOverlap = ov;
-                    mejorArea = ar;
-                    sel.orden = orden;
-                    sel.tamGrupo1 = g1;
-                }
-            }
+        // RI4: reinsertar empezando por la distancia minima. Por indice y con
+        // copia: un split anidado de la raiz puede agrandar quitados.
+        for (size_t i = 0; i < borrador_.quitados[nivel].entradas.size(); i++) {
+            Resultado e = borrador_.quitados[nivel].entradas[i];
+            insertarEntrada(e);
         }
-        return sel;
+        for (size_t i = 0; i < borrador_.quitados[nivel].subarboles.size(); i++)
+            insertarSubarbol(borrador_.quitados[nivel].subarboles[i]);
     }
 
     // 4.2 Split (S1-S3) + I3 (propagacion). Generico: hojas e internos.
     void split(Nodo* n) {
-        std::vector<Caja> entradas;
+        Eleccion& el = borrador_.eleccion;
+        auto& entradas = el.cajas();
+        entradas.resize(0);
         if (n->esHoja) {
-            entradas.reserve(n->entradas.size());
-            for (const auto& e : n->entradas) entradas.push_back(Caja(e.x, e.y, e.x, e.y));
+            const Columnas& c = n->entradas;
+            for (uint32_t i = 0; i < c.n; i++) entradas.push_back(Caja(c.x[i], c.y[i], c.x[i], c.y[i]));
         } else {
-            entradas.reserve(n->hijos.size());
             for (const Nodo* h : n->hijos) entradas.push_back(h->mbr);
         }
         if (entradas.size() < 2) return;
 
-        SeleccionSplit sel = elegirSplit(entradas);
+        auto sel = el.elegirSplit(m_);
+        const auto& orden = el.orden(sel);
 
-        Nodo* nuevo = new Nodo(n->esHoja);
+        Nodo* nuevo = nuevoNodo(n->esHoja);
         nuevo->nivel = n->nivel;
 
         if (n->esHoja) {
-            std::vector<Resultado> g1, g2;
-            g1.reserve(sel.tamGrupo1);
-            g2.reserve(entradas.size() - sel.tamGrupo1);
-            for (int i = 0; i < (int)sel.orden.size(); i++)
-                (i < sel.tamGrupo1 ? g1 : g2).push_back(n->entradas[sel.orden[i]]);
-            n->entradas = std::move(g1);
-            nuevo->entradas = std::move(g2);
+            auto& copia = borrador_.copiaEntradas;
+            copia.resize(0);
+            for (const Resultado& e : n->entradas) copia.push_back(e);
+            n->entradas.clear();
+            for (int i = 0; i < (int)orden.size(); i++)
+                (i < sel.tamGrupo1 ? n : nuevo)->entradas.push_back(copia[orden[i]]);
+            ubicar(n);
+            ubicar(nuevo);
             tocar(n);
             tocar(nuevo);
         } else {
-            std::vector<Nodo*> g1, g2;
-            g1.reserve(sel.tamGrupo1);
-            g2.reserve(entradas.size() - sel.tamGrupo1);
-            for (int i = 0; i < (int)sel.orden.size(); i++)
-                (i < sel.tamGrupo1 ? g1 : g2).push_back(n->hijos[sel.orden[i]]);
-            n->hijos = std::move(g1);
-            nuevo->hijos = std::move(g2);
+            auto& copia = borrador_.copiaHijos;
+            copia.resize(0);
+            for (Nodo* h : n->hijos) copia.push_back(h);
+            n->hijos.clear();
+            for (int i = 0; i < (int)orden.size(); i++)
+                (i < sel.tamGrupo1 ? n : nuevo)->hijos.push_back(copia[orden[i]]);
             for (Nodo* h : nuevo->hijos) h->padre = nuevo;
         }
 
@@ -510,7 +2262,7 @@ private:
 
         // I3: propagar el split hacia arriba
         if (n == raiz_) {
-            Nodo* nuevaRaiz = new Nodo(false);
+            Nodo* nuevaRaiz = nuevoNodo(false);
             nuevaRaiz->nivel = n->nivel + 1;
             nuevaRaiz->hijos.push_back(n);
             nuevaRaiz->hijos.push_back(nuevo);
@@ -533,9 +2285,9 @@ private:
                        Nodo*& hoja, int& pos) {
         if (n == nullptr || hoja != nullptr || !n->mbr.contiene(x, y)) return;
         if (n->esHoja) {
-            for (size_t i = 0; i < n->entradas.size(); i++) {
-                const auto& e = n->entradas[i];
-                if (e.x == x && e.y == y && coincide(arena_[e.idx])) {
+            const Columnas& c = n->entradas;
+            for (uint32_t i = 0; i < c.n; i++) {
+                if (c.x[i] == x && c.y[i] == y && coincide(arena_[c.idx[i]])) {
                     hoja = n;
                     pos = (int)i;
                     return;
@@ -549,8 +2301,10 @@ private:
     // Condensacion (delete del paper): subiendo desde la hoja, los nodos que
     // quedan bajo m se quitan del padre y su contenido se reinserta al final.
     void condensar(Nodo* n) {
-        std::vector<Resultado> huerfanas;
-        std::vector<Nodo*> huerfanos;
+        auto& huerfanas = borrador_.huerfanas;
+        auto& huerfanos = borrador_.huerfanos;
+        huerfanas.clear();
+        huerfanos.clear();
         Nodo* actual = n;
         while (actual != raiz_) {
             Nodo* padre = actual->padre;
@@ -564,7 +2318,7 @@ private:
                     huerfanos.insert(huerfanos.end(), actual->hijos.begin(), actual->hijos.end());
                     actual->hijos.clear();
                 }
-                delete actual;
+                liberar(actual);
             } else {
                 actualizarMBR(actual);
             }
@@ -575,14 +2329,275 @@ private:
         for (Nodo* s : huerfanos) insertarSubarbol(s);
     }
 
-    void rangoRec(const Nodo* n, const Caja& bbox, std::vector<Resultado>& res) const {
-        if (n == nullptr || !n->mbr.interseca(bbox)) return;
+    // Eliminacion masiva: marcar (solo lectura), quitar, condensar por
+    // niveles y reinsertar lo huerfano. 'enteras': quitar no mira el dato,
+    // asi que un subarbol cubierto por bbox se suelta entero.
+    template <typename Quita>
+    size_t eliminarDonde(const Caja* bbox, bool enteras, Quita quita) {
+        if (raiz_ == nullptr) return 0;
+        if (enteras && bbox->cubre(raiz_->mbr)) {
+            size_t total = n_puntos_;
+            if (ubicar_ || reusar_) soltarSubarbol(raiz_);
+            liberarSubarbol(raiz_);
+            raiz_ = nullptr;
+            n_puntos_ = 0;
+            return total;
+        }
+        std::vector<Nodo*> hojas, sueltos;
+        marcarParaQuitar(raiz_, bbox, enteras, quita, hojas, sueltos);
+        return quitarMarcadas(bbox, quita, hojas, sueltos);
+    }
+    // 'hojas' sin repetir; 'sueltos' son subarboles a quitar enteros
+    template <typename Quita>
+    size_t quitarMarcadas(const Caja* bbox, Quita& quita, const std::vector<Nodo*>& hojas,
+                          const std::vector<Nodo*>& sueltos) {
+        if (hojas.empty() && sueltos.empty()) return 0;
+
+        // quitar: cada nodo tocado (y su camino) se privatiza al tocarlo; las
+        // copias de un padre reapuntan el padre de todos sus hijos, asi los
+        // punteros marcados siguen validos
+        std::vector<std::vector<Nodo*>> porNivel(raiz_->nivel + 1);
+        size_t quitadas = 0;
+        for (Nodo* s : sueltos) {
+            Nodo* p = privado(s->padre);
+            p->hijos.erase(std::find(p->hijos.begin(), p->hijos.end(), s));
+            quitadas += s->cuenta;
+            if (ubicar_ || reusar_) soltarSubarbol(s);
+            liberarSubarbol(s);
+            porNivel[p->nivel].push_back(p);
+        }
+        for (Nodo* h : hojas) {
+            h = privado(h);
+            Columnas& c = h->entradas;
+            uint32_t j = 0;
+            for (uint32_t i = 0; i < c.n; i++) {
+                Resultado e = c[i];
+                if ((bbox == nullptr || bbox->contiene(e.x, e.y)) && quita(e)) { soltarIdx(e.idx); continue; }
+                c.poner(j++, e);
+            }
+            quitadas += c.n - j;
+            c.n = j;
+            ubicar(h);
+            tocar(h);
+            porNivel[0].push_back(h);
+        }
+        n_puntos_ -= quitadas;
+
+        // condensar una vez: por nivel, de las hojas a la raiz
+        auto& huerfanas = borrador_.huerfanas;
+        auto& huerfanos = borrador_.huerfanos;
+        huerfanas.clear();
+        huerfanos.clear();
+        std::unordered_set<Nodo*> vistos;
+        for (size_t nivel = 0; nivel < porNivel.size(); nivel++) {
+            vistos.clear();
+            for (Nodo* n : porNivel[nivel]) {
+                if (!vistos.insert(n).second) continue;
+                if (n == raiz_) { actualizarMBR(n); continue; }
+                Nodo* padre = n->padre;
+                size_t cuenta = n->esHoja ? n->entradas.size() : n->hijos.size();
+                if (cuenta < (size_t)m_) {
+                    padre->hijos.erase(std::find(padre->hijos.begin(), padre->hijos.end(), n));
+                    if (n->esHoja) huerfanas.insert(huerfanas.end(), n->entradas.begin(), n->entradas.end());
+                    else huerfanos.insert(huerfanos.end(), n->hijos.begin(), n->hijos.end());
+                    liberar(n);
+                } else {
+                    actualizarMBR(n);
+                }
+                porNivel[nivel + 1].push_back(padre);
+            }
+        }
+        if (!raiz_->esHoja && raiz_->hijos.empty()) {
+            liberar(raiz_);
+            raiz_ = nullptr;
+        }
+
+        // reinsertar. Si lo huerfano es al menos lo que queda en el arbol (o
+        // el arbol quedo en una hoja), se reempaqueta todo de abajo hacia
+        // arriba. Si no: primero los subarboles, en su nivel (mantienen la
+        // altura); despues las entradas, empaquetadas en hojas si son M o mas
+        size_t sueltas = huerfanas.size();
+        for (Nodo* s : huerfanos) sueltas += s->cuenta;
+        if (raiz_ == nullptr || raiz_->esHoja || sueltas >= raiz_->cuenta) {
+            if (sueltas == 0) return quitadas;
+            for (Nodo* s : huerfanos) aplanar(s, huerfanas);
+            if (raiz_ != nullptr) aplanar(raiz_, huerfanas);
+            raiz_ = empaquetar(huerfanas, Empaquetado::STR, nullptr);
+            return quitadas;
+        }
+        reinsertados_ = 0;
+        for (Nodo* s : huerfanos) {
+            if (raiz_->nivel > s->nivel) insertarSubarbol(s);
+            else aplanar(s, huerfanas);
+        }
+        if (huerfanas.size() >= (size_t)M_) {
+            auto grupos = teselarSTR(huerfanas,
+                                     [](const Resultado& a, const Resultado& b) {
+                                         return std::tie(a.x, a.y, a.idx) < std::tie(b.x, b.y, b.idx); },
+                                     [](const Resultado& a, const Resultado& b) {
+                                         return std::tie(a.y, a.x, a.idx) < std::tie(b.y, b.x, b.idx); },
+                                     true, nullptr);
+            for (auto [ini, fin] : grupos) {
+                Nodo* h = nuevoNodo(true);
+                h->entradas.assign(huerfanas.begin() + ini, huerfanas.begin() + fin);
+                ubicar(h);
+                actualizarMBR(h);
+                insertarSubarbol(h);
+            }
+        } else {
+            for (const auto& e : huerfanas) insertarEntrada(e);
+        }
+        acortarRaiz();
+        return quitadas;
+    }
+
+    // Hojas con alguna entrada a quitar y subarboles a soltar enteros, en
+    // orden de recorrido. Sin modificar nada.
+    template <typename Quita>
+    static void marcarParaQuitar(Nodo* n, const Caja* bbox, bool enteras, Quita& quita,
+                                 std::vector<Nodo*>& hojas, std::vector<Nodo*>& sueltos) {
+        if (bbox != nullptr && !bbox->interseca(n->mbr)) return;
+        if (enteras && n->padre != nullptr && bbox->cubre(n->mbr)) { sueltos.push_back(n); return; }
+        if (n->esHoja) {
+            const Columnas& c = n->entradas;
+            for (uint32_t i = 0; i < c.n; i++) {
+                if ((bbox == nullptr || bbox->contiene(c.x[i], c.y[i])) && quita(c[i])) {
+                    hojas.push_back(n);
+                    return;
+                }
+            }
+        } else {
+            for (Nodo* h : n->hijos) marcarParaQuitar(h, bbox, enteras, quita, hojas, sueltos);
+        }
+    }
+
+    void liberarSubarbol(Nodo* n) {
+        if (!n->esHoja) for (Nodo* h : n->hijos) liberarSubarbol(h);
+        liberar(n);
+    }
+    // Pasa las entradas del subarbol a 'entradas' y libera sus nodos
+    void aplanar(Nodo* n, std::vector<Resultado>& entradas) {
+        if (n->esHoja) entradas.insert(entradas.end(), n->entradas.begin(), n->entradas.end());
+        else for (Nodo* h : n->hijos) aplanar(h, entradas);
+        liberar(n);
+    }
+
+    // Orden van Emde Boas de los 'altura' niveles de arriba del subarbol de
+    // n: la mitad superior de niveles, recursivamente, y despues cada
+    // subarbol de la mitad inferior, recursivamente y uno tras otro.
+    static void ordenVEB(const Nodo* n, int altura, std::vector<const Nodo*>& orden) {
+        if (altura == 1 || n->esHoja) {
+            orden.push_back(n);
+            return;
+        }
+        int arriba = altura / 2;
+        ordenVEB(n, arriba, orden);
+        std::vector<const Nodo*> frontera{n}, siguiente;
+        for (int d = 0; d < arriba; d++) {
+            siguiente.clear();
+            for (const Nodo* f : frontera)
+                for (const Nodo* h : f->hijos) siguiente.push_back(h);
+            frontera.swap(siguiente);
+        }
+        for (const Nodo* f : frontera) ordenVEB(f, altura - arriba, orden);
+    }
+
+    static void rangoDesde(const Nodo* raiz, const Caja& bbox, std::vector<Resultado>& salida) {
+        PilaRango pila;
+        pila.iniciar(raiz, bbox);
+        while (const Nodo* h = pila.proximaHoja()) filtrarHoja(h, bbox, salida);
+    }
+    size_t kVecinosDesde(const Nodo* raiz, double x, double y, int k,
+                         BufferVecinos& buf, Resultado* salida) const {
+        if (raiz == nullptr || k <= 0) return 0;
+        auto cmpN = [](const std::pair<double, const Nodo*>& a,
+                       const std::pair<double, const Nodo*>& b) { return a.first > b.first; };
+        auto& nodos = buf.nodos;
+        auto& mejores = buf.mejores;
+        nodos.clear();
+        mejores.clear();
+        buf.dHoja.resize(M_ + 1);
+        nodos.push_back({raiz->mbr.dist2A(x, y), raiz});
+
+        while (!nodos.empty()) {
+            std::pop_heap(nodos.begin(), nodos.end(), cmpN);
+            auto [d2, n] = nodos.back();
+            nodos.pop_back();
+            if ((int)mejores.size() == k && d2 > mejores.front().first) break;   // poda
+            if (n->esHoja) {
+                mejoresDeHoja(n->entradas, x, y, k, buf);
+            } else {
+                for (const Nodo* h : n->hijos) {
+                    nodos.push_back({h->mbr.dist2A(x, y), h});
+                    std::push_heap(nodos.begin(), nodos.end(), cmpN);
+                }
+            }
+        }
+        return volcarMejores(buf, salida);
+    }
+    // Candidatos de una hoja contra el max-heap de los mejores k
+    static void mejoresDeHoja(const Columnas& c, double x, double y, int k, BufferVecinos& buf) {
+        auto& mejores = buf.mejores;
+        distancias2(c.x, c.y, c.n, x, y, buf.dHoja.data());
+        for (uint32_t i = 0; i < c.n; i++) {
+            double dd = buf.dHoja[i];
+            if ((int)mejores.size() < k) {
+                mejores.push_back({dd, c[i]});
+                std::push_heap(mejores.begin(), mejores.end(), masCercano);
+            } else if (dd < mejores.front().first) {
+                std::pop_heap(mejores.begin(), mejores.end(), masCercano);
+                mejores.back() = {dd, c[i]};
+                std::push_heap(mejores.begin(), mejores.end(), masCercano);
+            }
+        }
+    }
+    static bool masCercano(const std::pair<double, Resultado>& a, const std::pair<double, Resultado>& b) {
+        return a.first < b.first;
+    }
+    static size_t volcarMejores(BufferVecinos& buf, Resultado* salida) {
+        auto& mejores = buf.mejores;
+        std::sort_heap(mejores.begin(), mejores.end(), masCercano);   // de mas cercano a mas lejano
+        for (size_t i = 0; i < mejores.size(); i++) salida[i] = mejores[i].second;
+        return mejores.size();
+    }
+    // Aciertos de una hoja al final de salida. Si la caja cubre el MBR se
+    // copian todas las entradas sin comparar; si no, filtrarCaja por tramos
+    // con las posiciones en la pila.
+    static void filtrarHoja(const Nodo* h, const Caja& bbox, std::vector<Resultado>& salida) {
+        filtrarColumnas(h->entradas, h->mbr, bbox, salida);
+    }
+    static void filtrarColumnas(const Columnas& c, const Caja& mbr, const Caja& bbox, std::vector<Resultado>& salida) {
+        if (bbox.cubre(mbr)) {
+            for (uint32_t i = 0; i < c.n; i++) salida.push_back(c[i]);
+            return;
+        }
+        constexpr uint32_t TRAMO = 256;
+        uint32_t pos[TRAMO + 4];
+        for (uint32_t ini = 0; ini < c.n; ini += TRAMO) {
+            uint32_t k = filtrarCaja(c.x + ini, c.y + ini, std::min(TRAMO, c.n - ini),
+                                     bbox.lo[0], bbox.lo[1], bbox.hi[0], bbox.hi[1], pos);
+            for (uint32_t j = 0; j < k; j++) salida.push_back(c[ini + pos[j]]);
+        }
+    }
+    static size_t contarColumnas(const Columnas& c, const Caja& bbox) {
+        constexpr uint32_t TRAMO = 256;
+        uint32_t pos[TRAMO + 4];
+        size_t total = 0;
+        for (uint32_t ini = 0; ini < c.n; ini += TRAMO)
+            total += filtrarCaja(c.x + ini, c.y + ini, std::min(TRAMO, c.n - ini),
+                                 bbox.lo[0], bbox.lo[1], bbox.hi[0], bbox.hi[1], pos);
+        return total;
+    }
+    static size_t contarRec(const Nodo* n, const Caja& bbox) {
+        if (!n->mbr.interseca(bbox)) return 0;
+        if (bbox.cubre(n->mbr)) return (size_t)n->cuenta;
+        size_t total = 0;
         if (n->esHoja) {
-            for (const auto& e : n->entradas)
-                if (bbox.contiene(e.x, e.y)) res.push_back(e);
+            total = contarColumnas(n->entradas, bbox);
         } else {
-            for (const Nodo* h : n->hijos) rangoRec(h, bbox, res);
+            for (const Nodo* h : n->hijos) total += contarRec(h, bbox);
         }
+        return total;
     }
     void recorrerRec(const Nodo* n, const std::function<void(const Resultado&)>& v) const {
         if (n == nullptr) return;
@@ -595,6 +2610,24 @@ private:
         f(n->esHoja, n->nivel, prof, n->mbr, n->entradas.size(), n->hijos.size(), esRaiz);
         for (const Nodo* h : n->hijos) inspeccionarRec(h, prof + 1, false, f);
     }
+    void calidadRec(const Nodo* n, Calidad& c, double& sumaOcupacion) const {
+        if (n->esHoja) {
+            c.hojas++;
+            sumaOcupacion += (double)n->entradas.size() / M_;
+            c.espacioMuerto += n->mbr.area();
+            return;
+        }
+        c.internos++;
+        sumaOcupacion += (double)n->hijos.size() / M_;
+        double sumaHijos = 0.0;
+        for (size_t i = 0; i < n->hijos.size(); i++) {
+            sumaHijos += n->hijos[i]->mbr.area();
+            for (size_t j = i + 1; j < n->hijos.size(); j++)
+                c.overlap += n->hijos[i]->mbr.overlap(n->hijos[j]->mbr);
+        }
+        c.espacioMuerto += std::max(0.0, n->mbr.area() - sumaHijos);
+        for (const Nodo* h : n->hijos) calidadRec(h, c, sumaOcupacion);
+    }
     void visitarHojasRec(const Nodo* n, const Caja* filtro,
                          const std::function<void(const HojaVista&)>& f) const {
         if (n == nullptr) return;
@@ -606,3 +2639,14 @@ private:
         }
     }
 };
+
+// Variante con M y m constantes de compilacion. Mismo arbol y misma API que
+// RStarTree2D<T>(M, m), con los limites de capacidad como constantes y los
+// buffers de trabajo de split y reinsert como std::array de M+1 dentro del
+// arbol: pensada para M chicos (decenas), donde cada insercion hace mas splits.
+// Solo fija la capacidad: los lazos siguen recorriendo las entradas que hay
+// (no se desenrollan sobre M) y no es mas rapida que la version con M en
+// ejecucion; sirve para no reservar los buffers y tener M en el tipo.
+//   RStarTree2DFijo<Viaje, 32> arbol;   // m = 2M/5 = 12
+template <typename T, int M, int m = M * 2 / 5>
+using RStarTree2DFijo = RStarTree2D<T, M, m>;
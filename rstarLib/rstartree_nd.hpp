@@ -0,0 +1,486 @@
+#pragma once
+// RStarTree<T, DIM>: el R*-tree de rstartree.hpp en DIM dimensiones, para
+// indices como (lat, lon, tiempo) donde la ventana de tiempo poda el arbol
+// igual que la caja espacial, en vez de traer todo lo de la caja y filtrar
+// despues. Las decisiones R* (ChooseSubtree por overlap en el nivel de
+// hojas, reinsert forzado del 30%, split por margen, overlap y area) son
+// las de RStarTree2D: ambos usan EleccionRStar, aca con DIM ejes. Tambien
+// comparte los pools de celdas [Nodo | M+1 entradas], la arena en tramos
+// (el dato vive una vez y las hojas guardan {punto, idx}) y la memoria de
+// trabajo reusada entre operaciones; lo propio es la condensacion y la
+// carga STR por ejes.
+// Para 2D sigue siendo RStarTree2D: hojas en columnas, nucleos SIMD,
+// instantaneas, archivo y los modulos opcionales.
+//   RStarTree<Viaje, 3> arbol;                                // lat, lon, t
+//   arbol.insertar({lat, lon, t}, viaje);
+//   auto r = arbol.buscarRango(CajaN<3>({lat0, lon0, t0}, {lat1, lon1, t1}));
+#include "rstartree.hpp"
+
+template <typename T, int DIM>
+class RStarTree {
+    struct Nodo;
+
+public:
+    using Punto = std::array<double, DIM>;
+    using CajaD = CajaN<DIM>;
+    struct Resultado { Punto p; uint32_t idx; };
+
+    explicit RStarTree(int M = 1200, int m = 480)
+        : M_(M), m_(m),
+          poolHojas_(Pool::tamCelda(sizeof(Nodo), sizeof(Resultado), M)),
+          poolInternos_(Pool::tamCelda(sizeof(Nodo), sizeof(Nodo*), M)) {
+        if (m < 2 || m > M / 2) throw std::invalid_argument("m debe cumplir 2 <= m <= M/2");
+    }
+    // Nodos trivialmente destructibles: los pools sueltan sus slabs
+    ~RStarTree() = default;
+    RStarTree(const RStarTree&) = delete;
+    RStarTree& operator=(const RStarTree&) = delete;
+
+    uint32_t insertar(const Punto& p, T dato) {
+        arena_.push_back(std::move(dato));
+        uint32_t idx = (uint32_t)(arena_.size() - 1);
+        reinsertados_ = 0;   // OT1: un reinsert por nivel por operacion
+        insertarEntrada({p, idx});
+        n_puntos_++;
+        return idx;
+    }
+
+    // Carga STR de un rango de pares {Punto, T} (arbol vacio): ordena por el
+    // eje 0 y corta S rebanadas, cada rebanada por el eje 1, y asi hasta
+    // cortar hojas llenas en el ultimo eje (S = P^(1/ejes restantes), P =
+    // hojas). Los niveles internos se arman igual sobre los centros de los MBR.
+    template <typename It>
+    void cargarMasivo(It primero, It ultimo) {
+        if (raiz_ != nullptr || !arena_.empty())
+            throw std::logic_error("cargarMasivo requiere un arbol vacio");
+        std::vector<Resultado> entradas;
+        for (It it = primero; it != ultimo; ++it) {
+            auto&& [p, d] = *it;
+            if constexpr (std::is_rvalue_reference_v<decltype(*it)>) arena_.push_back(std::move(d));
+            else arena_.push_back(d);
+            entradas.push_back({p, (uint32_t)(arena_.size() - 1)});
+        }
+        if (entradas.empty()) return;
+        std::vector<std::pair<size_t, size_t>> grupos;
+        teselarSTR(entradas, 0, entradas.size(), 0, [](const Resultado& e, int d) { return e.p[d]; }, grupos);
+        std::vector<Nodo*> nivel;
+        for (auto [ini, fin] : grupos) {
+            Nodo* h = nuevoNodo(true);
+            h->entradas.assign(entradas.begin() + ini, entradas.begin() + fin);
+            recalcularMBR(h);
+            nivel.push_back(h);
+        }
+        while (nivel.size() > 1) {
+            grupos.clear();
+            teselarSTR(nivel, 0, nivel.size(), 0,
+                       [](const Nodo* n, int d) { return n->mbr.lo[d] + n->mbr.hi[d]; }, grupos);
+            std::vector<Nodo*> superior;
+            for (auto [ini, fin] : grupos) {
+                Nodo* p = nuevoNodo(false);
+                p->nivel = nivel[ini]->nivel + 1;
+                p->hijos.assign(nivel.begin() + ini, nivel.begin() + fin);
+                for (Nodo* h : p->hijos) h->padre = p;
+                recalcularMBR(p);
+                superior.push_back(p);
+            }
+            nivel = std::move(superior);
+        }
+        raiz_ = nivel[0];
+        n_puntos_ = entradas.size();
+    }
+
+    const T& dato(uint32_t idx) const { return arena_[idx]; }
+    size_t tamano() const { return n_puntos_; }
+
+    std::vector<Resultado> buscarRango(const CajaD& bbox) const {
+        std::vector<Resultado> res;
+        buscarRango(bbox, res);
+        return res;
+    }
+    // Agrega a salida; recorrido con pila explicita por nivel, como PilaRango
+    void buscarRango(const CajaD& bbox, std::vector<Resultado>& salida) const {
+        if (raiz_ == nullptr || !raiz_->mbr.interseca(bbox)) return;
+        const Nodo* nodo[MAX_ALTURA];
+        uint32_t sig[MAX_ALTURA];
+        int tope = 0;
+        nodo[0] = raiz_; sig[0] = 0;
+        while (tope >= 0) {
+            const Nodo* n = nodo[tope];
+            if (n->esHoja) {
+                bool todo = bbox.cubre(n->mbr);
+                for (const Resultado& e : n->entradas)
+                    if (todo || bbox.contiene(e.p.data())) salida.push_back(e);
+                tope--;
+                continue;
+            }
+            if (sig[tope] == n->hijos.size()) { tope--; continue; }
+            const Nodo* h = n->hijos[sig[tope]++];
+            if (h->mbr.interseca(bbox)) { tope++; nodo[tope] = h; sig[tope] = 0; }
+        }
+    }
+    size_t contarEnRango(const CajaD& bbox) const {
+        return raiz_ == nullptr ? 0 : contarRec(raiz_, bbox);
+    }
+
+    // k mas cercanos (distancia euclidea sobre los DIM ejes), ordenados.
+    // Con ejes de unidades distintas conviene escalarlos al insertar.
+    std::vector<Resultado> kVecinos(const Punto& q, int k) const {
+        std::vector<Resultado> res;
+        if (raiz_ == nullptr || k <= 0) return res;
+        using ItemN = std::pair<double, const Nodo*>;
+        auto cmpN = [](const ItemN& a, const ItemN& b) { return a.first > b.first; };
+        std::priority_queue<ItemN, std::vector<ItemN>, decltype(cmpN)> cola(cmpN);
+        using ItemP = std::pair<double, Resultado>;
+        auto cmpP = [](const ItemP& a, const ItemP& b) { return a.first < b.first; };
+        std::priority_queue<ItemP, std::vector<ItemP>, decltype(cmpP)> mejores(cmpP);
+        cola.push({raiz_->mbr.dist2A(q.data()), raiz_});
+        while (!cola.empty()) {
+            auto [d2, n] = cola.top();
+            cola.pop();
+            if ((int)mejores.size() == k && d2 > mejores.top().first) break;   // poda
+            if (n->esHoja) {
+                for (const Resultado& e : n->entradas) {
+                    double dd = dist2(e.p, q);
+                    if ((int)mejores.size() < k) mejores.push({dd, e});
+                    else if (dd < mejores.top().first) { mejores.pop(); mejores.push({dd, e}); }
+                }
+            } else {
+                for (const Nodo* h : n->hijos) cola.push({h->mbr.dist2A(q.data()), h});
+            }
+        }
+        res.resize(mejores.size());
+        for (int i = (int)mejores.size() - 1; i >= 0; i--) { res[i] = mejores.top().second; mejores.pop(); }
+        return res;
+    }
+
+    void recorrer(const std::function<void(const Resultado&)>& visita) const { recorrerRec(raiz_, visita); }
+
+    // Quita del indice la primera entrada en p cuyo dato cumple coincide
+    // (tombstone: el dato sigue en la arena, como en RStarTree2D)
+    bool eliminar(const Punto& p, const std::function<bool(const T&)>& coincide) {
+        if (raiz_ == nullptr) return false;
+        Nodo* hoja = nullptr;
+        int pos = -1;
+        buscarEntrada(raiz_, p, coincide, hoja, pos);
+        if (hoja == nullptr) return false;
+        hoja->entradas.erase(hoja->entradas.begin() + pos);
+        n_puntos_--;
+        reinsertados_ = 0;
+        condensar(hoja);
+        // raiz interna con un solo hijo: acortar el arbol
+        while (raiz_ != nullptr && !raiz_->esHoja && raiz_->hijos.size() == 1) {
+            Nodo* h = raiz_->hijos[0];
+            raiz_->hijos.clear();
+            liberar(raiz_);
+            raiz_ = h;
+            h->padre = nullptr;
+        }
+        return true;
+    }
+
+    // Inspeccion estructural (tests, estadisticas):
+    // f(esHoja, nivel, profundidad, mbr, nEntradas, nHijos, esRaiz)
+    void inspeccionar(const std::function<void(bool, int, int, const CajaD&, size_t, size_t, bool)>& f) const {
+        inspeccionarRec(raiz_, 0, true, f);
+    }
+
+private:
+    static constexpr int MAX_ALTURA = 64;
+
+    // Vive al frente de su celda del pool; hijos o entradas apuntan al resto
+    struct Nodo {
+        bool esHoja;
+        int nivel = 0;                       // 0 = hoja
+        CajaD mbr;
+        BloqueCelda<Nodo*> hijos;            // solo internos
+        BloqueCelda<Resultado> entradas;     // solo hojas
+        Nodo* padre = nullptr;
+        uint64_t cuenta = 0;                 // puntos del subarbol (contarEnRango)
+        explicit Nodo(bool hoja) : esHoja(hoja) {}
+    };
+    using Pool = PoolCeldas;
+    using Eleccion = EleccionRStar<DIM>;
+    // Como en RStarTree2D: lo que reinsertar saca se recorre mientras
+    // corren operaciones anidadas en otros niveles, asi que va por nivel
+    struct Quitados {
+        std::vector<Resultado> entradas;
+        std::vector<Nodo*> subarboles;
+    };
+    struct Borrador {
+        Eleccion eleccion;                   // chooseSubtree, reinsertar y split
+        std::vector<Quitados> quitados;      // por nivel
+        std::vector<Resultado> copiaEntradas;
+        std::vector<Nodo*> copiaHijos;
+        std::vector<Resultado> huerfanas;    // condensar
+        std::vector<Nodo*> huerfanos;
+    };
+
+    int M_, m_;
+    Pool poolHojas_, poolInternos_;
+    ArenaTramos<T> arena_;               // referencias estables al crecer
+    Nodo* raiz_ = nullptr;
+    size_t n_puntos_ = 0;
+    uint64_t reinsertados_ = 0;          // OT1: bit por nivel ya reinsertado en esta operacion
+    Borrador borrador_;
+
+    Nodo* nuevoNodo(bool hoja) {
+        void* celda = (hoja ? poolHojas_ : poolInternos_).tomar();
+        Nodo* n = new (celda) Nodo(hoja);
+        unsigned char* datos = (unsigned char*)celda + Pool::desplazamientoDatos(sizeof(Nodo));
+        if (hoja) n->entradas.d = (Resultado*)datos;
+        else      n->hijos.d = (Nodo**)datos;
+        return n;
+    }
+    void liberar(Nodo* n) { (n->esHoja ? poolHojas_ : poolInternos_).devolver(n); }
+    static double dist2(const Punto& a, const Punto& b) {
+        double s = 0.0;
+        for (int d = 0; d < DIM; d++) s += (a[d] - b[d]) * (a[d] - b[d]);
+        return s;
+    }
+    static CajaD cajaDe(const Resultado& e) { return CajaD(e.p, e.p); }
+
+    // STR recursivo por ejes sobre [ini, fin); coord(e, eje) da la clave
+    template <typename E, typename Coord>
+    void teselarSTR(std::vector<E>& v, size_t ini, size_t fin, int eje, Coord coord,
+                    std::vector<std::pair<size_t, size_t>>& grupos) const {
+        auto menor = [&](const E& a, const E& b) { return coord(a, eje) < coord(b, eje); };
+        std::stable_sort(v.begin() + ini, v.begin() + fin, menor);
+        if (eje == DIM - 1) {
+            cortarEnGrupos(ini, fin, grupos);
+            return;
+        }
+        size_t n = fin - ini, M = (size_t)M_;
+        size_t P = (n + M - 1) / M;
+        size_t S = (size_t)std::ceil(std::pow((double)P, 1.0 / (DIM - eje)));
+        size_t porRebanada = ((P + S - 1) / S) * M;
+        for (size_t a = ini; a < fin; a += porRebanada) {
+            size_t b = std::min(fin, a + porRebanada);
+            if (fin - b < (size_t)m_) b = fin;
+            teselarSTR(v, a, b, eje + 1, coord, grupos);
+            if (b == fin) break;
+        }
+    }
+    void cortarEnGrupos(size_t ini, size_t fin, std::vector<std::pair<size_t, size_t>>& grupos) const {
+        size_t primero = grupos.size(), M = (size_t)M_;
+        for (size_t g = ini; g < fin; g += M) grupos.push_back({g, std::min(fin, g + M)});
+        auto& ult = grupos.back();
+        if (grupos.size() - primero >= 2 && ult.second - ult.first < (size_t)m_) {
+            auto& pen = grupos[grupos.size() - 2];
+            size_t medio = pen.first + (ult.second - pen.first) / 2;
+            pen.second = medio;
+            ult.first = medio;
+        }
+    }
+
+    void insertarEntrada(const Resultado& e) {
+        if (raiz_ == nullptr) raiz_ = nuevoNodo(true);
+        Nodo* hoja = chooseSubTree(cajaDe(e), 0);          // I1
+        hoja->entradas.push_back(e);                        // I2
+        ajustarHaciaArriba(hoja);                           // I4
+        if ((int)hoja->entradas.size() > M_)                // I2/I3
+            overflowTreatment(hoja);
+    }
+    void insertarSubarbol(Nodo* sub) {
+        Nodo* n = chooseSubTree(sub->mbr, sub->nivel + 1);
+        sub->padre = n;
+        n->hijos.push_back(sub);
+        ajustarHaciaArriba(n);
+        if ((int)n->hijos.size() > M_)
+            overflowTreatment(n);
+    }
+
+    // 4.1 ChooseSubtree: hijos-hoja por ampliacion de overlap, internos por area
+    Nodo* chooseSubTree(const CajaD& entrada, int nivelDestino) {
+        Nodo* n = raiz_;
+        while (n != nullptr && n->nivel > nivelDestino) {
+            int total = (int)n->hijos.size();
+            auto mbr = [n](int i) -> const CajaD& { return n->hijos[i]->mbr; };
+            int mejor = (n->nivel == 1)
+                ? borrador_.eleccion.hijoConMenorAmpliacionOverlap(total, mbr, entrada)
+                : Eleccion::hijoConMenorAmpliacionArea(total, mbr, entrada);
+            if (mejor < 0) return n;
+            n = n->hijos[mejor];
+        }
+        return n;
+    }
+
+    void ajustarHaciaArriba(Nodo* n) {
+        for (; n != nullptr; n = n->padre) recalcularMBR(n);
+    }
+    static void recalcularMBR(Nodo* n) {
+        n->mbr.reset();
+        if (n->esHoja) {
+            for (const Resultado& e : n->entradas) n->mbr.estirar(e.p.data());
+            n->cuenta = n->entradas.size();
+        } else {
+            n->cuenta = 0;
+            for (const Nodo* h : n->hijos) {
+                n->mbr.estirar(h->mbr);
+                n->cuenta += h->cuenta;
+            }
+        }
+    }
+
+    // OT1: primera vez en el nivel (y no raiz) => reinsertar; si no => split
+    void overflowTreatment(Nodo* n) {
+        uint64_t bit = 1ull << (n->nivel < 64 ? n->nivel : 0);
+        if (n != raiz_ && !(reinsertados_ & bit)) {
+            reinsertados_ |= bit;
+            reinsertar(n);
+        } else {
+            split(n);
+        }
+    }
+
+    // 4.3 close reinsert: las p = 30% de M mas lejanas al centro del MBR
+    void reinsertar(Nodo* n) {
+        int total = n->esHoja ? (int)n->entradas.size() : (int)n->hijos.size();
+        Eleccion& el = borrador_.eleccion;
+        int p = el.elegirReinsert(n->mbr, total, M_, [n](int i, double* c) {
+            for (int d = 0; d < DIM; d++)
+                c[d] = n->esHoja ? n->entradas[i].p[d]
+                                 : (n->hijos[i]->mbr.lo[d] + n->hijos[i]->mbr.hi[d]) / 2.0;
+        });
+        if (p == 0) return;
+
+        size_t nivel = (size_t)n->nivel;
+        if (borrador_.quitados.size() <= nivel) borrador_.quitados.resize(nivel + 1);
+        Quitados& q = borrador_.quitados[nivel];
+        q.entradas.clear();
+        q.subarboles.clear();
+        for (int c = p - 1; c >= 0; c--) {   // distancia creciente
+            int i = el.lejana(c);
+            if (n->esHoja) q.entradas.push_back(n->entradas[i]);
+            else           q.subarboles.push_back(n->hijos[i]);
+        }
+        uint32_t j = 0;
+        if (n->esHoja) {
+            for (int i = 0; i < total; i++) if (!el.sale(i)) n->entradas[j++] = n->entradas[i];
+            n->entradas.n = j;
+        } else {
+            for (int i = 0; i < total; i++) if (!el.sale(i)) n->hijos[j++] = n->hijos[i];
+            n->hijos.n = j;
+        }
+        ajustarHaciaArriba(n);
+        // por indice y con copia: un split anidado de la raiz puede agrandar quitados
+        for (size_t i = 0; i < borrador_.quitados[nivel].entradas.size(); i++) {
+            Resultado e = borrador_.quitados[nivel].entradas[i];
+            insertarEntrada(e);
+        }
+        for (size_t i = 0; i < borrador_.quitados[nivel].subarboles.size(); i++)
+            insertarSubarbol(borrador_.quitados[nivel].subarboles[i]);
+    }
+
+    // 4.2 S1 eje de menor suma de margenes (sobre los DIM ejes), S2 corte de
+    // menor overlap y despues menor volumen
+    void split(Nodo* n) {
+        Eleccion& el = borrador_.eleccion;
+        auto& cajas = el.cajas();
+        cajas.resize(0);
+        if (n->esHoja) for (const Resultado& e : n->entradas) cajas.push_back(cajaDe(e));
+        else           for (const Nodo* h : n->hijos) cajas.push_back(h->mbr);
+        if (cajas.size() < 2) return;
+        auto sel = el.elegirSplit(m_);
+        const auto& orden = el.orden(sel);
+
+        Nodo* nuevo = nuevoNodo(n->esHoja);
+        nuevo->nivel = n->nivel;
+        if (n->esHoja) {
+            auto& copia = borrador_.copiaEntradas;
+            copia.assign(n->entradas.begin(), n->entradas.end());
+            n->entradas.clear();
+            for (int i = 0; i < (int)orden.size(); i++)
+                (i < sel.tamGrupo1 ? n : nuevo)->entradas.push_back(copia[orden[i]]);
+        } else {
+            auto& copia = borrador_.copiaHijos;
+            copia.assign(n->hijos.begin(), n->hijos.end());
+            n->hijos.clear();
+            for (int i = 0; i < (int)orden.size(); i++)
+                (i < sel.tamGrupo1 ? n : nuevo)->hijos.push_back(copia[orden[i]]);
+            for (Nodo* h : nuevo->hijos) h->padre = nuevo;
+        }
+        recalcularMBR(n);
+        recalcularMBR(nuevo);
+
+        if (n == raiz_) {   // I3: crece el arbol
+            Nodo* nuevaRaiz = nuevoNodo(false);
+            nuevaRaiz->nivel = n->nivel + 1;
+            nuevaRaiz->hijos.push_back(n);
+            nuevaRaiz->hijos.push_back(nuevo);
+            n->padre = nuevo->padre = nuevaRaiz;
+            recalcularMBR(nuevaRaiz);
+            raiz_ = nuevaRaiz;
+        } else {
+            Nodo* padre = n->padre;
+            nuevo->padre = padre;
+            padre->hijos.push_back(nuevo);
+            ajustarHaciaArriba(padre);
+            if ((int)padre->hijos.size() > M_)
+                overflowTreatment(padre);
+        }
+    }
+
+    void buscarEntrada(Nodo* n, const Punto& p, const std::function<bool(const T&)>& coincide,
+                       Nodo*& hoja, int& pos) {
+        if (hoja != nullptr || !n->mbr.contiene(p.data())) return;
+        if (n->esHoja) {
+            for (size_t i = 0; i < n->entradas.size(); i++) {
+                if (n->entradas[i].p == p && coincide(arena_[n->entradas[i].idx])) {
+                    hoja = n;
+                    pos = (int)i;
+                    return;
+                }
+            }
+        } else {
+            for (Nodo* h : n->hijos) buscarEntrada(h, p, coincide, hoja, pos);
+        }
+    }
+    // Subiendo desde la hoja, los nodos bajo m salen del padre y su
+    // contenido se reinserta al final
+    void condensar(Nodo* n) {
+        auto& huerfanas = borrador_.huerfanas;
+        auto& huerfanos = borrador_.huerfanos;
+        huerfanas.clear();
+        huerfanos.clear();
+        Nodo* actual = n;
+        while (actual != raiz_) {
+            Nodo* padre = actual->padre;
+            size_t cuenta = actual->esHoja ? actual->entradas.size() : actual->hijos.size();
+            if (cuenta < (size_t)m_) {
+                padre->hijos.erase(std::find(padre->hijos.begin(), padre->hijos.end(), actual));
+                if (actual->esHoja) huerfanas.insert(huerfanas.end(), actual->entradas.begin(), actual->entradas.end());
+                else                huerfanos.insert(huerfanos.end(), actual->hijos.begin(), actual->hijos.end());
+                liberar(actual);
+            } else {
+                recalcularMBR(actual);
+            }
+            actual = padre;
+        }
+        recalcularMBR(raiz_);
+        for (const auto& e : huerfanas) insertarEntrada(e);
+        for (Nodo* s : huerfanos) insertarSubarbol(s);
+    }
+
+    static size_t contarRec(const Nodo* n, const CajaD& bbox) {
+        if (!n->mbr.interseca(bbox)) return 0;
+        if (bbox.cubre(n->mbr)) return (size_t)n->cuenta;
+        size_t total = 0;
+        if (n->esHoja) {
+            for (const Resultado& e : n->entradas) total += bbox.contiene(e.p.data());
+        } else {
+            for (const Nodo* h : n->hijos) total += contarRec(h, bbox);
+        }
+        return total;
+    }
+    void recorrerRec(const Nodo* n, const std::function<void(const Resultado&)>& v) const {
+        if (n == nullptr) return;
+        if (n->esHoja) { for (const auto& e : n->entradas) v(e); }
+        else for (const Nodo* h : n->hijos) recorrerRec(h, v);
+    }
+    void inspeccionarRec(const Nodo* n, int prof, bool esRaiz,
+                         const std::function<void(bool, int, int, const CajaD&, size_t, size_t, bool)>& f) const {
+        if (n == nullptr) return;
+        f(n->esHoja, n->nivel, prof, n->mbr, n->entradas.size(), n->hijos.size(), esRaiz);
+        for (const Nodo* h : n->hijos) inspeccionarRec(h, prof + 1, false, f);
+    }
+};
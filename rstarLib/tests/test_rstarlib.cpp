@@ -2,10 +2,50 @@
 #include "../rstartree.hpp"
 #include "../indice_por_id.hpp"
 #include "../grupos_por_hoja.hpp"
+#include "../agregados_por_nodo.hpp"
+#include "../consultas_lote.hpp"
+#include "../arbol_mapeado.hpp"
+#include "../rstartree_nd.hpp"
+#include "../join_espacial.hpp"
+#include "../dbscan.hpp"
 #include <iostream>
 #include <string>
+#include <tuple>
+#include <cstdlib>
+#include <set>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <cstdio>
+#include <new>
 using namespace std;
 
+// Contador de reservas del heap (operator new global), para T28. Se
+// reemplazan juntas todas las formas (simple, arreglo, con tamano y
+// alineada) para que cada new tenga su delete sobre malloc/free.
+static atomic<size_t> reservas{0};
+static void* reservar(size_t n, size_t alineacion = 0) {
+    reservas.fetch_add(1, memory_order_relaxed);
+    if (n == 0) n = 1;
+    void* p = alineacion == 0 ? malloc(n) : aligned_alloc(alineacion, (n + alineacion - 1) / alineacion * alineacion);
+    if (p == nullptr) throw bad_alloc();
+    return p;
+}
+void* operator new(size_t n) { return reservar(n); }
+void* operator new[](size_t n) { return reservar(n); }
+void* operator new(size_t n, align_val_t a) { return reservar(n, (size_t)a); }
+void* operator new[](size_t n, align_val_t a) { return reservar(n, (size_t)a); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, align_val_t) noexcept { free(p); }
+void operator delete[](void* p, align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, align_val_t) noexcept { free(p); }
+
 static int fallos = 0;
 #define CHECK(cond, msg) do { \
     if (cond) { cout << "  [OK]    " << msg << endl; } \
@@ -20,6 +60,7 @@ static void test_caja() {
     CHECK(a.overlap(b) == 25.0, "overlap esquinas 5x5 = 25");
     CHECK(a.interseca(b) && !a.interseca(c), "interseca b, no interseca c");
     CHECK(a.contiene(5, 5) && !a.contiene(11, 5), "contiene (5,5), no (11,5)");
+    CHECK(a.cubre(Caja(1, 1, 10, 9)) && !a.cubre(b), "cubre cajas internas, no las que sobresalen");
     CHECK(a.dist2A(13, 14) == 3.0*3.0 + 4.0*4.0, "dist2 a punto externo = 25");
     CHECK(a.dist2A(5, 5) == 0.0, "dist2 a punto interno = 0");
     Caja d; d.estirar(3, 7); d.estirar(a);
@@ -276,6 +317,1884 @@ static void test_n_similares() {
     CHECK(deEt2 == 5, "los extra vienen del grupo con centroide mas cercano (etiqueta 2)");
 }
 
+static void test_carga_masiva() {
+    cout << "\nT11: cargarMasivo (STR)" << endl;
+    vector<tuple<double, double, int>> pts;
+    unsigned semilla = 777;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    for (int i = 0; i < 1000; i++) pts.emplace_back(rnd(), rnd(), i);
+
+    RStarTree2D<int> arbol(8, 3);
+    arbol.cargarMasivo(pts.begin(), pts.end());
+    CHECK(arbol.tamano() == 1000, "tamano 1000 tras la carga");
+
+    Stats s;
+    int hojasLlenas = 0, hojas = 0;
+    arbol.inspeccionar([&](bool esHoja, int, int prof, const Caja&, size_t nE, size_t nH, bool esRaiz) {
+        size_t cuenta = esHoja ? nE : nH;
+        if (cuenta > 8) s.violMax++;
+        if (!esRaiz && cuenta < 3) s.violMin++;
+        if (esRaiz && !esHoja && nH < 2) s.violMin++;
+        if (esHoja) { s.minProf = min(s.minProf, prof); s.maxProf = max(s.maxProf, prof); hojas++; }
+        if (esHoja && nE == 8) hojasLlenas++;
+    });
+    CHECK(s.violMax == 0 && s.violMin == 0, "invariantes m/M");
+    CHECK(s.minProf == s.maxProf, "hojas al mismo nivel");
+    CHECK(hojas == 125 && hojasLlenas == 125, "hojas empaquetadas: 1000/8 = 125 llenas");
+
+    Caja q(0.2, 0.3, 0.6, 0.5);
+    size_t esperados = 0;
+    for (auto& [x, y, d] : pts) if (q.contiene(x, y)) esperados++;
+    auto res = arbol.buscarRango(q);
+    bool datosOk = true;
+    for (auto& r : res) if (get<0>(pts[arbol.dato(r.idx)]) != r.x) datosOk = false;
+    CHECK(res.size() == esperados && datosOk, "buscarRango coincide con fuerza bruta");
+
+    for (int i = 0; i < 200; i++) arbol.insertar(rnd(), rnd(), 1000 + i);
+    s = Stats();
+    arbol.inspeccionar([&](bool esHoja, int, int prof, const Caja&, size_t nE, size_t nH, bool esRaiz) {
+        size_t cuenta = esHoja ? nE : nH;
+        if (cuenta > 8) s.violMax++;
+        if (!esRaiz && cuenta < 3) s.violMin++;
+        if (esHoja) { s.minProf = min(s.minProf, prof); s.maxProf = max(s.maxProf, prof); }
+    });
+    CHECK(s.violMax == 0 && s.violMin == 0 && s.minProf == s.maxProf,
+          "insertar sobre el arbol cargado mantiene invariantes");
+    CHECK(arbol.buscarRango(Caja(-1, -1, 2, 2)).size() == 1200, "los 1200 puntos siguen en el indice");
+
+    bool exploto = false;
+    try { arbol.cargarMasivo(pts.begin(), pts.end()); } catch (const std::logic_error&) { exploto = true; }
+    CHECK(exploto, "cargarMasivo sobre arbol no vacio lanza logic_error");
+
+    for (int n : {1, 9, 17}) {
+        RStarTree2D<int> t(8, 3);
+        t.cargarMasivo(pts.begin(), pts.begin() + n);
+        int viol = 0;
+        t.inspeccionar([&](bool esHoja, int, int, const Caja&, size_t nE, size_t nH, bool esRaiz) {
+            size_t cuenta = esHoja ? nE : nH;
+            if (cuenta > 8 || (!esRaiz && cuenta < 3)) viol++;
+        });
+        CHECK(viol == 0 && t.tamano() == (size_t)n, "n=" + to_string(n) + " respeta m/M");
+    }
+}
+
+static void test_hilbert() {
+    cout << "\nT12: claveHilbert y cargarMasivo Hilbert" << endl;
+    // las primeras 256 claves llenan el bloque 16x16 del origen, y claves
+    // consecutivas son celdas vecinas
+    vector<pair<int,int>> celda(256, {-1, -1});
+    bool enBloque = true;
+    for (uint32_t x = 0; x < 16; x++)
+        for (uint32_t y = 0; y < 16; y++) {
+            uint32_t d = claveHilbert(x, y);
+            if (d >= 256) enBloque = false;
+            else celda[d] = {(int)x, (int)y};
+        }
+    bool vecinas = enBloque;
+    for (int d = 1; d < 256 && vecinas; d++)
+        if (abs(celda[d].first - celda[d-1].first) + abs(celda[d].second - celda[d-1].second) != 1)
+            vecinas = false;
+    CHECK(enBloque, "claves 0..255 = bloque 16x16 del origen");
+    CHECK(vecinas, "claves consecutivas son celdas vecinas");
+
+    vector<tuple<double, double, int>> pts;
+    unsigned semilla = 4242;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    for (int i = 0; i < 1000; i++) pts.emplace_back(rnd(), rnd(), i);
+
+    RStarTree2D<int> arbol(8, 3);
+    arbol.cargarMasivo(pts.begin(), pts.end(), Empaquetado::Hilbert);
+    Stats s;
+    arbol.inspeccionar([&](bool esHoja, int, int prof, const Caja&, size_t nE, size_t nH, bool esRaiz) {
+        size_t cuenta = esHoja ? nE : nH;
+        if (cuenta > 8) s.violMax++;
+        if (!esRaiz && cuenta < 3) s.violMin++;
+        if (esRaiz && !esHoja && nH < 2) s.violMin++;
+        if (esHoja) { s.minProf = min(s.minProf, prof); s.maxProf = max(s.maxProf, prof); }
+    });
+    CHECK(s.violMax == 0 && s.violMin == 0 && s.minProf == s.maxProf, "invariantes m/M y altura");
+
+    Caja q(0.1, 0.6, 0.45, 0.9);
+    size_t esperados = 0;
+    for (auto& [x, y, d] : pts) if (q.contiene(x, y)) esperados++;
+    CHECK(arbol.buscarRango(q).size() == esperados, "buscarRango coincide con fuerza bruta");
+    auto knn = arbol.kVecinos(0.5, 0.5, 5);
+    CHECK(knn.size() == 5, "kVecinos sobre arbol Hilbert");
+
+    auto c = arbol.calidad();
+    CHECK(c.hojas == 125 && c.ocupacion > 0.99, "calidad: 125 hojas llenas");
+    CHECK(c.altura == 4 && c.internos == 16 + 2 + 1, "calidad: altura 4, 19 internos");
+    CHECK(c.overlap >= 0.0 && c.espacioMuerto > 0.0 && c.areaRaiz > 0.9, "calidad: overlap y espacio muerto");
+
+    RStarTree2D<int> vacio(8, 3);
+    CHECK(vacio.calidad().hojas == 0, "calidad de arbol vacio");
+}
+
+static void test_pool_nodos() {
+    cout << "\nT13: pool de nodos y reciclaje" << endl;
+    RStarTree2D<int> arbol(8, 3);
+    int id = 0;
+    for (int i = 0; i < 20; i++)
+        for (int j = 0; j < 10; j++)
+            arbol.insertar(i * 0.01, j * 0.01, id++);
+    set<uintptr_t> antes;
+    arbol.visitarHojas([&](const RStarTree2D<int>::HojaVista& h) { antes.insert(h.clave); });
+    size_t bytes = arbol.calidad().bytesNodos;
+    CHECK(bytes > 0, "los nodos viven en los pools");
+
+    for (int i = 0; i < 15; i++)
+        for (int j = 0; j < 10; j++)
+            arbol.eliminar(i * 0.01, j * 0.01, [](const int&) { return true; });
+    set<uintptr_t> liberadas = antes;
+    arbol.visitarHojas([&](const RStarTree2D<int>::HojaVista& h) { liberadas.erase(h.clave); });
+    CHECK(!liberadas.empty(), "condensar disolvio hojas");
+
+    for (int i = 0; i < 150; i++) arbol.insertar(1.0 + i * 0.01, 1.0, id++);
+    int recicladas = 0;
+    arbol.visitarHojas([&](const RStarTree2D<int>::HojaVista& h) { recicladas += liberadas.count(h.clave); });
+    CHECK(recicladas > 0, "las hojas nuevas reusan celdas liberadas");
+    CHECK(arbol.calidad().bytesNodos == bytes, "sin slabs nuevos tras borrar y reinsertar");
+    CHECK(arbol.buscarRango(Caja(-1, -1, 3, 3)).size() == 200, "200 puntos en el indice");
+}
+
+static void test_hojas_columnas() {
+    cout << "\nT14: hojas en columnas (x[], y[], idx[])" << endl;
+    RStarTree2D<int> arbol(8, 3);
+    for (int i = 0; i < 100; i++) arbol.insertar(i * 0.5, 100.0 - i, i);
+    bool coherentes = true;
+    size_t total = 0;
+    arbol.visitarHojas([&](const RStarTree2D<int>::HojaVista& h) {
+        const auto& c = h.entradas;
+        size_t i = 0;
+        for (const RStarTree2D<int>::Resultado& r : c) {
+            if (r.x != c.x[i] || r.y != c.y[i] || r.idx != c.idx[i] || c[i].idx != r.idx) coherentes = false;
+            if (arbol.dato(r.idx) * 0.5 != r.x || !h.mbr.contiene(r.x, r.y)) coherentes = false;
+            i++;
+        }
+        if (i != c.size()) coherentes = false;
+        total += i;
+    });
+    CHECK(coherentes, "columnas, iterador y operator[] coinciden con la arena");
+    CHECK(total == 100, "las columnas cubren los 100 puntos");
+
+    for (int i = 0; i < 100; i += 2) arbol.eliminar(i * 0.5, 100.0 - i, [](const int&) { return true; });
+    auto res = arbol.buscarRango(Caja(-1, -1, 100, 200));
+    bool impares = res.size() == 50;
+    for (auto& r : res) if (arbol.dato(r.idx) % 2 == 0 || r.y != 100.0 - arbol.dato(r.idx)) impares = false;
+    CHECK(impares, "erase/reinsert mantienen las tres columnas alineadas");
+}
+
+static void test_nucleos_simd() {
+    cout << "\nT15: nucleos de filtrado de hojas (escalar / SSE2 / AVX2)" << endl;
+    unsigned semilla = 99;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return (double)((semilla >> 8) % 1000) / 100.0;   // grilla 0.01: muchos bordes exactos
+    };
+    vector<double> xs(1203), ys(1203);
+    for (size_t i = 0; i < xs.size(); i++) { xs[i] = rnd(); ys[i] = rnd(); }
+
+    vector<NucleoSimd> nucleos = {NucleoSimd::Escalar};
+    if (simdSoporta(NucleoSimd::SSE2)) nucleos.push_back(NucleoSimd::SSE2);
+    if (simdSoporta(NucleoSimd::AVX2)) nucleos.push_back(NucleoSimd::AVX2);
+    cout << "  nucleos disponibles: " << nucleos.size() << endl;
+
+    auto filtrarCon = [&](NucleoSimd nuc, uint32_t n, const Caja& q, uint32_t* out) -> uint32_t {
+#ifdef RSTAR_SIMD_X86
+        if (nuc == NucleoSimd::AVX2) return filtrarCajaAVX2(xs.data(), ys.data(), n, q.lo[0], q.lo[1], q.hi[0], q.hi[1], out);
+        if (nuc == NucleoSimd::SSE2) return filtrarCajaSSE2(xs.data(), ys.data(), n, q.lo[0], q.lo[1], q.hi[0], q.hi[1], out);
+#endif
+        return filtrarCajaEscalar(xs.data(), ys.data(), n, q.lo[0], q.lo[1], q.hi[0], q.hi[1], out);
+    };
+    auto distCon = [&](NucleoSimd nuc, uint32_t n, double qx, double qy, double* out) {
+#ifdef RSTAR_SIMD_X86
+        if (nuc == NucleoSimd::AVX2) { distancias2AVX2(xs.data(), ys.data(), n, qx, qy, out); return; }
+        if (nuc == NucleoSimd::SSE2) { distancias2SSE2(xs.data(), ys.data(), n, qx, qy, out); return; }
+#endif
+        distancias2Escalar(xs.data(), ys.data(), n, qx, qy, out);
+    };
+
+    bool rangoOk = true, distOk = true;
+    vector<Caja> cajas = {Caja(2, 3, 5, 7), Caja(0, 0, 10, 10), Caja(4.5, 4.5, 4.5, 4.5), Caja(20, 20, 30, 30)};
+    for (uint32_t n : {0u, 1u, 3u, 4u, 5u, 7u, 64u, 1201u, 1203u}) {
+        for (const Caja& q : cajas) {
+            vector<uint32_t> esperado;
+            for (uint32_t i = 0; i < n; i++) if (q.contiene(xs[i], ys[i])) esperado.push_back(i);
+            for (NucleoSimd nuc : nucleos) {
+                vector<uint32_t> out(n + 4);
+                uint32_t k = filtrarCon(nuc, n, q, out.data());
+                out.resize(k);
+                if (out != esperado) rangoOk = false;
+            }
+        }
+        for (NucleoSimd nuc : nucleos) {
+            vector<double> d(n + 1);
+            distCon(nuc, n, 4.2, 6.3, d.data());
+            for (uint32_t i = 0; i < n; i++) {
+                double dx = xs[i] - 4.2, dy = ys[i] - 6.3;
+                if (d[i] != dx * dx + dy * dy) distOk = false;
+            }
+        }
+    }
+    CHECK(rangoOk, "filtrarCaja: mismos aciertos y orden que Caja::contiene (bordes y colas)");
+    CHECK(distOk, "distancias2: identicas a la escalar");
+}
+
+static void test_rango_sin_materializar() {
+    cout << "\nT16: buscarRango en buffer propio y CursorRango" << endl;
+    RStarTree2D<int> arbol(8, 3);
+    int id = 0;
+    for (int i = 0; i < 40; i++)
+        for (int j = 0; j < 30; j++)
+            arbol.insertar(i * 0.1, j * 0.1, id++);
+    Caja q(0.45, 0.25, 2.05, 1.55);
+    auto esperado = arbol.buscarRango(q);
+    CHECK(esperado.size() == 16 * 13, "buscarRango: 16 x 13 puntos en la caja");
+
+    vector<RStarTree2D<int>::Resultado> buffer(5);
+    arbol.buscarRango(q, buffer);
+    arbol.buscarRango(q, buffer);
+    CHECK(buffer.size() == 5 + 2 * esperado.size(), "el overload agrega al final del buffer");
+
+    auto claves = [&](const vector<RStarTree2D<int>::Resultado>& v) {
+        vector<uint32_t> k;
+        for (auto& r : v) k.push_back(r.idx);
+        sort(k.begin(), k.end());
+        return k;
+    };
+    auto cursor = arbol.cursorRango(q);
+    vector<RStarTree2D<int>::Resultado> porCursor;
+    int lotes = 0;
+    bool lotesDentro = true;
+    while (cursor.siguiente()) {
+        lotes++;
+        if (cursor.lote().empty() || cursor.lote().size() > 8) lotesDentro = false;
+        for (auto& r : cursor.lote()) { porCursor.push_back(r); if (!q.contiene(r.x, r.y)) lotesDentro = false; }
+    }
+    CHECK(claves(porCursor) == claves(esperado), "el cursor entrega los mismos aciertos");
+    CHECK(lotes > 1 && lotesDentro, "un lote no vacio por hoja, todos dentro de la caja");
+    CHECK(!cursor.siguiente(), "cursor agotado sigue devolviendo false");
+
+    cursor.reiniciar(Caja(-1, -1, 10, 10));
+    size_t primeros = 0;
+    while (primeros < 20 && cursor.siguiente()) primeros += cursor.lote().size();
+    CHECK(primeros >= 20 && primeros < 20 + 8, "corte temprano: solo las hojas necesarias");
+
+    cursor.reiniciar(Caja(50, 50, 60, 60));
+    CHECK(!cursor.siguiente(), "caja sin aciertos");
+    RStarTree2D<int> vacio(8, 3);
+    auto cv = vacio.cursorRango(q);
+    CHECK(!cv.siguiente() && vacio.buscarRango(q).empty(), "arbol vacio");
+}
+
+static void test_contar_en_rango() {
+    cout << "\nT17: contarEnRango con cuentas por subarbol" << endl;
+    unsigned semilla = 2024;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    vector<Caja> cajas;
+    for (int i = 0; i < 40; i++) {
+        double x = rnd(), y = rnd(), w = rnd() * 0.5, h = rnd() * 0.5;
+        cajas.push_back(Caja(x, y, x + w, y + h));
+    }
+    cajas.push_back(Caja(-1, -1, 2, 2));
+    auto coincide = [&](const RStarTree2D<int>& a) {
+        for (const Caja& q : cajas) if (a.contarEnRango(q) != a.buscarRango(q).size()) return false;
+        return a.contarEnRango(Caja(-1, -1, 2, 2)) == a.tamano();
+    };
+
+    RStarTree2D<int> arbol(8, 3);
+    vector<pair<double,double>> pts;
+    for (int i = 0; i < 600; i++) {
+        double x = rnd(), y = rnd();
+        pts.push_back({x, y});
+        arbol.insertar(x, y, i);
+    }
+    CHECK(coincide(arbol), "tras insertar (splits y reinserts): igual a buscarRango().size()");
+
+    for (int i = 0; i < 600; i += 3) arbol.eliminar(pts[i].first, pts[i].second, [](const int&) { return true; });
+    CHECK(coincide(arbol), "tras eliminar y condensar");
+
+    vector<tuple<double, double, int>> carga;
+    for (int i = 0; i < 600; i++) carga.emplace_back(rnd(), rnd(), i);
+    RStarTree2D<int> str(8, 3), hil(8, 3);
+    str.cargarMasivo(carga.begin(), carga.end());
+    hil.cargarMasivo(carga.begin(), carga.end(), Empaquetado::Hilbert);
+    CHECK(coincide(str) && coincide(hil), "tras cargarMasivo STR y Hilbert");
+
+    RStarTree2D<int> vacio(8, 3);
+    CHECK(vacio.contarEnRango(Caja(0, 0, 1, 1)) == 0, "arbol vacio cuenta 0");
+}
+
+struct ViajeTarifa { double tarifa, propina; };
+
+static void test_agregados() {
+    cout << "\nT18: AgregadosPorNodo (suma/min/max/promedio en bbox)" << endl;
+    unsigned semilla = 31337;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    RStarTree2D<ViajeTarifa> arbol(8, 3);
+    vector<pair<double,double>> pts;
+    auto insertar = [&](int n) {
+        for (int i = 0; i < n; i++) {
+            double x = rnd(), y = rnd();
+            pts.push_back({x, y});
+            // montos enteros: las sumas en cualquier orden son exactas
+            arbol.insertar(x, y, ViajeTarifa{(double)(5 + (int)(rnd() * 60)), (double)(int)(rnd() * 12)});
+        }
+    };
+    insertar(400);
+    AgregadosPorNodo<ViajeTarifa, 2> agr(arbol, [](const ViajeTarifa& v) {
+        return AgregadosPorNodo<ViajeTarifa, 2>::Medidas{v.tarifa, v.propina};
+    });
+    agr.construir();
+
+    vector<Caja> cajas;
+    for (int i = 0; i < 30; i++) {
+        double x = rnd(), y = rnd(), w = rnd() * 0.6, h = rnd() * 0.6;
+        cajas.push_back(Caja(x, y, x + w, y + h));
+    }
+    cajas.push_back(Caja(-1, -1, 2, 2));
+    auto coincide = [&]() {
+        for (const Caja& q : cajas) {
+            AgregadosPorNodo<ViajeTarifa, 2>::Resumen fb;
+            for (auto& r : arbol.buscarRango(q)) fb.agregar({arbol.dato(r.idx).tarifa, arbol.dato(r.idx).propina});
+            auto a = agr.agregarEnRango(q);
+            if (a.cuenta != fb.cuenta) return false;
+            for (int k = 0; k < 2; k++)
+                if (a.suma[k] != fb.suma[k] || a.min[k] != fb.min[k] || a.max[k] != fb.max[k]) return false;
+        }
+        return true;
+    };
+    CHECK(coincide(), "cuenta/suma/min/max iguales a fuerza bruta");
+
+    size_t antes = agr.nodosRecalculados();
+    agr.agregarEnRango(Caja(-1, -1, 2, 2));
+    CHECK(agr.nodosRecalculados() == antes, "sin mutaciones no recalcula nada (usa la cache)");
+    auto total = agr.agregarEnRango(Caja(-1, -1, 2, 2));
+    CHECK(total.cuenta == 400 && total.promedio(0) >= 5 && total.promedio(0) <= 65, "promedio de tarifa en rango");
+
+    insertar(300);
+    CHECK(coincide(), "tras insertar (splits y reinserts)");
+    size_t tras = agr.nodosRecalculados();
+    agr.agregarEnRango(Caja(-1, -1, 2, 2));
+    CHECK(agr.nodosRecalculados() == tras, "la cache vuelve a quedar vigente");
+
+    for (size_t i = 0; i < pts.size(); i += 2)
+        arbol.eliminar(pts[i].first, pts[i].second, [](const ViajeTarifa&) { return true; });
+    CHECK(coincide(), "tras eliminar y condensar");
+    CHECK(agr.agregarEnRango(Caja(-1, -1, 2, 2)).cuenta == arbol.tamano(), "cuenta total = tamano");
+
+    // rafagas con instantaneas (cada publicar deja originales clonados) y
+    // despues casi todo eliminado (celdas liberadas): la cache no debe
+    // quedarse con las entradas de esos nodos
+    auto nodosVivos = [&]() {
+        size_t nodos = 0;
+        std::function<void(RStarTree2D<ViajeTarifa>::NodoVista)> contar = [&](RStarTree2D<ViajeTarifa>::NodoVista v) {
+            nodos++;
+            if (!v.esHoja()) for (size_t i = 0; i < v.nHijos(); i++) contar(v.hijo(i));
+        };
+        contar(arbol.raiz());
+        return nodos;
+    };
+    arbol.activarInstantaneas();
+    for (int ronda = 0; ronda < 200; ronda++) {
+        size_t desde = pts.size();
+        insertar(40);
+        for (size_t i = desde; i < pts.size(); i += 2)
+            arbol.eliminar(pts[i].first, pts[i].second, [](const ViajeTarifa&) { return true; });
+        arbol.publicar();
+        agr.agregarEnRango(Caja(-1, -1, 2, 2));
+    }
+    CHECK(coincide() && agr.entradasEnCache() <= 2 * nodosVivos() + 64,
+          "rafagas con instantaneas: la cache queda acotada por los nodos vivos");
+    for (size_t i = 0; i + 30 < pts.size(); i++)
+        arbol.eliminar(pts[i].first, pts[i].second, [](const ViajeTarifa&) { return true; });
+    arbol.publicar();
+    CHECK(coincide() && agr.entradasEnCache() <= 2 * nodosVivos() + 64,
+          "tras eliminar casi todo: se descartan las entradas de los nodos liberados");
+}
+
+static void test_vecinos_incrementales() {
+    cout << "\nT19: vecinosIncrementales (distance browsing)" << endl;
+    RStarTree2D<int> arbol(8, 3);
+    vector<pair<double,double>> pts;
+    unsigned semilla = 5150;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    for (int i = 0; i < 400; i++) {
+        double x = rnd(), y = rnd();
+        pts.push_back({x, y});
+        arbol.insertar(x, y, i);
+    }
+    double qx = 0.3, qy = 0.7;
+    auto d2 = [&](int i) { double dx = pts[i].first - qx, dy = pts[i].second - qy; return dx*dx + dy*dy; };
+
+    auto it = arbol.vecinosIncrementales(qx, qy);
+    vector<int> orden;
+    bool monotona = true, distOk = true;
+    double previa = -1;
+    while (it.siguiente()) {
+        int d = arbol.dato(it.actual().idx);
+        if (it.distancia2() < previa) monotona = false;
+        if (it.distancia2() != d2(d)) distOk = false;
+        previa = it.distancia2();
+        orden.push_back(d);
+    }
+    CHECK(orden.size() == 400, "entrega los 400 puntos una sola vez");
+    CHECK(monotona && distOk, "en orden creciente de distancia, con la distancia correcta");
+    auto knn = arbol.kVecinos(qx, qy, 25);
+    bool igualKnn = true;
+    for (int i = 0; i < 25; i++) if (arbol.dato(knn[i].idx) != orden[i]) igualKnn = false;
+    CHECK(igualKnn, "los primeros 25 coinciden con kVecinos(25)");
+
+    // filtro: solo multiplos de 7, y contar cuantas veces se consulta
+    int llamadas = 0;
+    auto filtrado = arbol.vecinosIncrementales(qx, qy, [&](const int& d) { llamadas++; return d % 7 == 0; });
+    vector<int> fb;
+    for (int i = 0; i < 400; i++) if (i % 7 == 0) fb.push_back(i);
+    sort(fb.begin(), fb.end(), [&](int a, int b) { return d2(a) < d2(b); });
+    bool filtroOk = true;
+    for (int i = 0; i < 5; i++) {
+        if (!filtrado.siguiente() || arbol.dato(filtrado.actual().idx) != fb[i]) filtroOk = false;
+    }
+    CHECK(filtroOk, "con filtro: los 5 multiplos de 7 mas cercanos, en orden");
+    int examinados = 0;
+    for (int i = 0; i < 400; i++) if (d2(i) <= d2(fb[4])) examinados++;
+    CHECK(llamadas == examinados, "el filtro solo se evalua sobre los candidatos hasta el 5to aceptado");
+
+    RStarTree2D<int> vacio(8, 3);
+    auto iv = vacio.vecinosIncrementales(0, 0);
+    CHECK(!iv.siguiente(), "arbol vacio: sin vecinos");
+}
+
+static void test_consultas_lote() {
+    cout << "\nT20: consultarLote / kVecinosLote en paralelo" << endl;
+    RStarTree2D<int> arbol(16, 6);
+    unsigned semilla = 2024;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    for (int i = 0; i < 3000; i++) arbol.insertar(rnd(), rnd(), i);
+    vector<Caja> cajas;
+    vector<ConsultasLote<int>::Punto> puntos;
+    for (int i = 0; i < 500; i++) {
+        double x = rnd(), y = rnd(), l = rnd() * 0.1;
+        cajas.push_back(Caja(x, y, x + l, y + l));
+        puntos.push_back({x, y});
+    }
+
+    for (unsigned hilos : {1u, 4u}) {
+        ConsultasLote<int> motor(arbol, hilos);
+        CHECK(motor.hilos() == hilos, "pool de " + to_string(hilos) + " hilo(s)");
+        bool rangoOk = true;
+        for (int ronda = 0; ronda < 2; ronda++) {   // la 2da reusa los buffers por hilo
+            auto res = motor.consultarLote(cajas);
+            for (size_t i = 0; i < cajas.size(); i++) {
+                set<uint32_t> a, b;
+                for (const auto& r : res[i]) a.insert(r.idx);
+                for (const auto& r : arbol.buscarRango(cajas[i])) b.insert(r.idx);
+                if (a != b || res[i].size() != b.size()) rangoOk = false;
+            }
+        }
+        CHECK(rangoOk, "consultarLote: cada tramo igual a buscarRango de su caja");
+        auto vec = motor.kVecinosLote(puntos, 7);
+        bool knnOk = vec.size() == puntos.size();
+        for (size_t i = 0; knnOk && i < puntos.size(); i++) {
+            auto e = arbol.kVecinos(puntos[i].x, puntos[i].y, 7);
+            if (vec[i].size() != e.size()) { knnOk = false; break; }
+            for (size_t j = 0; j < e.size(); j++) if (vec[i][j].idx != e[j].idx) knnOk = false;
+        }
+        CHECK(knnOk, "kVecinosLote: cada tramo igual a kVecinos(7) de su punto");
+    }
+    ConsultasLote<int> motor(arbol, 2);
+    auto mas = motor.kVecinosLote(puntos.data(), 3, 5000);
+    CHECK(mas.size() == 3 && mas[0].size() == 3000, "k mayor que el arbol: devuelve todos");
+    CHECK(motor.consultarLote(nullptr, 0).empty(), "lote vacio");
+}
+static void test_instantaneas() {
+    cout << "\nT21: instantaneas (copia-en-escritura + epocas)" << endl;
+    RStarTree2D<int> arbol(8, 3);
+    unsigned semilla = 777;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    vector<pair<double,double>> pts;
+    for (int i = 0; i < 1500; i++) {
+        pts.push_back({rnd(), rnd()});
+        arbol.insertar(pts[i].first, pts[i].second, i);
+    }
+    arbol.activarInstantaneas();
+    Caja todo(-1, -1, 2, 2), zona(0.2, 0.2, 0.6, 0.5);
+    auto ids = [&](const vector<RStarTree2D<int>::Resultado>& v) {
+        set<int> r;
+        for (const auto& e : v) r.insert(arbol.dato(e.idx));
+        return r;
+    };
+    auto s1 = arbol.instantanea();
+    set<int> antes = ids(s1.buscarRango(zona));
+    auto knnAntes = s1.kVecinos(0.5, 0.5, 10);
+
+    // el escritor sigue: inserts con splits/reinserts y eliminaciones
+    for (int i = 1500; i < 3000; i++) {
+        pts.push_back({rnd(), rnd()});
+        arbol.insertar(pts[i].first, pts[i].second, i);
+    }
+    for (int i = 0; i < 300; i++)
+        arbol.eliminar(pts[i].first, pts[i].second, [&](const int& d) { return d == i; });
+    CHECK(arbol.tamano() == 2700, "el arbol vivo ve sus propias escrituras");
+    auto s2 = arbol.instantanea();
+    CHECK(s2.tamano() == 1500 && s1.tamano() == 1500, "sin publicar: las instantaneas siguen en 1500");
+    CHECK(ids(s1.buscarRango(zona)) == antes && s1.contarEnRango(todo) == 1500,
+          "la instantanea vieja responde igual que antes de escribir");
+    bool knnIgual = true;
+    auto knnDespues = s1.kVecinos(0.5, 0.5, 10);
+    for (int i = 0; i < 10; i++) if (knnDespues[i].idx != knnAntes[i].idx) knnIgual = false;
+    CHECK(knnIgual, "kVecinos sobre la instantanea vieja no cambia");
+
+    arbol.publicar();
+    size_t retenidos = arbol.nodosRetenidos();
+    CHECK(retenidos > 0, "los nodos reemplazados quedan retenidos mientras s1/s2 leen");
+    auto s3 = arbol.instantanea();
+    set<int> esperado;
+    for (int i = 300; i < 3000; i++)
+        if (zona.contiene(pts[i].first, pts[i].second)) esperado.insert(i);
+    CHECK(s3.tamano() == 2700 && ids(s3.buscarRango(zona)) == esperado,
+          "tras publicar: la instantanea nueva ve los cambios");
+    CHECK(ids(s1.buscarRango(zona)) == antes, "s1 sigue intacta tras publicar");
+    { auto t = std::move(s1); }   // soltar s1 y s2
+    { auto t = std::move(s2); }
+    arbol.publicar();
+    CHECK(arbol.nodosRetenidos() == 0, "sin lectores viejos: los retenidos vuelven al pool");
+
+    // estructura del arbol vivo tras copiar caminos: MBRs y cuentas
+    bool estructuraOk = true;
+    std::function<void(RStarTree2D<int>::NodoVista)> revisar = [&](RStarTree2D<int>::NodoVista n) {
+        if (n.esHoja()) { if (n.cuenta() != n.entradas().size()) estructuraOk = false; return; }
+        uint64_t suma = 0;
+        for (size_t i = 0; i < n.nHijos(); i++) {
+            auto h = n.hijo(i);
+            if (!n.mbr().cubre(h.mbr())) estructuraOk = false;
+            suma += h.cuenta();
+            revisar(h);
+        }
+        if (suma != n.cuenta()) estructuraOk = false;
+    };
+    revisar(arbol.raiz());
+    CHECK(estructuraOk, "MBRs y cuentas consistentes en el arbol vivo");
+
+    // concurrente: un escritor publica por lotes y 3 lectores verifican que
+    // cada instantanea sea coherente consigo misma
+    RStarTree2D<int> vivo(16, 6);
+    vivo.activarInstantaneas();
+    atomic<bool> fin(false);
+    atomic<int> incoherentes(0), lecturas(0);
+    vector<thread> lectores;
+    for (int l = 0; l < 3; l++) {
+        lectores.emplace_back([&] {
+            while (!fin.load()) {
+                auto s = vivo.instantanea();
+                size_t n = s.tamano();
+                auto r = s.buscarRango(todo);
+                bool ok = r.size() == n && s.contarEnRango(todo) == n;
+                for (const auto& e : r) if (s.dato(e.idx) != (int)e.idx) ok = false;
+                if (!ok) incoherentes++;
+                lecturas++;
+            }
+        });
+    }
+    for (int lote = 0; lote < 40; lote++) {
+        for (int i = 0; i < 100; i++) vivo.insertar(rnd(), rnd(), (int)vivo.tamano());
+        vivo.publicar();
+        this_thread::yield();
+    }
+    fin = true;
+    for (auto& t : lectores) t.join();
+    CHECK(incoherentes == 0, "lectores concurrentes: " + to_string(lecturas.load()) + " instantaneas coherentes");
+    CHECK(vivo.instantanea().tamano() == 4000, "la ultima publicacion tiene los 4000 puntos");
+}
+static void test_carga_paralela() {
+    cout << "\nT22: cargarMasivo en paralelo (identico al de un hilo)" << endl;
+    unsigned semilla = 4242;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    // coordenadas en grilla gruesa: muchos empates en x y en y
+    vector<tuple<double, double, int>> pts;
+    for (int i = 0; i < 60000; i++)
+        pts.push_back({floor(rnd() * 300) / 300, floor(rnd() * 300) / 300, i});
+
+    std::function<bool(RStarTree2D<int>::NodoVista, RStarTree2D<int>::NodoVista)> iguales =
+        [&](RStarTree2D<int>::NodoVista a, RStarTree2D<int>::NodoVista b) {
+            if (a.esHoja() != b.esHoja() || a.cuenta() != b.cuenta()) return false;
+            for (int d = 0; d < 2; d++)
+                if (a.mbr().lo[d] != b.mbr().lo[d] || a.mbr().hi[d] != b.mbr().hi[d]) return false;
+            if (a.esHoja()) {
+                const auto &ea = a.entradas(), &eb = b.entradas();
+                if (ea.size() != eb.size()) return false;
+                for (size_t i = 0; i < ea.size(); i++) if (ea.idx[i] != eb.idx[i]) return false;
+                return true;
+            }
+            if (a.nHijos() != b.nHijos()) return false;
+            for (size_t i = 0; i < a.nHijos(); i++) if (!iguales(a.hijo(i), b.hijo(i))) return false;
+            return true;
+        };
+
+    PoolHilos pool(4);
+    for (Empaquetado modo : {Empaquetado::STR, Empaquetado::Hilbert}) {
+        const char* nombre = modo == Empaquetado::STR ? "STR" : "Hilbert";
+        RStarTree2D<int> uno(16, 6), varios(16, 6);
+        uno.cargarMasivo(pts.begin(), pts.end(), modo);
+        varios.cargarMasivo(pts.begin(), pts.end(), modo, pool);
+        CHECK(varios.tamano() == 60000, string(nombre) + ": 60000 puntos");
+        CHECK(iguales(uno.raiz(), varios.raiz()),
+              string(nombre) + ": misma forma, MBRs y orden de entradas que con un hilo");
+    }
+
+    // el orden estable paralelo coincide con std::stable_sort
+    vector<pair<int, int>> v;
+    for (int i = 0; i < 50000; i++) v.push_back({(int)(rnd() * 100), i});
+    auto esperado = v;
+    auto porPrimero = [](const pair<int, int>& a, const pair<int, int>& b) { return a.first < b.first; };
+    stable_sort(esperado.begin(), esperado.end(), porPrimero);
+    ordenarEstable(v, porPrimero, &pool);
+    CHECK(v == esperado, "ordenarEstable con 4 hilos == std::stable_sort");
+
+    // robo de trabajo: tareas de costo muy dispar, cada una exactamente una vez
+    vector<atomic<int>> hechas(3000);
+    atomic<long> carga(0);
+    pool.paraCada(3000, 8, [&](size_t i, unsigned) {
+        long c = i < 100 ? 20000 : 10;   // el primer tramo es el caro
+        for (long k = 0; k < c; k++) carga += 1;
+        hechas[i]++;
+    });
+    bool unaVez = true;
+    for (auto& h : hechas) if (h != 1) unaVez = false;
+    CHECK(unaVez, "paraCada con robo: cada tarea corre exactamente una vez");
+}
+static void test_guardar_cargar() {
+    cout << "\nT23: guardar / cargar en archivo binario" << endl;
+    const char* ruta = "test_rstarlib_arbol.bin";
+    RStarTree2D<int> arbol(8, 3);
+    unsigned semilla = 99;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    vector<pair<double,double>> pts;
+    for (int i = 0; i < 2000; i++) {
+        pts.push_back({rnd(), rnd()});
+        arbol.insertar(pts[i].first, pts[i].second, i * 3);
+    }
+    for (int i = 0; i < 100; i++)   // tombstones en la arena
+        arbol.eliminar(pts[i].first, pts[i].second, [&](const int& d) { return d == i * 3; });
+    arbol.guardar(ruta);
+
+    RStarTree2D<int> copia(8, 3);
+    copia.cargar(ruta);
+    bool igual = true;
+    std::function<void(RStarTree2D<int>::NodoVista, RStarTree2D<int>::NodoVista)> comparar =
+        [&](RStarTree2D<int>::NodoVista a, RStarTree2D<int>::NodoVista b) {
+            if (a.esHoja() != b.esHoja() || a.cuenta() != b.cuenta() || a.version() != b.version() ||
+                a.mbr().lo[0] != b.mbr().lo[0] || a.mbr().hi[1] != b.mbr().hi[1]) { igual = false; return; }
+            if (a.esHoja()) {
+                for (size_t i = 0; i < a.entradas().size(); i++)
+                    if (a.entradas()[i].idx != b.entradas()[i].idx || a.entradas()[i].x != b.entradas()[i].x) igual = false;
+                return;
+            }
+            if (a.nHijos() != b.nHijos()) { igual = false; return; }
+            for (size_t i = 0; i < a.nHijos(); i++) comparar(a.hijo(i), b.hijo(i));
+        };
+    comparar(arbol.raiz(), copia.raiz());
+    CHECK(copia.tamano() == 1900 && igual, "misma jerarquia, entradas, cuentas y versiones");
+    bool arenaOk = true;
+    for (uint32_t i = 0; i < 2000; i++) if (copia.dato(i) != (int)i * 3) arenaOk = false;
+    CHECK(arenaOk, "arena completa, tombstones incluidos");
+
+    // el arbol cargado sigue siendo mutable (padres reconstruidos)
+    for (int i = 0; i < 300; i++) copia.insertar(rnd(), rnd(), -1);
+    for (int i = 100; i < 200; i++)
+        copia.eliminar(pts[i].first, pts[i].second, [&](const int& d) { return d == i * 3; });
+    CHECK(copia.tamano() == 2100 && copia.contarEnRango(Caja(-1, -1, 2, 2)) == 2100,
+          "insertar y eliminar despues de cargar");
+
+    // T no trivial: serializador
+    struct Viaje { string nombre; int n; };
+    RStarTree2D<Viaje> conTexto(8, 3);
+    for (int i = 0; i < 50; i++) conTexto.insertar(i, i, Viaje{"viaje" + to_string(i), i});
+    conTexto.guardar(ruta, [](ostream& o, const Viaje& v) {
+        uint32_t k = (uint32_t)v.nombre.size();
+        o.write((const char*)&k, sizeof k);
+        o.write(v.nombre.data(), k);
+        o.write((const char*)&v.n, sizeof v.n);
+    });
+    RStarTree2D<Viaje> textoCargado(8, 3);
+    textoCargado.cargar(ruta, [](istream& in) {
+        uint32_t k = 0;
+        in.read((char*)&k, sizeof k);
+        Viaje v{string(k, ' '), 0};
+        in.read(&v.nombre[0], k);
+        in.read((char*)&v.n, sizeof v.n);
+        return v;
+    });
+    auto r = textoCargado.buscarRango(Caja(9.5, 9.5, 10.5, 10.5));
+    CHECK(r.size() == 1 && textoCargado.dato(r[0].idx).nombre == "viaje10", "serializador para T no trivial");
+
+    // errores
+    bool lanzo = false;
+    try { RStarTree2D<int> otroM(16, 6); otroM.cargar(ruta); } catch (const runtime_error&) { lanzo = true; }
+    CHECK(lanzo, "M/m o tipo distintos: runtime_error");
+    lanzo = false;
+    try { copia.cargar(ruta); } catch (const logic_error&) { lanzo = true; }
+    CHECK(lanzo, "cargar sobre arbol no vacio: logic_error");
+    arbol.guardar(ruta);
+    { ifstream in(ruta, ios::binary); string todo((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+      ofstream out(ruta, ios::binary); out.write(todo.data(), (streamsize)todo.size() / 2); }
+    RStarTree2D<int> truncado(8, 3);
+    lanzo = false;
+    try { truncado.cargar(ruta); } catch (const runtime_error&) { lanzo = true; }
+    CHECK(lanzo && truncado.tamano() == 0 && !truncado.raiz().valida(), "archivo truncado: runtime_error y arbol vacio");
+    size_t reservados = truncado.calidad().bytesNodos;
+    for (int i = 0; i < 40; i++) try { truncado.cargar(ruta); } catch (const runtime_error&) {}
+    CHECK(truncado.calidad().bytesNodos == reservados, "los nodos a medio leer vuelven al pool: reintentar no reserva mas");
+    arbol.guardar(ruta);
+    {   // nivel de la raiz (cabecera de 64 bytes, nivel en el byte 4 del registro) sin cambiar los hijos
+        fstream f(ruta, ios::binary | ios::in | ios::out);
+        int32_t nivel = 0;
+        f.seekg(68);
+        f.read((char*)&nivel, sizeof nivel);
+        nivel++;
+        f.seekp(68);
+        f.write((const char*)&nivel, sizeof nivel);
+    }
+    RStarTree2D<int> malNivel(8, 3);
+    lanzo = false;
+    try { malNivel.cargar(ruta); } catch (const runtime_error&) { lanzo = true; }
+    CHECK(lanzo && malNivel.tamano() == 0 && !malNivel.raiz().valida(), "niveles inconsistentes: runtime_error y arbol vacio");
+    remove(ruta);
+}
+static void test_arbol_mapeado() {
+    cout << "\nT24: arbol de solo lectura mapeado en memoria" << endl;
+    const char* ruta = "test_rstarlib_arbol.map";
+    RStarTree2D<int> arbol(8, 3);
+    unsigned semilla = 5;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    vector<pair<double,double>> pts;
+    for (int i = 0; i < 3000; i++) {
+        pts.push_back({rnd(), rnd()});
+        arbol.insertar(pts[i].first, pts[i].second, i * 7);
+    }
+    for (int i = 0; i < 200; i++)
+        arbol.eliminar(pts[i].first, pts[i].second, [&](const int& d) { return d == i * 7; });
+    RStarTree2DMapeado<int>::escribir(arbol, ruta);
+    RStarTree2DMapeado<int> mapa(ruta);
+    CHECK(mapa.tamano() == 2800, "tamano = puntos vivos");
+
+    auto idxs = [](const vector<RStarTree2D<int>::Resultado>& r) {
+        multiset<uint32_t> s;
+        for (auto& e : r) s.insert(e.idx);
+        return s;
+    };
+    bool rangoOk = true, cuentaOk = true, vecinosOk = true;
+    for (int q = 0; q < 100; q++) {
+        double x = rnd(), y = rnd(), w = rnd() * 0.3;
+        Caja c(x, y, x + w, y + w);
+        if (idxs(mapa.buscarRango(c)) != idxs(arbol.buscarRango(c))) rangoOk = false;
+        if (mapa.contarEnRango(c) != arbol.contarEnRango(c)) cuentaOk = false;
+        auto a = arbol.kVecinos(x, y, 10), b = mapa.kVecinos(x, y, 10);
+        if (a.size() != b.size()) { vecinosOk = false; continue; }
+        for (size_t i = 0; i < a.size(); i++) {
+            double da = (a[i].x - x) * (a[i].x - x) + (a[i].y - y) * (a[i].y - y);
+            double db = (b[i].x - x) * (b[i].x - x) + (b[i].y - y) * (b[i].y - y);
+            if (da != db) vecinosOk = false;
+        }
+    }
+    CHECK(rangoOk, "buscarRango igual al arbol original (100 cajas)");
+    CHECK(cuentaOk, "contarEnRango igual al arbol original");
+    CHECK(vecinosOk, "kVecinos: mismas distancias y orden");
+    CHECK(mapa.buscarRango(Caja(-1, -1, 2, 2)).size() == 2800, "caja que cubre todo");
+
+    size_t hojasA = 0, hojasB = 0, entA = 0, entB = 0;
+    arbol.visitarHojas([&](const RStarTree2D<int>::HojaVista& v) { hojasA++; entA += v.entradas.n; });
+    mapa.visitarHojas([&](const RStarTree2D<int>::HojaVista& v) { hojasB++; entB += v.entradas.n; });
+    CHECK(hojasA == hojasB && entA == entB, "visitarHojas: mismas hojas y entradas");
+    bool datoOk = true;
+    for (auto& e : mapa.buscarRango(Caja(0.2, 0.2, 0.6, 0.6)))
+        if (mapa.dato(e.idx) != (int)e.idx * 7) datoOk = false;
+    CHECK(datoOk, "dato() lee la arena del archivo");
+
+    // dos mapeos del mismo archivo (como dos procesos) ven lo mismo
+    RStarTree2DMapeado<int> otro(ruta);
+    CHECK(otro.contarEnRango(Caja(0, 0, 0.5, 0.5)) == mapa.contarEnRango(Caja(0, 0, 0.5, 0.5)),
+          "segundo mapeo del mismo archivo");
+
+    RStarTree2D<int> vacio;
+    RStarTree2DMapeado<int>::escribir(vacio, ruta);
+    RStarTree2DMapeado<int> mapaVacio(ruta);
+    CHECK(mapaVacio.tamano() == 0 && mapaVacio.buscarRango(Caja(0, 0, 1, 1)).empty() &&
+          mapaVacio.kVecinos(0, 0, 3).empty(), "arbol vacio");
+
+    bool lanzo = false;
+    try { RStarTree2DMapeado<double> malTipo(ruta); } catch (const runtime_error&) { lanzo = true; }
+    CHECK(lanzo, "tamano de T distinto: runtime_error");
+    arbol.guardar(ruta);   // formato de guardar(), no mapeable
+    lanzo = false;
+    try { RStarTree2DMapeado<int> malo(ruta); } catch (const runtime_error&) { lanzo = true; }
+    CHECK(lanzo, "archivo que no es un arbol mapeable: runtime_error");
+
+    // archivos corruptos con cabecera valida: se rechazan al abrir
+    RStarTree2DMapeado<int>::escribir(arbol, ruta);
+    vector<char> bytes;
+    {
+        ifstream in(ruta, ios::binary);
+        bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    uint64_t offNodos, nodos;
+    memcpy(&offNodos, bytes.data() + 48, 8);   // cabecera: ..., nodos en 24, offNodos en 48
+    memcpy(&nodos, bytes.data() + 24, 8);
+    uint64_t ultimo = offNodos + (nodos - 1) * 64;   // una hoja: BFS termina en hojas
+    auto rechaza = [&](size_t off, uint64_t valor, int ancho) {
+        vector<char> copia = bytes;
+        memcpy(copia.data() + off, &valor, ancho);
+        {
+            ofstream out(ruta, ios::binary | ios::trunc);
+            out.write(copia.data(), (streamsize)copia.size());
+        }
+        try { RStarTree2DMapeado<int> m(ruta); } catch (const runtime_error&) { return true; }
+        return false;
+    };
+    CHECK(rechaza(24, nodos * 1000, 8), "nodos que pasan el fin del archivo: runtime_error");
+    CHECK(rechaza(40, 1, 8), "arena que no llena el archivo: runtime_error");
+    CHECK(rechaza(offNodos + 48, nodos + 5, 8), "hijo fuera de los nodos: runtime_error");
+    CHECK(rechaza(ultimo + 56, 1u << 30, 4), "columnas de hoja dentro de la arena: runtime_error");
+    CHECK(rechaza(ultimo + 48, 8, 8), "columnas de hoja sobre la cabecera: runtime_error");
+    CHECK(rechaza(offNodos + 60, 70, 4) && rechaza(ultimo + 60, 1, 4), "niveles inconsistentes: runtime_error");
+    CHECK(!rechaza(0, bytes[0], 1) && RStarTree2DMapeado<int>(ruta).tamano() == 2800,
+          "el archivo sin tocar se sigue abriendo");
+    remove(ruta);
+}
+static void test_congelar() {
+    cout << "\nT25: congelar en un bloque contiguo (BFS y vEB)" << endl;
+    RStarTree2D<int> arbol(8, 3);
+    unsigned semilla = 21;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    vector<pair<double,double>> pts;
+    for (int i = 0; i < 4000; i++) {
+        pts.push_back({rnd(), rnd()});
+        arbol.insertar(pts[i].first, pts[i].second, i);
+    }
+    for (int i = 0; i < 300; i++)
+        arbol.eliminar(pts[i].first, pts[i].second, [&](const int& d) { return d == i; });
+    CHECK(arbol.calidad().altura >= 4, "arbol de prueba con 4+ niveles");
+
+    for (Disposicion d : {Disposicion::BFS, Disposicion::vEB}) {
+        string nombre = d == Disposicion::BFS ? "BFS: " : "vEB: ";
+        auto fijo = arbol.congelar(d);
+        bool rangoOk = true, cuentaOk = true, vecinosOk = true;
+        vector<RStarTree2D<int>::Resultado> a, b;
+        RStarTree2D<int>::BufferVecinos buf;
+        RStarTree2D<int>::Resultado va[10], vb[10];
+        for (int q = 0; q < 200; q++) {
+            double x = rnd(), y = rnd(), w = rnd() * 0.2;
+            Caja c(x, y, x + w, y + w);
+            a.clear(); b.clear();
+            arbol.buscarRango(c, a);
+            fijo.buscarRango(c, b);
+            if (a.size() != b.size()) rangoOk = false;
+            for (size_t i = 0; i < a.size() && rangoOk; i++) if (a[i].idx != b[i].idx) rangoOk = false;
+            if (arbol.contarEnRango(c) != fijo.contarEnRango(c)) cuentaOk = false;
+            size_t na = arbol.kVecinos(x, y, 10, buf, va), nb = fijo.kVecinos(x, y, 10, buf, vb);
+            if (na != nb) vecinosOk = false;
+            for (size_t i = 0; i < na && vecinosOk; i++) if (va[i].idx != vb[i].idx) vecinosOk = false;
+        }
+        CHECK(fijo.tamano() == 3700, nombre + "tamano");
+        CHECK(rangoOk, nombre + "buscarRango: mismos aciertos en el mismo orden");
+        CHECK(cuentaOk, nombre + "contarEnRango igual");
+        CHECK(vecinosOk, nombre + "kVecinos igual");
+        size_t hojasA = 0, hojasB = 0;
+        arbol.visitarHojasEnRango(Caja(0.1, 0.1, 0.4, 0.4), [&](const RStarTree2D<int>::HojaVista&) { hojasA++; });
+        fijo.visitarHojasEnRango(Caja(0.1, 0.1, 0.4, 0.4), [&](const RStarTree2D<int>::HojaVista&) { hojasB++; });
+        CHECK(hojasA == hojasB && hojasA > 0, nombre + "visitarHojasEnRango: mismas hojas");
+    }
+    CHECK(arbol.congelar(Disposicion::BFS).bytes() == arbol.congelar(Disposicion::vEB).bytes(),
+          "BFS y vEB ocupan lo mismo");
+
+    // el congelado no ve mutaciones posteriores del arbol
+    auto fijo = arbol.congelar();
+    size_t antes = fijo.contarEnRango(Caja(-1, -1, 2, 2));
+    for (int i = 0; i < 50; i++) arbol.insertar(rnd(), rnd(), -1);
+    CHECK(antes == 3700 && fijo.contarEnRango(Caja(-1, -1, 2, 2)) == 3700, "independiente de mutaciones posteriores");
+    auto r = fijo.buscarRango(Caja(0.3, 0.3, 0.5, 0.5));
+    CHECK(!r.empty() && fijo.dato(r[0].idx) == (int)r[0].idx, "dato() lee la arena del arbol");
+
+    RStarTree2D<int> vacio;
+    auto fijoVacio = vacio.congelar(Disposicion::vEB);
+    CHECK(fijoVacio.tamano() == 0 && fijoVacio.buscarRango(Caja(0, 0, 1, 1)).empty() &&
+          fijoVacio.kVecinos(0, 0, 3).empty() && fijoVacio.contarEnRango(Caja(0, 0, 1, 1)) == 0, "arbol vacio");
+}
+// Firma de la estructura: un registro por nodo en preorden
+template <typename Arbol>
+static vector<tuple<bool, int, int, double, double, size_t, size_t>> estructura(const Arbol& a) {
+    vector<tuple<bool, int, int, double, double, size_t, size_t>> r;
+    a.inspeccionar([&](bool hoja, int nivel, int prof, const Caja& c, size_t nE, size_t nH, bool) {
+        r.emplace_back(hoja, nivel, prof, c.lo[0], c.hi[1], nE, nH);
+    });
+    return r;
+}
+static void test_capacidad_fija() {
+    cout << "\nT26: RStarTree2DFijo (M y m de compilacion) igual al de M y m en ejecucion" << endl;
+    RStarTree2D<int> dinamico(8, 3);
+    RStarTree2DFijo<int, 8, 3> fijo;
+    unsigned semilla = 77;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    vector<pair<double,double>> pts;
+    for (int i = 0; i < 3000; i++) {
+        pts.push_back({rnd(), rnd()});
+        dinamico.insertar(pts[i].first, pts[i].second, i);
+        fijo.insertar(pts[i].first, pts[i].second, i);
+    }
+    CHECK(estructura(dinamico) == estructura(fijo), "insertar: misma estructura (splits y reinserts)");
+    bool eliminaIgual = true;
+    for (int i = 0; i < 3000; i += 3) {
+        auto pred = [&](const int& d) { return d == i; };
+        if (dinamico.eliminar(pts[i].first, pts[i].second, pred) != fijo.eliminar(pts[i].first, pts[i].second, pred))
+            eliminaIgual = false;
+    }
+    CHECK(eliminaIgual && estructura(dinamico) == estructura(fijo), "eliminar: misma estructura (condensar)");
+
+    Stats st;
+    fijo.inspeccionar([&](bool esHoja, int, int prof, const Caja&, size_t nE, size_t nH, bool esRaiz) {
+        size_t cuenta = esHoja ? nE : nH;
+        if (cuenta > 8) st.violMax++;
+        if (!esRaiz && cuenta < 3) st.violMin++;
+        if (esHoja) { st.minProf = min(st.minProf, prof); st.maxProf = max(st.maxProf, prof); }
+    });
+    CHECK(st.violMax == 0 && st.violMin == 0 && st.minProf == st.maxProf, "invariantes de M, m y altura");
+
+    bool consultasIguales = true;
+    for (int q = 0; q < 100; q++) {
+        double x = rnd(), y = rnd(), w = rnd() * 0.2;
+        Caja c(x, y, x + w, y + w);
+        auto a = dinamico.buscarRango(c);
+        auto b = fijo.buscarRango(c);
+        if (a.size() != b.size() || dinamico.contarEnRango(c) != fijo.contarEnRango(c)) consultasIguales = false;
+        for (size_t i = 0; i < a.size() && consultasIguales; i++) if (a[i].idx != b[i].idx) consultasIguales = false;
+        auto va = dinamico.kVecinos(x, y, 7);
+        auto vb = fijo.kVecinos(x, y, 7);
+        for (size_t i = 0; i < va.size() && consultasIguales; i++) if (va[i].idx != vb[i].idx) consultasIguales = false;
+    }
+    CHECK(consultasIguales, "buscarRango, contarEnRango y kVecinos iguales");
+
+    vector<tuple<double, double, int>> carga;
+    for (int i = 0; i < 2000; i++) carga.emplace_back(rnd(), rnd(), i);
+    RStarTree2D<int> dinamicoMasivo(8, 3);
+    RStarTree2DFijo<int, 8, 3> fijoMasivo;
+    dinamicoMasivo.cargarMasivo(carga.begin(), carga.end(), Empaquetado::Hilbert);
+    fijoMasivo.cargarMasivo(carga.begin(), carga.end(), Empaquetado::Hilbert);
+    CHECK(estructura(dinamicoMasivo) == estructura(fijoMasivo), "cargarMasivo: misma estructura");
+
+    bool lanzo = false;
+    try { RStarTree2DFijo<int, 8, 3> otro(16, 6); } catch (const invalid_argument&) { lanzo = true; }
+    CHECK(lanzo, "M y m distintos a los del tipo: invalid_argument");
+}
+static void test_n_dimensiones() {
+    cout << "\nT27: RStarTree<T, 3> (lat, lon, tiempo) y CajaN" << endl;
+    CajaN<3> a({0, 0, 0}, {2, 3, 4}), b({1, 1, 1}, {5, 5, 5});
+    CHECK(a.area() == 24.0 && a.margen() == 4.0 * 9.0, "volumen 2x3x4 = 24, aristas 4*(2+3+4)");
+    CHECK(a.overlap(b) == 1.0 * 2.0 * 3.0 && a.interseca(b) && !a.cubre(b), "overlap e interseccion en 3D");
+    double fuera[3] = {1, 1, 9};
+    CHECK(!a.contiene(fuera) && a.dist2A(fuera) == 25.0, "la tercera dimension poda");
+
+    using Arbol3 = RStarTree<int, 3>;
+    Arbol3 arbol(8, 3);
+    unsigned semilla = 31;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    vector<Arbol3::Punto> pts;
+    for (int i = 0; i < 3000; i++) {
+        pts.push_back({rnd(), rnd(), rnd()});
+        arbol.insertar(pts[i], i);
+    }
+    Stats st;
+    arbol.inspeccionar([&](bool esHoja, int, int prof, const CajaN<3>&, size_t nE, size_t nH, bool esRaiz) {
+        size_t cuenta = esHoja ? nE : nH;
+        if (cuenta > 8) st.violMax++;
+        if (!esRaiz && cuenta < 3) st.violMin++;
+        if (esHoja) { st.minProf = min(st.minProf, prof); st.maxProf = max(st.maxProf, prof); }
+    });
+    CHECK(st.violMax == 0 && st.violMin == 0 && st.minProf == st.maxProf, "invariantes de M, m y altura");
+
+    vector<bool> vivo(3000, true);
+    auto comparar = [&](const Arbol3& t) {
+        bool ok = true;
+        for (int q = 0; q < 100 && ok; q++) {
+            double x = rnd(), y = rnd(), z = rnd(), w = rnd() * 0.5;
+            CajaN<3> c({x, y, z}, {x + w, y + w, z + w * 0.3});
+            set<int> esperado, obtenido;
+            for (int i = 0; i < (int)pts.size(); i++) if (vivo[i] && c.contiene(pts[i].data())) esperado.insert(i);
+            for (auto& r : t.buscarRango(c)) obtenido.insert(t.dato(r.idx));
+            ok = esperado == obtenido && t.contarEnRango(c) == esperado.size();
+        }
+        return ok;
+    };
+    CHECK(comparar(arbol), "buscarRango y contarEnRango igual a fuerza bruta");
+    Arbol3::Punto q{0.5, 0.5, 0.5};
+    vector<pair<double, int>> fb;
+    for (int i = 0; i < 3000; i++) {
+        double dd = 0;
+        for (int d = 0; d < 3; d++) dd += (pts[i][d] - q[d]) * (pts[i][d] - q[d]);
+        fb.push_back({dd, i});
+    }
+    sort(fb.begin(), fb.end());
+    auto knn = arbol.kVecinos(q, 10);
+    bool knnOk = knn.size() == 10;
+    for (int i = 0; i < 10 && knnOk; i++) if (arbol.dato(knn[i].idx) != fb[i].second) knnOk = false;
+    CHECK(knnOk, "kVecinos en 3D igual a fuerza bruta, en orden");
+
+    for (int i = 0; i < 3000; i += 2) {
+        vivo[i] = !arbol.eliminar(pts[i], [&](const int& d) { return d == i; });
+    }
+    bool todosEliminados = true;
+    for (int i = 0; i < 3000; i += 2) if (vivo[i]) todosEliminados = false;
+    CHECK(todosEliminados && arbol.tamano() == 1500 && comparar(arbol), "eliminar la mitad y consultar");
+
+    vector<pair<Arbol3::Punto, int>> carga;
+    for (int i = 0; i < 3000; i++) carga.push_back({pts[i], i});
+    Arbol3 masivo(8, 3);
+    masivo.cargarMasivo(carga.begin(), carga.end());
+    size_t hojas = 0;
+    st = Stats();
+    masivo.inspeccionar([&](bool esHoja, int, int prof, const CajaN<3>&, size_t nE, size_t nH, bool esRaiz) {
+        size_t cuenta = esHoja ? nE : nH;
+        if (cuenta > 8) st.violMax++;
+        if (!esRaiz && cuenta < 3) st.violMin++;
+        if (esHoja) { hojas++; st.minProf = min(st.minProf, prof); st.maxProf = max(st.maxProf, prof); }
+    });
+    vivo.assign(3000, true);
+    CHECK(st.violMax == 0 && st.violMin == 0 && st.minProf == st.maxProf && hojas == 375,
+          "cargarMasivo STR 3D: hojas llenas e invariantes");
+    CHECK(comparar(masivo), "cargarMasivo: consultas igual a fuerza bruta");
+}
+static void test_insercion_sin_reservas() {
+    cout << "\nT28: insertar en regimen sin reservas del heap" << endl;
+    // Tras calentar, los buffers de trabajo del arbol ya tienen su capacidad:
+    // lo unico que puede reservar es un tramo nuevo de la arena o una losa
+    // nueva del pool de nodos, cada miles de inserciones
+    auto contar = [](auto& arbol, int calentar, int medir) {
+        unsigned semilla = 2929;
+        auto rnd = [&]() {
+            semilla = semilla * 1103515245u + 12345u;
+            return ((semilla >> 8) % 100000) / 100000.0;
+        };
+        for (int i = 0; i < calentar; i++) { double x = rnd(); arbol.insertar(x, rnd(), i); }
+        size_t antes = reservas.load();
+        for (int i = 0; i < medir; i++) { double x = rnd(); arbol.insertar(x, rnd(), calentar + i); }
+        return reservas.load() - antes;
+    };
+    RStarTree2D<int> chico(8, 3);
+    size_t r = contar(chico, 20000, 2000);
+    cout << "  M=8: " << r << " reservas en 2000 inserciones" << endl;
+    CHECK(r <= 3, "M=8: a lo sumo 3 reservas (arena/pool) en 2000 inserciones");
+    RStarTree2D<int> grande(64, 25);
+    r = contar(grande, 20000, 2000);
+    cout << "  M=64: " << r << " reservas en 2000 inserciones" << endl;
+    CHECK(r <= 3, "M=64: a lo sumo 3 reservas en 2000 inserciones");
+    RStarTree2DFijo<int, 16> fijo;
+    r = contar(fijo, 20000, 2000);
+    cout << "  Fijo<16>: " << r << " reservas en 2000 inserciones" << endl;
+    CHECK(r <= 3, "RStarTree2DFijo<16>: a lo sumo 3 reservas en 2000 inserciones");
+    Stats st;
+    chico.inspeccionar([&](bool esHoja, int, int prof, const Caja&, size_t nE, size_t nH, bool esRaiz) {
+        size_t cuenta = esHoja ? nE : nH;
+        if (cuenta > 8) st.violMax++;
+        if (!esRaiz && cuenta < 3) st.violMin++;
+        if (esHoja) { st.minProf = min(st.minProf, prof); st.maxProf = max(st.maxProf, prof); }
+    });
+    CHECK(chico.tamano() == 22000 && st.violMax == 0 && st.violMin == 0 && st.minProf == st.maxProf,
+          "M=8 tras 22000 inserciones: invariantes del R*-tree");
+}
+static void test_insertar_lote() {
+    cout << "\nT29: insertarLote (rafagas agrupadas por hoja)" << endl;
+    unsigned semilla = 4242;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    RStarTree2D<int> arbol(8, 3);
+    vector<pair<double,double>> pts;
+    for (int i = 0; i < 1000; i++) {
+        pts.push_back({rnd(), rnd()});
+        arbol.insertar(pts[i].first, pts[i].second, i);
+    }
+    bool idxOk = true;
+    for (int r = 0; r < 4; r++) {   // rafagas de 1500, la ultima concentrada en un rincon
+        vector<tuple<double, double, int>> lote;
+        for (int j = 0; j < 1500; j++) {
+            double x = r < 3 ? rnd() : 0.9 + rnd() * 0.1, y = r < 3 ? rnd() : rnd() * 0.1;
+            lote.emplace_back(x, y, (int)pts.size());
+            pts.push_back({x, y});
+        }
+        uint32_t primero = arbol.insertarLote(lote.begin(), lote.end());
+        if (primero != pts.size() - 1500) idxOk = false;
+    }
+    CHECK(idxOk && arbol.tamano() == 7000, "7000 puntos, idx consecutivos desde el devuelto");
+
+    Stats st;
+    arbol.inspeccionar([&](bool esHoja, int, int prof, const Caja&, size_t nE, size_t nH, bool esRaiz) {
+        size_t cuenta = esHoja ? nE : nH;
+        if (cuenta > 8) st.violMax++;
+        if (!esRaiz && cuenta < 3) st.violMin++;
+        if (esHoja) { st.minProf = min(st.minProf, prof); st.maxProf = max(st.maxProf, prof); }
+    });
+    CHECK(st.violMax == 0 && st.violMin == 0 && st.minProf == st.maxProf, "invariantes de M, m y altura");
+
+    bool igual = true;
+    for (int q = 0; q < 200 && igual; q++) {
+        double x = rnd(), y = rnd(), w = rnd() * 0.2;
+        Caja c(x, y, x + w, y + w);
+        set<int> esperado, obtenido;
+        for (int i = 0; i < (int)pts.size(); i++) if (c.contiene(pts[i].first, pts[i].second)) esperado.insert(i);
+        for (auto& e : arbol.buscarRango(c)) obtenido.insert(arbol.dato(e.idx));
+        if (esperado != obtenido || arbol.contarEnRango(c) != esperado.size()) igual = false;
+    }
+    CHECK(igual, "buscarRango y contarEnRango igual a fuerza bruta");
+
+    RStarTree2D<int> vacio(8, 3);
+    vector<tuple<double, double, int>> lote;
+    for (int i = 0; i < 500; i++) lote.emplace_back(rnd(), rnd(), i);
+    vacio.insertarLote(lote.begin(), lote.begin());
+    CHECK(vacio.tamano() == 0 && vacio.buscarRango(Caja(0, 0, 1, 1)).empty(), "lote vacio: no cambia nada");
+    vacio.insertarLote(lote.begin(), lote.end());
+    CHECK(vacio.tamano() == 500 && vacio.contarEnRango(Caja(0, 0, 1, 1)) == 500, "lote sobre arbol vacio");
+
+    // divisiones: un lote de 200 puntos dentro de una sola hoja. Insertar no
+    // quita hojas, asi que cada hoja nueva es una division de esa hoja o de
+    // sus mitades (o de una vecina por el reinsert de p = 2 entradas).
+    RStarTree2D<int> denso(8, 3), deAUno(8, 3);
+    for (int i = 0; i < 1000; i++) {
+        double x = rnd(), y = rnd();
+        denso.insertar(x, y, i);
+        deAUno.insertar(x, y, i);
+    }
+    auto hojas = [](const RStarTree2D<int>& t) {
+        size_t h = 0;
+        t.visitarHojas([&](const RStarTree2D<int>::HojaVista&) { h++; });
+        return h;
+    };
+    Caja region;
+    bool tomada = false;
+    denso.visitarHojas([&](const RStarTree2D<int>::HojaVista& v) { if (!tomada) region = v.mbr, tomada = true; });
+    vector<tuple<double, double, int>> concentrado;
+    for (int j = 0; j < 200; j++)
+        concentrado.emplace_back(region.lo[0] + (region.hi[0] - region.lo[0]) * rnd(),
+                                 region.lo[1] + (region.hi[1] - region.lo[1]) * rnd(), 1000 + j);
+    size_t antes = hojas(denso);
+    denso.insertarLote(concentrado.begin(), concentrado.end());
+    for (auto& [x, y, d] : concentrado) deAUno.insertar(x, y, d);
+    size_t divisiones = hojas(denso) - antes, divisionesDeAUno = hojas(deAUno) - antes;
+    CHECK(divisiones > 1 && divisiones <= 1 + (200 + 2) / 3,
+          "lote concentrado: la hoja se divide varias veces, a lo sumo una por cada m entradas nuevas");
+    CHECK(divisiones <= divisionesDeAUno + divisionesDeAUno / 4,
+          "lote concentrado: tantas divisiones como insertar de a uno");
+    CHECK(denso.contarEnRango(region) == deAUno.contarEnRango(region), "lote concentrado: mismos puntos");
+}
+static void test_eliminacion_masiva() {
+    cout << "\nT30: eliminarEnRango y eliminarLote (una sola condensacion)" << endl;
+    unsigned semilla = 3030;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    RStarTree2D<int> arbol(8, 3);
+    vector<pair<double,double>> pts;
+    vector<bool> vivo;
+    for (int i = 0; i < 6000; i++) {
+        pts.push_back({rnd(), rnd()});
+        vivo.push_back(true);
+        arbol.insertar(pts[i].first, pts[i].second, i);
+    }
+    auto invariantes = [&]() {
+        Stats st;
+        size_t cuentaRaiz = 0;
+        arbol.inspeccionar([&](bool esHoja, int, int prof, const Caja&, size_t nE, size_t nH, bool esRaiz) {
+            size_t cuenta = esHoja ? nE : nH;
+            if (cuenta > 8) st.violMax++;
+            if (!esRaiz && cuenta < 3) st.violMin++;
+            if (esRaiz && !esHoja && nH < 2) st.violMin++;
+            if (esRaiz) cuentaRaiz = cuenta;
+            if (esHoja) { st.minProf = min(st.minProf, prof); st.maxProf = max(st.maxProf, prof); }
+        });
+        return st.violMax == 0 && st.violMin == 0 && (cuentaRaiz == 0 || st.minProf == st.maxProf);
+    };
+    auto comparar = [&]() {
+        for (int q = 0; q < 100; q++) {
+            double x = rnd(), y = rnd(), w = rnd() * 0.3;
+            Caja c(x, y, x + w, y + w);
+            set<int> esperado, obtenido;
+            for (int i = 0; i < (int)pts.size(); i++)
+                if (vivo[i] && c.contiene(pts[i].first, pts[i].second)) esperado.insert(i);
+            for (auto& e : arbol.buscarRango(c)) obtenido.insert(arbol.dato(e.idx));
+            if (esperado != obtenido || arbol.contarEnRango(c) != esperado.size()) return false;
+        }
+        size_t vivos = 0;
+        for (bool v : vivo) vivos += v;
+        return arbol.tamano() == vivos && arbol.contarEnRango(Caja(-1, -1, 2, 2)) == vivos;
+    };
+
+    Caja franja(0.1, -1, 0.45, 2);   // cubre subarboles enteros y corta otros
+    size_t esperadas = 0;
+    for (int i = 0; i < 6000; i++)
+        if (franja.contiene(pts[i].first, pts[i].second)) { vivo[i] = false; esperadas++; }
+    size_t q = arbol.eliminarEnRango(franja);
+    CHECK(q == esperadas, "eliminarEnRango: quita las " + to_string(esperadas) + " de la franja");
+    CHECK(invariantes() && comparar(), "tras eliminarEnRango: invariantes y consultas igual a fuerza bruta");
+
+    Caja zona(0.5, 0.5, 0.9, 0.9);
+    esperadas = 0;
+    for (int i = 0; i < 6000; i++)
+        if (vivo[i] && i % 2 == 0 && zona.contiene(pts[i].first, pts[i].second)) { vivo[i] = false; esperadas++; }
+    q = arbol.eliminarEnRango(zona, [](const int& d) { return d % 2 == 0; });
+    CHECK(q == esperadas && invariantes() && comparar(), "eliminarEnRango con predicado: solo los pares de la zona");
+
+    vector<uint32_t> idxs;
+    esperadas = 0;
+    for (int i = 0; i < 6000; i += 3) {
+        idxs.push_back(i);
+        if (vivo[i]) { vivo[i] = false; esperadas++; }
+    }
+    idxs.push_back(3);
+    idxs.push_back(1000000);   // repetido y fuera de la arena: se ignoran
+    q = arbol.eliminarLote(idxs);
+    CHECK(q == esperadas && invariantes() && comparar(), "eliminarLote: quita esos idx, una vez cada uno");
+
+    // casi todo: quedan pocas entradas y la raiz se acorta
+    esperadas = 0;
+    for (int i = 0; i < 6000; i++) if (vivo[i] && pts[i].first < 0.97) { vivo[i] = false; esperadas++; }
+    q = arbol.eliminarEnRango(Caja(-1, -1, 0.97, 2));
+    CHECK(q == esperadas && invariantes() && comparar(), "eliminar casi todo: invariantes y consultas");
+    arbol.insertar(0.5, 0.5, 6000);
+    pts.push_back({0.5, 0.5});
+    vivo.push_back(true);
+    CHECK(comparar(), "el arbol sigue aceptando inserciones");
+    q = arbol.eliminarEnRango(Caja(-1, -1, 2, 2));
+    CHECK(arbol.tamano() == 0 && arbol.buscarRango(Caja(-1, -1, 2, 2)).empty() && q > 0,
+          "bbox que cubre la raiz: arbol vacio");
+
+    // con instantaneas: la vieja no ve la eliminacion masiva
+    RStarTree2D<int> conInst(8, 3);
+    for (int i = 0; i < 2000; i++) conInst.insertar(pts[i].first, pts[i].second, i);
+    conInst.activarInstantaneas();
+    auto s1 = conInst.instantanea();
+    conInst.eliminarEnRango(franja);
+    conInst.publicar();
+    auto s2 = conInst.instantanea();
+    size_t enFranja = 0;
+    for (int i = 0; i < 2000; i++) enFranja += franja.contiene(pts[i].first, pts[i].second);
+    CHECK(s1.tamano() == 2000 && s1.contarEnRango(franja) == enFranja && s2.tamano() == 2000 - enFranja &&
+          s2.contarEnRango(franja) == 0, "instantaneas: la vieja intacta, la nueva sin la franja");
+}
+static void test_ubicaciones() {
+    cout << "\nT31: mapa idx -> hoja: eliminarPorIdx y actualizar" << endl;
+    unsigned semilla = 3131;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 1000) / 1000.0;   // grilla 0.001: muchos puntos repetidos
+    };
+    RStarTree2D<int> arbol(8, 3);
+    bool lanzo = false;
+    try { arbol.eliminarPorIdx(0); } catch (const logic_error&) { lanzo = true; }
+    CHECK(lanzo, "eliminarPorIdx sin activarUbicaciones: logic_error");
+    arbol.activarUbicaciones();
+    vector<pair<double,double>> pts;
+    vector<bool> vivo;
+    auto agregar = [&](int k) {
+        vector<tuple<double, double, int>> lote;
+        for (int j = 0; j < k; j++) {
+            pts.push_back({rnd(), rnd()});
+            vivo.push_back(true);
+            lote.emplace_back(pts.back().first, pts.back().second, (int)pts.size() - 1);
+        }
+        return lote;
+    };
+    for (auto& [x, y, d] : agregar(3000)) arbol.insertar(x, y, d);
+    auto lote = agregar(1000);
+    arbol.insertarLote(lote.begin(), lote.end());
+
+    auto consistente = [&]() {
+        for (int q = 0; q < 50; q++) {
+            double x = rnd(), y = rnd(), w = rnd() * 0.3;
+            Caja c(x, y, x + w, y + w);
+            set<int> esperado, obtenido;
+            for (int i = 0; i < (int)pts.size(); i++)
+                if (vivo[i] && c.contiene(pts[i].first, pts[i].second)) esperado.insert(i);
+            for (auto& e : arbol.buscarRango(c)) obtenido.insert(e.idx);
+            if (esperado != obtenido) return false;
+        }
+        size_t vivos = 0;
+        for (bool v : vivo) vivos += v;
+        return arbol.tamano() == vivos;
+    };
+
+    bool ok = true;
+    for (int i = 0; i < 4000; i += 3) { ok &= arbol.eliminarPorIdx(i); vivo[i] = false; }
+    CHECK(ok && consistente(), "eliminarPorIdx tras insertar e insertarLote (splits y reinserts)");
+    CHECK(!arbol.eliminarPorIdx(0) && !arbol.eliminarPorIdx(999999), "idx ya eliminado o fuera de la arena: false");
+
+    for (int i = 1; i < 4000; i += 7)   // por coordenadas, tambien condensa
+        if (vivo[i]) { arbol.eliminar(pts[i].first, pts[i].second, [&](const int& d) { return d == i; }); vivo[i] = false; }
+    Caja zona(0.2, 0.2, 0.5, 0.6);
+    for (int i = 0; i < (int)pts.size(); i++) if (zona.contiene(pts[i].first, pts[i].second)) vivo[i] = false;
+    arbol.eliminarEnRango(zona);
+    vector<uint32_t> idxs;
+    for (int i = 2; i < 4000; i += 5) { idxs.push_back(i); vivo[i] = false; }
+    arbol.eliminarLote(idxs);
+    CHECK(consistente(), "eliminar, eliminarEnRango y eliminarLote (por el mapa) mantienen el mapa");
+
+    ok = true;
+    for (int i = 0; i < (int)pts.size(); i++) {
+        if (arbol.eliminarPorIdx(i) != vivo[i]) ok = false;
+        vivo[i] = false;
+    }
+    CHECK(ok && arbol.tamano() == 0, "eliminarPorIdx de todos los vivos: true justo en los vivos, arbol vacio");
+
+    // actualizar: renueva la version de la hoja y de la raiz, no la de las otras hojas
+    RStarTree2D<int> conDatos(8, 3);
+    vector<tuple<double, double, int>> carga;
+    for (int i = 0; i < 1000; i++) carga.emplace_back(rnd(), rnd(), i);
+    conDatos.cargarMasivo(carga.begin(), carga.end());
+    conDatos.activarUbicaciones();
+    auto versiones = [&]() {
+        map<uintptr_t, pair<uint64_t, bool>> v;   // clave -> {version, contiene idx 500}
+        conDatos.visitarHojas([&](const RStarTree2D<int>::HojaVista& h) {
+            bool tiene = false;
+            for (uint32_t i = 0; i < h.entradas.n; i++) tiene |= h.entradas.idx[i] == 500;
+            v[h.clave] = {h.version, tiene};
+        });
+        return v;
+    };
+    auto antes = versiones();
+    uint64_t raizAntes = conDatos.raiz().version();
+    CHECK(conDatos.actualizar(500, -7) && conDatos.dato(500) == -7, "actualizar cambia el dato");
+    auto despues = versiones();
+    int cambiaron = 0;
+    bool laCorrecta = false;
+    for (auto& [clave, vt] : despues) {
+        if (antes[clave].first != vt.first) { cambiaron++; laCorrecta = vt.second; }
+    }
+    CHECK(cambiaron == 1 && laCorrecta && conDatos.raiz().version() != raizAntes,
+          "actualizar: cambia la version de su hoja (y la raiz), no la de otras");
+
+    // con instantaneas y tras cargar de archivo
+    conDatos.activarInstantaneas();
+    auto s1 = conDatos.instantanea();
+    ok = true;
+    for (int i = 0; i < 1000; i += 2) ok &= conDatos.eliminarPorIdx(i);
+    conDatos.publicar();
+    CHECK(ok && s1.tamano() == 1000 && conDatos.instantanea().tamano() == 500,
+          "instantaneas: la vieja intacta tras eliminarPorIdx");
+    lanzo = false;
+    try { conDatos.actualizar(1, -1); } catch (const logic_error&) { lanzo = true; }
+    CHECK(lanzo && s1.dato(1) == 1, "actualizar con instantaneas activas: logic_error, el dato no cambia");
+    string ruta = "/tmp/test_rstarlib_ubicaciones.bin";
+    conDatos.guardar(ruta);
+    RStarTree2D<int> cargado(8, 3);
+    cargado.activarUbicaciones();
+    cargado.cargar(ruta);
+    remove(ruta.c_str());
+    ok = true;
+    for (int i = 0; i < 1000; i++) if (cargado.eliminarPorIdx(i) != (i % 2 == 1)) ok = false;
+    CHECK(ok && cargado.tamano() == 0, "cargar de archivo con el mapa activo");
+}
+static void test_mover() {
+    cout << "\nT32: mover(idx, nx, ny) con camino rapido en la hoja" << endl;
+    unsigned semilla = 3232;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    RStarTree2D<int> arbol(8, 3);
+    bool lanzo = false;
+    try { arbol.mover(0, 0, 0); } catch (const logic_error&) { lanzo = true; }
+    CHECK(lanzo, "mover sin activarUbicaciones: logic_error");
+    arbol.activarUbicaciones();
+    vector<pair<double,double>> pts;
+    for (int i = 0; i < 3000; i++) {
+        pts.push_back({rnd(), rnd()});
+        arbol.insertar(pts[i].first, pts[i].second, i);
+    }
+
+    // un movimiento dentro del MBR de la hoja: misma hoja, solo cambia su version
+    auto hojas = [&]() {
+        map<uintptr_t, uint64_t> v;
+        arbol.visitarHojas([&](const RStarTree2D<int>::HojaVista& h) { v[h.clave] = h.version; });
+        return v;
+    };
+    uint32_t elegido = 0;
+    double cx = 0, cy = 0;
+    bool hallado = false;
+    arbol.visitarHojas([&](const RStarTree2D<int>::HojaVista& h) {
+        const auto& c = h.entradas;
+        for (uint32_t i = 0; i < c.n && !hallado; i++) {
+            bool borde = c.x[i] == h.mbr.lo[0] || c.x[i] == h.mbr.hi[0] || c.y[i] == h.mbr.lo[1] || c.y[i] == h.mbr.hi[1];
+            if (!borde) {
+                elegido = c.idx[i];
+                cx = (h.mbr.lo[0] + h.mbr.hi[0]) / 2;
+                cy = (h.mbr.lo[1] + h.mbr.hi[1]) / 2;
+                hallado = true;
+            }
+        }
+    });
+    auto antes = hojas();
+    CHECK(hallado && arbol.mover(elegido, cx, cy), "mover dentro del MBR de la hoja");
+    pts[elegido] = {cx, cy};
+    auto despues = hojas();
+    int cambiaron = 0;
+    bool mismas = antes.size() == despues.size();
+    for (auto& [clave, v] : despues) {
+        if (!antes.count(clave)) mismas = false;
+        else if (antes[clave] != v) cambiaron++;
+    }
+    CHECK(mismas && cambiaron == 1, "camino rapido: mismas hojas, cambia solo la version de la suya");
+
+    // vehiculos: pasos chicos y algun salto lejos
+    for (int paso = 0; paso < 20000; paso++) {
+        uint32_t i = (uint32_t)(rnd() * 3000) % 3000;
+        double nx, ny;
+        if (paso % 10 == 0) { nx = rnd(); ny = rnd(); }
+        else {
+            nx = min(1.0, max(0.0, pts[i].first + (rnd() - 0.5) * 0.004));
+            ny = min(1.0, max(0.0, pts[i].second + (rnd() - 0.5) * 0.004));
+        }
+        arbol.mover(i, nx, ny);
+        pts[i] = {nx, ny};
+    }
+    bool igual = true;
+    for (int q = 0; q < 200 && igual; q++) {
+        double x = rnd(), y = rnd(), w = rnd() * 0.2;
+        Caja c(x, y, x + w, y + w);
+        set<uint32_t> esperado, obtenido;
+        for (int i = 0; i < 3000; i++) if (c.contiene(pts[i].first, pts[i].second)) esperado.insert(i);
+        for (auto& e : arbol.buscarRango(c)) obtenido.insert(e.idx);
+        if (esperado != obtenido) igual = false;
+    }
+    CHECK(igual && arbol.tamano() == 3000, "20000 movimientos: consultas igual a fuerza bruta, mismo tamano");
+
+    Stats st;
+    arbol.inspeccionar([&](bool esHoja, int, int prof, const Caja&, size_t nE, size_t nH, bool esRaiz) {
+        size_t cuenta = esHoja ? nE : nH;
+        if (cuenta > 8) st.violMax++;
+        if (!esRaiz && cuenta < 3) st.violMin++;
+        if (esHoja) { st.minProf = min(st.minProf, prof); st.maxProf = max(st.maxProf, prof); }
+    });
+    bool ajustados = true;   // MBR exactos y cuentas al dia
+    std::function<Caja(RStarTree2D<int>::NodoVista)> revisar = [&](RStarTree2D<int>::NodoVista n) {
+        Caja exacta;
+        uint64_t cuenta = 0;
+        if (n.esHoja()) {
+            for (auto e : n.entradas()) exacta.estirar(e.x, e.y);
+            cuenta = n.entradas().size();
+        } else {
+            for (size_t i = 0; i < n.nHijos(); i++) { exacta.estirar(revisar(n.hijo(i))); cuenta += n.hijo(i).cuenta(); }
+        }
+        if (!(exacta.cubre(n.mbr()) && n.mbr().cubre(exacta)) || cuenta != n.cuenta()) ajustados = false;
+        return n.mbr();
+    };
+    revisar(arbol.raiz());
+    CHECK(st.violMax == 0 && st.violMin == 0 && st.minProf == st.maxProf && ajustados,
+          "invariantes de M, m y altura; MBR exactos y cuentas al dia");
+
+    arbol.eliminarPorIdx(7);
+    CHECK(!arbol.mover(7, 0.5, 0.5) && !arbol.mover(99999, 0.5, 0.5), "idx eliminado o fuera de la arena: false");
+
+    arbol.activarInstantaneas();
+    auto s1 = arbol.instantanea();
+    Caja rincon(0, 0, 0.1, 0.1);
+    size_t enRincon = s1.contarEnRango(rincon);
+    for (uint32_t i = 100; i < 600; i++) arbol.mover(i, 0.05, 0.05);
+    arbol.publicar();
+    CHECK(s1.contarEnRango(rincon) == enRincon && arbol.instantanea().contarEnRango(rincon) >= 500,
+          "instantaneas: la vieja no ve los movimientos, la nueva si");
+}
+static void test_reuso_compactar() {
+    cout << "\nT33: reuso de huecos de la arena y compactar" << endl;
+    unsigned semilla = 3333;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    // sin reuso: tombstone, la arena solo crece
+    RStarTree2D<int> sinReuso(8, 3);
+    for (int i = 0; i < 100; i++) sinReuso.insertar(i * 0.01, 0.5, i);
+    for (int i = 10; i < 20; i++) sinReuso.eliminar(i * 0.01, 0.5, [](const int&) { return true; });
+    uint32_t nuevo = sinReuso.insertar(0.3, 0.3, 100);
+    CHECK(nuevo == 100 && sinReuso.dato(15) == 15 && sinReuso.huecosLibres() == 0,
+          "sin activarReuso: insertar agrega al final y el dato eliminado sigue");
+    sinReuso.activarReuso();
+    CHECK(sinReuso.huecosLibres() == 10, "activarReuso encuentra los huecos que ya habia");
+    nuevo = sinReuso.insertar(0.4, 0.4, 101);
+    CHECK(nuevo == 10 && sinReuso.dato(10) == 101 && sinReuso.tamanoArena() == 101,
+          "insertar reusa el hueco mas bajo");
+
+    // ventana deslizante: tandas de 500 (insertar o insertarLote), vencen
+    // las de hace 4 tandas (eliminarLote, eliminar o eliminarEnRango)
+    RStarTree2D<int> arbol(8, 3);
+    arbol.activarReuso();
+    vector<pair<double, double>> pos;
+    vector<uint32_t> idxDe;
+    const int TANDA = 500, VENTANA = 4;
+    for (int r = 0; r < 20; r++) {
+        vector<tuple<double, double, int>> lote;
+        for (int j = 0; j < TANDA; j++) {
+            pos.push_back({rnd(), rnd()});
+            lote.emplace_back(pos.back().first, pos.back().second, (int)pos.size() - 1);
+        }
+        if (r % 2 == 0) {
+            arbol.insertarLote(lote.begin(), lote.end(), idxDe);
+        } else {
+            for (auto& [x, y, d] : lote) idxDe.push_back(arbol.insertar(x, y, d));
+        }
+        if (r < VENTANA) continue;
+        int desde = (r - VENTANA) * TANDA;
+        if (r % 3 == 0) {
+            vector<uint32_t> idxs(idxDe.begin() + desde, idxDe.begin() + desde + TANDA);
+            arbol.eliminarLote(idxs);
+        } else {
+            for (int i = desde; i < desde + TANDA; i++)
+                arbol.eliminar(pos[i].first, pos[i].second, [&](const int& d) { return d == i; });
+        }
+    }
+    arbol.eliminarEnRango(Caja(0, 0, 0.2, 1));
+    auto coherente = [&](const RStarTree2D<int>& a, size_t vivos) {
+        bool ok = a.tamano() == vivos;
+        set<uint32_t> vistos;
+        a.recorrer([&](const RStarTree2D<int>::Resultado& e) {
+            int d = a.dato(e.idx);
+            ok &= vistos.insert(e.idx).second && d >= 0 && d < (int)pos.size() && e.x == pos[d].first &&
+                  e.y == pos[d].second && d >= (20 - VENTANA) * TANDA && pos[d].first > 0.2;
+        });
+        return ok && vistos.size() == vivos;
+    };
+    size_t esperados = 0;
+    for (int i = (20 - VENTANA) * TANDA; i < (int)pos.size(); i++) esperados += pos[i].first > 0.2;
+    CHECK(coherente(arbol, esperados), "cada punto vivo conserva su dato tras reusar huecos");
+    CHECK(arbol.tamanoArena() <= (size_t)(VENTANA + 1) * TANDA && esperados > 1000,
+          "la arena queda acotada por el pico de la ventana, no por lo insertado");
+
+    auto remapeo = arbol.compactar();
+    bool ordenado = true;
+    uint32_t esperado = 0;
+    arbol.recorrer([&](const RStarTree2D<int>::Resultado& e) { ordenado &= e.idx == esperado++; });
+    CHECK(arbol.tamanoArena() == arbol.tamano() && arbol.huecosLibres() == 0 && ordenado &&
+          coherente(arbol, esperados),
+          "compactar: arena sin huecos, idx consecutivos en el orden de las hojas");
+    bool tabla = true;
+    for (int i = 0; i < (int)pos.size(); i++) {
+        uint32_t nuevoIdx = remapeo[idxDe[i]];
+        bool vivo = i >= (20 - VENTANA) * TANDA && pos[i].first > 0.2;
+        if (vivo) tabla &= nuevoIdx != RStarTree2D<int>::SIN_IDX && arbol.dato(nuevoIdx) == i;
+    }
+    CHECK(tabla, "remapeo[viejo] lleva a la nueva posicion del mismo dato");
+
+    // compactar con el mapa idx -> hoja, IndicePorId y GruposPorHoja
+    RStarTree2D<Viaje> viajes(8, 3);
+    for (int i = 0; i < 600; i++) viajes.insertar(rnd(), rnd(), Viaje{i, i % 3, {(double)(i % 3), 0.0}});
+    viajes.activarUbicaciones();
+    viajes.activarReuso();
+    IndicePorId<Viaje, int> indice(viajes, [](const Viaje& v) { return v.id; });
+    GruposPorHoja<Viaje, int> grupos(viajes,
+        [](const Viaje& v) { return v.etiqueta; },
+        [](const Viaje& v) { return v.pcs; });
+    grupos.construir();
+    vector<uint32_t> vencidos;
+    for (uint32_t i = 0; i < 600; i += 4) vencidos.push_back(i);
+    viajes.eliminarLote(vencidos);
+    for (uint32_t i : vencidos) indice.quitar((int)i);
+    auto idsDeGrupos = [&](GruposPorHoja<Viaje, int>& g) {
+        set<vector<int>> res;
+        for (auto& grupo : g.gruposEnRango(Caja(0, 0, 1, 1))) {
+            vector<int> ids;
+            for (uint32_t idx : grupo) ids.push_back(viajes.dato(idx).id);
+            sort(ids.begin(), ids.end());
+            res.insert(ids);
+        }
+        return res;
+    };
+    auto antes = idsDeGrupos(grupos);
+    auto tablaViajes = viajes.compactar();
+    indice.remapear(tablaViajes);
+    grupos.remapear(tablaViajes);
+    bool indiceOk = indice.tamano() == 450;
+    for (int id = 0; id < 600; id++) {
+        auto idx = indice.buscar(id);
+        indiceOk &= id % 4 == 0 ? !idx.has_value() : idx.has_value() && viajes.dato(*idx).id == id;
+    }
+    CHECK(indiceOk, "IndicePorId::remapear: cada id lleva a su dato; los vencidos no estan");
+    CHECK(idsDeGrupos(grupos) == antes, "GruposPorHoja::remapear: mismos grupos sin rearmar");
+    uint32_t idx1 = tablaViajes[1];
+    CHECK(viajes.eliminarPorIdx(idx1) && viajes.tamano() == 449 && viajes.buscarRango(Caja(0, 0, 1, 1)).size() == 449,
+          "el mapa idx -> hoja queda con los idx nuevos");
+
+    // instantaneas: un idx liberado no se reusa mientras un lector anterior siga
+    RStarTree2D<int> conLectores(8, 3);
+    conLectores.activarInstantaneas();
+    conLectores.activarReuso();
+    for (int i = 0; i < 50; i++) conLectores.insertar(i * 0.02, 0.5, i);
+    conLectores.publicar();
+    {
+        auto s = conLectores.instantanea();
+        conLectores.eliminar(0.0, 0.5, [](const int&) { return true; });
+        conLectores.publicar();
+        uint32_t otro = conLectores.insertar(0.9, 0.9, 50);
+        CHECK(otro == 50 && s.dato(0) == 0, "con un lector anterior activo el hueco espera");
+    }
+    conLectores.publicar();
+    CHECK(conLectores.insertar(0.8, 0.8, 51) == 0, "sin lectores que lo vean, el hueco se reusa");
+    bool lanzo = false;
+    try { conLectores.compactar(); } catch (const logic_error&) { lanzo = true; }
+    CHECK(lanzo, "compactar con instantaneas activas: logic_error");
+
+    // Congelados vivos: leen la arena por idx, que no se reusa ni se mueve
+    RStarTree2D<int> conCongelado(8, 3);
+    for (int i = 0; i < 60; i++) conCongelado.insertar(i * 0.01, 0.25, i);
+    for (int i = 0; i < 20; i++) conCongelado.eliminar(i * 0.01, 0.25, [](const int&) { return true; });
+    {
+        auto fijo = conCongelado.congelar();
+        lanzo = false;
+        try { conCongelado.activarReuso(); } catch (const logic_error&) { lanzo = true; }
+        CHECK(lanzo && !conCongelado.reusoActivo(), "activarReuso con un Congelado vivo: logic_error");
+    }
+    conCongelado.activarReuso();
+    {
+        auto fijo = conCongelado.congelar();
+        auto copia = fijo;
+        auto movido = std::move(fijo);
+        uint32_t otro = conCongelado.insertar(0.9, 0.9, 100);
+        CHECK(otro == 60 && conCongelado.huecosLibres() == 20 && copia.dato(5) == 5 && movido.dato(5) == 5,
+              "con Congelados vivos insertar agrega al final y no pisa sus idx");
+        lanzo = false;
+        try { conCongelado.compactar(); } catch (const logic_error&) { lanzo = true; }
+        CHECK(lanzo && conCongelado.tamanoArena() == 61, "compactar con un Congelado vivo: logic_error");
+    }
+    CHECK(conCongelado.insertar(0.8, 0.8, 101) == 0, "soltados los Congelados, el hueco se reusa");
+    auto tablaFinal = conCongelado.compactar();
+    auto fijo = conCongelado.congelar();
+    uint32_t nuevo60 = tablaFinal[60];
+    CHECK(conCongelado.tamanoArena() == 42 && fijo.tamano() == 42 && fijo.dato(nuevo60) == 100,
+          "compactar y volver a congelar: los idx nuevos valen en el Congelado");
+}
+static void test_join_espacial() {
+    cout << "\nT34: join espacial entre dos arboles" << endl;
+    unsigned semilla = 3434;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 10000) / 10000.0;   // grilla 0.0001: hay puntos repetidos
+    };
+    // alturas distintas: 4000 puntos con M = 8 contra 300 con M = 16
+    vector<pair<double, double>> pa, pb;
+    RStarTree2D<int> a(8, 3), b(16, 6);
+    for (int i = 0; i < 4000; i++) { pa.push_back({rnd(), rnd()}); a.insertar(pa[i].first, pa[i].second, i); }
+    vector<tuple<double, double, int>> cargaB;
+    for (int i = 0; i < 300; i++) {
+        pb.push_back(i % 10 == 0 ? pa[i * 7] : make_pair(rnd(), rnd()));   // algunos coinciden con A
+        cargaB.emplace_back(pb[i].first, pb[i].second, i);
+    }
+    b.cargarMasivo(cargaB.begin(), cargaB.end());
+    auto fuerzaBruta = [&](double d) {
+        set<pair<uint32_t, uint32_t>> res;
+        for (uint32_t i = 0; i < pa.size(); i++)
+            for (uint32_t j = 0; j < pb.size(); j++) {
+                double dx = pa[i].first - pb[j].first, dy = pa[i].second - pb[j].second;
+                if (dx * dx + dy * dy <= d * d) res.insert({i, j});
+            }
+        return res;
+    };
+    JoinEspacial<int, int> join(a, b);
+    bool ok = true, sinRepetidos = true;
+    for (double d : {0.0, 0.005, 0.02, 0.08}) {
+        set<pair<uint32_t, uint32_t>> obtenido;
+        size_t emitidos = 0;
+        join.unir(d, [&](uint32_t x, uint32_t y) { obtenido.insert({x, y}); emitidos++; });
+        ok &= obtenido == fuerzaBruta(d);
+        sinRepetidos &= emitidos == obtenido.size();
+    }
+    CHECK(ok && sinRepetidos, "pares a distancia <= d igual a fuerza bruta, cada uno una vez (d = 0 incluido)");
+
+    PoolHilos pool(4);
+    vector<vector<pair<uint32_t, uint32_t>>> porHilo(pool.hilos());
+    join.unir(0.02, pool, [&](uint32_t x, uint32_t y, unsigned h) { porHilo[h].push_back({x, y}); });
+    set<pair<uint32_t, uint32_t>> paralelo;
+    size_t emitidos = 0;
+    for (auto& v : porHilo) { paralelo.insert(v.begin(), v.end()); emitidos += v.size(); }
+    CHECK(paralelo == fuerzaBruta(0.02) && emitidos == paralelo.size(),
+          "en paralelo (pares de subarboles en el pool): mismos pares, sin repetir");
+
+    // al reves (A mas baja que B), hoja raiz contra arbol, y un arbol vacio
+    JoinEspacial<int, int> inverso(b, a);
+    set<pair<uint32_t, uint32_t>> inv;
+    inverso.unir(0.02, [&](uint32_t x, uint32_t y) { inv.insert({y, x}); });
+    RStarTree2D<int> chico(8, 3), vacio(8, 3);
+    for (int i = 0; i < 5; i++) chico.insertar(pb[i].first, pb[i].second, i);
+    JoinEspacial<int, int> conHoja(chico, a), conVacio(a, vacio);
+    set<pair<uint32_t, uint32_t>> hoja, esperado;
+    conHoja.unir(0.02, [&](uint32_t x, uint32_t y) { hoja.insert({y, x}); });
+    for (auto& [i, j] : fuerzaBruta(0.02)) if (j < 5) esperado.insert({i, j});
+    size_t conVacioPares = 0;
+    conVacio.unir(1.0, [&](uint32_t, uint32_t) { conVacioPares++; });
+    CHECK(inv == fuerzaBruta(0.02) && hoja == esperado && conVacioPares == 0,
+          "arboles invertidos, hoja raiz contra arbol y arbol vacio");
+    int lanzados = 0;
+    try { join.unir(-0.01, [](uint32_t, uint32_t) {}); } catch (const invalid_argument&) { lanzados++; }
+    try { join.unir(-0.01, pool, [](uint32_t, uint32_t, unsigned) {}); } catch (const invalid_argument&) { lanzados++; }
+    try { join.unir(nan(""), [](uint32_t, uint32_t) {}); } catch (const invalid_argument&) { lanzados++; }
+    CHECK(lanzados == 3, "d < 0 o NaN: invalid_argument");
+}
+struct PuntoCluster { int id; int32_t cluster; };
+
+static void test_dbscan() {
+    cout << "\nT35: auto-join por distancia y DBSCAN" << endl;
+    unsigned semilla = 3535;
+    auto rnd = [&]() {
+        semilla = semilla * 1103515245u + 12345u;
+        return ((semilla >> 8) % 100000) / 100000.0;
+    };
+    // 6 nubes densas de radios distintos, puntos repetidos y ruido uniforme
+    RStarTree2D<PuntoCluster> arbol(8, 3);
+    vector<pair<double, double>> pts;
+    for (int c = 0; c < 6; c++) {
+        double cx = rnd(), cy = rnd(), r = 0.01 + 0.01 * c;
+        for (int i = 0; i < 300; i++) pts.push_back({cx + (rnd() - 0.5) * r, cy + (rnd() - 0.5) * r});
+    }
+    for (int i = 0; i < 200; i++) pts.push_back(pts[i * 5]);   // coordenadas repetidas
+    for (int i = 0; i < 600; i++) pts.push_back({rnd(), rnd()});
+    for (int i = 0; i < (int)pts.size(); i++) arbol.insertar(pts[i].first, pts[i].second, PuntoCluster{i, 99});
+    vector<bool> vivo(pts.size(), true);
+    for (int i = 7; i < (int)pts.size(); i += 11) {
+        arbol.eliminar(pts[i].first, pts[i].second, [&](const PuntoCluster& p) { return p.id == i; });
+        vivo[i] = false;
+    }
+    size_t n = pts.size();
+    auto vecinosFB = [&](double d) {
+        vector<vector<uint32_t>> v(n);
+        for (uint32_t i = 0; i < n; i++)
+            for (uint32_t j = 0; j < n; j++) {
+                double dx = pts[i].first - pts[j].first, dy = pts[i].second - pts[j].second;
+                if (i != j && vivo[i] && vivo[j] && dx * dx + dy * dy <= d * d) v[i].push_back(j);
+            }
+        return v;
+    };
+
+    const double EPS = 0.004;
+    auto fb = vecinosFB(EPS);
+    JoinEspacial<PuntoCluster, PuntoCluster> autoJoin(arbol);
+    set<pair<uint32_t, uint32_t>> pares;
+    bool sinPropios = true;
+    size_t emitidos = 0;
+    autoJoin.unir(EPS, [&](uint32_t i, uint32_t j) {
+        sinPropios &= i != j;
+        pares.insert({min(i, j), max(i, j)});
+        emitidos++;
+    });
+    size_t esperados = 0;
+    for (auto& v : fb) esperados += v.size();
+    CHECK(sinPropios && emitidos == pares.size() && emitidos * 2 == esperados,
+          "auto-join: cada par de puntos distintos una vez, nunca (i, i)");
+
+    PoolHilos pool(4);
+    bool listasOk = true;
+    for (int conPool = 0; conPool < 2; conPool++) {
+        auto l = conPool ? autoJoin.listasVecinos(EPS, pool) : autoJoin.listasVecinos(EPS);
+        listasOk &= l.tamano() == n;
+        for (uint32_t i = 0; i < n && listasOk; i++) {
+            auto li = l.de(i);
+            listasOk &= vector<uint32_t>(li.begin(), li.end()) == fb[i];
+        }
+    }
+    CHECK(listasOk, "listasVecinos (en un hilo y en el pool): por idx, ordenadas, sin repetidos ni eliminados");
+    RStarTree2D<PuntoCluster> otro(8, 3);
+    JoinEspacial<PuntoCluster, PuntoCluster> dosArboles(arbol, otro);
+    bool lanzo = false;
+    try { dosArboles.listasVecinos(EPS); } catch (const logic_error&) { lanzo = true; }
+    CHECK(lanzo, "listasVecinos entre dos arboles: logic_error");
+
+    // DBSCAN de referencia: BFS sobre nucleos; borde al nucleo vecino de
+    // menor idx; clusters numerados por su menor idx
+    const int MIN_PTS = 8;
+    vector<int32_t> esperado(n, -1);
+    vector<bool> nucleo(n);
+    for (size_t i = 0; i < n; i++) nucleo[i] = vivo[i] && fb[i].size() + 1 >= (size_t)MIN_PTS;
+    vector<int> comp(n, -1);
+    for (size_t i = 0; i < n; i++) {
+        if (!nucleo[i] || comp[i] >= 0) continue;
+        vector<uint32_t> cola{(uint32_t)i};
+        comp[i] = (int)i;
+        while (!cola.empty()) {
+            uint32_t p = cola.back();
+            cola.pop_back();
+            for (uint32_t q : fb[p]) if (nucleo[q] && comp[q] < 0) { comp[q] = (int)i; cola.push_back(q); }
+        }
+    }
+    for (size_t i = 0; i < n; i++)
+        if (!nucleo[i] && vivo[i])
+            for (uint32_t q : fb[i]) if (nucleo[q]) { comp[i] = comp[q]; break; }
+    map<int, int32_t> numero;
+    for (size_t i = 0; i < n; i++)
+        if (comp[i] >= 0) {
+            if (!numero.count(comp[i])) numero[comp[i]] = (int32_t)numero.size();
+            esperado[i] = numero[comp[i]];
+        }
+
+    Dbscan<PuntoCluster> dbscan(arbol);
+    CHECK(!dbscan.esNucleo(0) && dbscan.etiquetas().empty(), "antes de etiquetar: sin nucleos ni etiquetas");
+    uint32_t k = dbscan.etiquetar(EPS, MIN_PTS, [](PuntoCluster& p, int32_t c) { p.cluster = c; });
+    bool enArena = true;
+    for (size_t i = 0; i < n; i++) enArena &= arbol.dato(i).cluster == (vivo[i] ? esperado[i] : 99);
+    CHECK(k == numero.size() && k >= 6 && dbscan.etiquetas() == esperado && enArena,
+          "DBSCAN igual a la referencia; etiquetas escritas en la arena, eliminados sin tocar");
+    for (size_t i = 0; i < n; i++) if (vivo[i]) arbol.dato(i).cluster = 99;
+    uint32_t kPool = dbscan.etiquetar(EPS, MIN_PTS, pool, [](PuntoCluster& p, int32_t c) { p.cluster = c; });
+    enArena = true;
+    for (size_t i = 0; i < n; i++) enArena &= arbol.dato(i).cluster == (vivo[i] ? esperado[i] : 99);
+    bool nucleosOk = true;
+    for (size_t i = 0; i < n; i++) nucleosOk &= dbscan.esNucleo((uint32_t)i) == nucleo[i];
+    CHECK(kPool == k && dbscan.etiquetas() == esperado && enArena && nucleosOk,
+          "DBSCAN en el pool: mismo resultado que en un hilo");
+
+    auto poner = [](PuntoCluster& p, int32_t c) { p.cluster = c; };
+    int lanzados = 0;
+    try { dbscan.etiquetar(-EPS, MIN_PTS, poner); } catch (const invalid_argument&) { lanzados++; }
+    try { dbscan.etiquetar(EPS, 0, poner); } catch (const invalid_argument&) { lanzados++; }
+    try { dbscan.etiquetar(EPS, -3, pool, poner); } catch (const invalid_argument&) { lanzados++; }
+    CHECK(lanzados == 3 && dbscan.etiquetas() == esperado, "eps < 0 o minPts < 1: invalid_argument, sin tocar la corrida");
+    uint32_t nuevo = arbol.insertar(0.5, 0.5, PuntoCluster{(int)n, 99});
+    CHECK(!dbscan.esNucleo(nuevo) && !dbscan.esNucleo(RStarTree2D<PuntoCluster>::SIN_IDX),
+          "esNucleo fuera de la ultima corrida: false");
+}
 int main() {
     cout << "=== Tests rstarLib ===" << endl;
     test_caja();
@@ -288,6 +2207,31 @@ int main() {
     test_indice_por_id();
     test_grupos();
     test_n_similares();
+    test_carga_masiva();
+    test_hilbert();
+    test_pool_nodos();
+    test_hojas_columnas();
+    test_nucleos_simd();
+    test_rango_sin_materializar();
+    test_contar_en_rango();
+    test_agregados();
+    test_vecinos_incrementales();
+    test_consultas_lote();
+    test_instantaneas();
+    test_carga_paralela();
+    test_guardar_cargar();
+    test_arbol_mapeado();
+    test_congelar();
+    test_capacidad_fija();
+    test_n_dimensiones();
+    test_insercion_sin_reservas();
+    test_insertar_lote();
+    test_eliminacion_masiva();
+    test_ubicaciones();
+    test_mover();
+    test_reuso_compactar();
+    test_join_espacial();
+    test_dbscan();
     cout << "\n=== Resultado: " << (fallos == 0 ? "TODOS PASAN" : to_string(fallos) + " FALLOS") << " ===" << endl;
     return fallos == 0 ? 0 : 1;
 }